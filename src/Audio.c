@@ -35,13 +35,6 @@ static void Volume_Mix16(int16_t* samples, int count, int volume) {
 	}
 }
 
-static void Volume_Mix8(uint8_t* samples, int count, int volume) {
-	int i;
-	for (i = 0; i < count; i++, samples++) {
-		samples[0] = (127 + (samples[0] - 127) * volume / 100);
-	}
-}
-
 /*########################################################################################################################*
 *------------------------------------------------------Soundboard---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -64,6 +57,22 @@ struct Soundboard {
 #define WAV_FourCC(a, b, c, d) (((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | (uint32_t)d)
 #define WAV_FMT_SIZE 16
 
+/* Converts unsigned 8 bit samples to signed 16 bit samples, as the mixer only handles 16 bit */
+static void Sound_Expand8(struct Sound* snd) {
+	int16_t* data;
+	uint32_t i;
+
+	data = Mem_Alloc(snd->DataSize, 2, "WAV 16 bit data");
+	for (i = 0; i < snd->DataSize; i++) {
+		data[i] = (int16_t)((snd->Data[i] - 128) * 256);
+	}
+
+	Mem_Free(snd->Data);
+	snd->Data      = (uint8_t*)data;
+	snd->DataSize *= 2;
+	snd->Format.BitsPerSample = 16;
+}
+
 static ReturnCode Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 	uint32_t fourCC, size;
 	uint8_t tmp[WAV_FMT_SIZE];
@@ -90,10 +99,17 @@ static ReturnCode Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 			/* tmp[8] (6) alignment data and stuff */
 			snd->Format.BitsPerSample = Stream_GetU16_LE(&tmp[14]);
 			size -= WAV_FMT_SIZE;
+
+			if (snd->Format.Channels != 1 && snd->Format.Channels != 2) return WAV_ERR_DATA_TYPE;
+			if (snd->Format.BitsPerSample != 8 && snd->Format.BitsPerSample != 16) return WAV_ERR_DATA_TYPE;
 		} else if (fourCC == WAV_FourCC('d','a','t','a')) {
+			if (!snd->Format.Channels) return WAV_ERR_DATA_TYPE;
 			snd->Data = Mem_Alloc(size, 1, "WAV sound data");
 			snd->DataSize = size;
-			return Stream_Read(stream, snd->Data, size);
+
+			if ((res = Stream_Read(stream, snd->Data, size))) return res;
+			if (snd->Format.BitsPerSample == 8) Sound_Expand8(snd);
+			return 0;
 		}
 
 		/* Skip over unhandled data */
@@ -195,105 +211,187 @@ static struct Sound* Soundboard_PickRandom(struct Soundboard* board, uint8_t typ
 /*########################################################################################################################*
 *--------------------------------------------------------Sounds-----------------------------------------------------------*
 *#########################################################################################################################*/
-struct SoundOutput { AudioHandle Handle; void* Buffer; uint32_t BufferSize; };
-#define AUDIO_MAX_HANDLES 6
-#define AUDIO_DEF_ELEMS 0
-#define HANDLE_INV -1
-#define SOUND_INV { HANDLE_INV, NULL, 0 }
+/* All sounds are mixed together into a single stereo output stream by the mixer thread. */
+#define MIXER_SAMPLE_RATE 44100
+/* Number of frames mixed at once. Smaller means less latency, but more overhead. */
+#define MIXER_FRAMES 1024
+/* Max number of sounds that can be playing at the same time. */
+/* When all voices are in use, the voice closest to finishing is replaced. */
+#define MIXER_MAX_VOICES 32
+
+struct SoundVoice {
+	struct Sound* Sound; /* Sound being played, NULL if this voice is free */
+	int Pos, Frac;       /* Position in source frames, and fraction of a frame (0-65535) */
+	int Step;            /* Source frames to advance per output frame, as 16.16 fixed point */
+	int Volume;          /* Volume to play at, from 0-256 */
+};
 
 static struct Soundboard digBoard, stepBoard;
-static struct SoundOutput monoOutputs[AUDIO_MAX_HANDLES]   = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
-static struct SoundOutput stereoOutputs[AUDIO_MAX_HANDLES] = { SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV, SOUND_INV };
+static struct SoundVoice mixer_voices[MIXER_MAX_VOICES];
+static AudioHandle mixer_out;
+static void* mixer_thread;
+static void* mixer_waitable;
+static void* mixer_lock;
+static volatile bool mixer_pendingStop, mixer_joining;
+static volatile int mixer_active;
 
 CC_NOINLINE static void Sounds_Fail(ReturnCode res) {
 	Logger_Warn(res, "playing sounds");
 	Chat_AddRaw("&cDisabling sounds");
-	Audio_SetSounds(0);
+	Audio_SoundsVolume = 0;
 }
 
-static void Sounds_PlayRaw(struct SoundOutput* output, struct Sound* snd, struct AudioFormat* fmt, int volume) {
-	uint32_t expandBy;
-	void* data = snd->Data;
-	ReturnCode res;
+static void Mixer_MixVoice(struct SoundVoice* voice, int32_t* dst, int frames) {
+	struct Sound* snd = voice->Sound;
+	int16_t* src = (int16_t*)snd->Data;
+	int channels = snd->Format.Channels;
+	int srcFrames = snd->DataSize / (2 * channels);
+	int idx = voice->Pos, frac = voice->Frac, step = voice->Step;
+	int i, t, volume = voice->Volume;
+	int l1, l2, r1, r2, l, r;
+
+	for (i = 0; i < frames; i++, dst += 2) {
+		if (idx >= srcFrames - 1) { voice->Sound = NULL; return; }
+		/* Linearly interpolate between the two nearest source frames */
+		/* (15 bit weight, so the product can't overflow 32 bits) */
+		t  = frac >> 1;
+		l1 = src[idx * channels]; l2 = src[(idx + 1) * channels];
+		l  = l1 + (((l2 - l1) * t) >> 15);
+
+		if (channels == 2) {
+			r1 = src[idx * 2 + 1]; r2 = src[idx * 2 + 3];
+			r  = r1 + (((r2 - r1) * t) >> 15);
+		} else {
+			r = l;
+		}
 
-	if ((res = Audio_SetFormat(output->Handle, fmt))) { Sounds_Fail(res); return; }
-	
-	/* copy to temp buffer to apply volume */
-	if (volume < 100) {		
-		if (output->BufferSize < snd->DataSize) {
-			expandBy       = snd->DataSize - output->BufferSize;
-			output->Buffer = Utils_Resize(output->Buffer, &output->BufferSize, 
-											1, AUDIO_DEF_ELEMS, expandBy);
+		dst[0] += (l * volume) >> 8;
+		dst[1] += (r * volume) >> 8;
+
+		frac += step;
+		idx  += frac >> 16; frac &= 0xFFFF;
+	}
+	voice->Pos = idx; voice->Frac = frac;
+}
+
+/* Mixes all playing voices into the given buffer, returning number of voices still playing */
+static int Mixer_Mix(int16_t* data, int32_t* mix) {
+	int i, sample, active = 0;
+	Mem_Set(mix, 0, MIXER_FRAMES * 2 * sizeof(int32_t));
+
+	Mutex_Lock(mixer_lock);
+	{
+		for (i = 0; i < MIXER_MAX_VOICES; i++) {
+			if (!mixer_voices[i].Sound) continue;
+			Mixer_MixVoice(&mixer_voices[i], mix, MIXER_FRAMES);
+			if (mixer_voices[i].Sound) active++;
 		}
-		data = output->Buffer;
+		mixer_active = active;
+	}
+	Mutex_Unlock(mixer_lock);
 
-		Mem_Copy(data, snd->Data, snd->DataSize);
-		if (fmt->BitsPerSample == 8) {
-			Volume_Mix8(data,  snd->DataSize,     volume);
-		} else {
-			Volume_Mix16(data, snd->DataSize / 2, volume);
+	for (i = 0; i < MIXER_FRAMES * 2; i++) {
+		sample  = mix[i];
+		Math_Clamp(sample, -32768, 32767);
+		data[i] = sample;
+	}
+	return active;
+}
+
+static void Mixer_RunLoop(void) {
+	struct AudioFormat fmt;
+	int16_t* data;
+	int32_t* mix;
+	int i, next;
+	bool completed, finished;
+	ReturnCode res;
+
+	data = Mem_Alloc(MIXER_FRAMES * 2 * AUDIO_MAX_BUFFERS, 2, "mixer output");
+	mix  = Mem_Alloc(MIXER_FRAMES * 2, 4, "mixer accumulator");
+	Audio_Init(&mixer_out, AUDIO_MAX_BUFFERS);
+
+	fmt.Channels      = 2;
+	fmt.SampleRate    = MIXER_SAMPLE_RATE;
+	fmt.BitsPerSample = 16;
+	if ((res = Audio_SetFormat(mixer_out, &fmt))) goto cleanup;
+
+	while (!mixer_pendingStop) {
+		/* Sleep until a sound is played */
+		if (!mixer_active) { Waitable_Wait(mixer_waitable); continue; }
+		next = -1;
+
+		for (i = 0; i < AUDIO_MAX_BUFFERS; i++) {
+			if ((res = Audio_IsCompleted(mixer_out, i, &completed))) goto cleanup;
+			if (completed) { next = i; break; }
 		}
+		if (next == -1) { Thread_Sleep(5); continue; }
+
+		/* Output needs to be restarted if all the queued audio has already been played */
+		if ((res = Audio_IsFinished(mixer_out, &finished))) goto cleanup;
+		Mixer_Mix(&data[MIXER_FRAMES * 2 * next], mix);
+
+		res = Audio_BufferData(mixer_out, next, &data[MIXER_FRAMES * 2 * next], MIXER_FRAMES * 4);
+		if (res) goto cleanup;
+		if (finished && (res = Audio_Play(mixer_out))) goto cleanup;
 	}
 
-	if ((res = Audio_BufferData(output->Handle, 0, data, snd->DataSize))) { Sounds_Fail(res); return; }
-	if ((res = Audio_Play(output->Handle)))                               { Sounds_Fail(res); return; }
+cleanup:
+	if (res) Sounds_Fail(res);
+	Audio_StopAndFree(mixer_out);
+	Mem_Free(data);
+	Mem_Free(mix);
+
+	/* Sounds_Free may be about to join this thread, so only detach when it isn't */
+	Mutex_Lock(mixer_lock);
+	if (!mixer_joining) {
+		Thread_Detach(mixer_thread);
+		mixer_thread = NULL;
+	}
+	Mutex_Unlock(mixer_lock);
 }
 
 static void Sounds_Play(uint8_t type, struct Soundboard* board) {
+	struct SoundVoice* voice;
 	struct Sound* snd;
-	struct AudioFormat  fmt;
-	struct SoundOutput* outputs;
-	struct SoundOutput* output;
-	struct AudioFormat* l;
-
-	bool finished;
-	int i, volume;
-	ReturnCode res;
+	int i, volume, sampleRate, best, left, bestLeft;
 
 	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
 	snd = Soundboard_PickRandom(board, type);
-	if (!snd) return;
+	if (!snd || !mixer_thread) return;
 
-	fmt     = snd->Format;
-	volume  = Audio_SoundsVolume;
-	outputs = fmt.Channels == 1 ? monoOutputs : stereoOutputs;
+	volume     = Audio_SoundsVolume;
+	sampleRate = snd->Format.SampleRate;
 
 	if (board == &digBoard) {
-		if (type == SOUND_METAL) fmt.SampleRate = (fmt.SampleRate * 6) / 5;
-		else fmt.SampleRate = (fmt.SampleRate * 4) / 5;
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 6) / 5;
+		else sampleRate = (sampleRate * 4) / 5;
 	} else {
 		volume /= 2;
-		if (type == SOUND_METAL) fmt.SampleRate = (fmt.SampleRate * 7) / 5;
+		if (type == SOUND_METAL) sampleRate = (sampleRate * 7) / 5;
 	}
 
-	/* Try to play on fresh device, or device with same data format */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		if (output->Handle == HANDLE_INV) {
-			Audio_Init(&output->Handle, 1);
-		} else {
-			res = Audio_IsFinished(output->Handle, &finished);
+	Mutex_Lock(mixer_lock);
+	{
+		/* Use a free voice, or steal the voice with the least left to play */
+		best = 0; bestLeft = Int32_MaxValue;
+		for (i = 0; i < MIXER_MAX_VOICES; i++) {
+			voice = &mixer_voices[i];
+			if (!voice->Sound) { best = i; break; }
 
-			if (res) { Sounds_Fail(res); return; }
-			if (!finished) continue;
+			left = voice->Sound->DataSize / (2 * voice->Sound->Format.Channels) - voice->Pos;
+			if (left < bestLeft) { best = i; bestLeft = left; }
 		}
 
-		l = Audio_GetFormat(output->Handle);
-		if (!l->Channels || AudioFormat_Eq(l, &fmt)) {
-			Sounds_PlayRaw(output, snd, &fmt, volume); return;
-		}
-	}
-
-	/* Try again with all devices, even if need to recreate one (expensive) */
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		output = &outputs[i];
-		res = Audio_IsFinished(output->Handle, &finished);
-
-		if (res) { Sounds_Fail(res); return; }
-		if (!finished) continue;
-
-		Sounds_PlayRaw(output, snd, &fmt, volume); return;
+		voice = &mixer_voices[best];
+		voice->Sound  = snd;
+		voice->Pos    = 0;
+		voice->Frac   = 0;
+		voice->Step   = (int)(((uint64_t)sampleRate << 16) / MIXER_SAMPLE_RATE);
+		voice->Volume = volume * 256 / 100;
+		mixer_active  = true;
 	}
+	Mutex_Unlock(mixer_lock);
+	Waitable_Signal(mixer_waitable);
 }
 
 static void Audio_PlayBlockSound(void* obj, Vector3I coords, BlockID old, BlockID now) {
@@ -304,32 +402,41 @@ static void Audio_PlayBlockSound(void* obj, Vector3I coords, BlockID old, BlockI
 	}
 }
 
-static void Sounds_FreeOutputs(struct SoundOutput* outputs) {
-	int i;
-	for (i = 0; i < AUDIO_MAX_HANDLES; i++) {
-		if (outputs[i].Handle == HANDLE_INV) continue;
-
-		Audio_StopAndFree(outputs[i].Handle);
-		outputs[i].Handle = HANDLE_INV;
-
-		Mem_Free(outputs[i].Buffer);
-		outputs[i].Buffer     = NULL;
-		outputs[i].BufferSize = 0;
-	}
-}
-
 static void Sounds_Init(void) {
 	const static String dig  = String_FromConst("dig_");
 	const static String step = String_FromConst("step_");
 
+	Mutex_Lock(mixer_lock);
+	if (!mixer_thread) {
+		mixer_joining     = false;
+		mixer_pendingStop = false;
+		mixer_thread      = Thread_Start(Mixer_RunLoop, false);
+	}
+	Mutex_Unlock(mixer_lock);
+
 	if (digBoard.Count || stepBoard.Count) return;
 	Soundboard_Init(&digBoard,  &dig,  &files);
 	Soundboard_Init(&stepBoard, &step, &files);
 }
 
 static void Sounds_Free(void) {
-	Sounds_FreeOutputs(monoOutputs);
-	Sounds_FreeOutputs(stereoOutputs);
+	void* thread;
+	int i;
+
+	Mutex_Lock(mixer_lock);
+	{
+		mixer_joining     = true;
+		mixer_pendingStop = true;
+		thread            = mixer_thread;
+	}
+	Mutex_Unlock(mixer_lock);
+	Waitable_Signal(mixer_waitable);
+
+	if (thread) Thread_Join(thread);
+	mixer_thread = NULL;
+
+	for (i = 0; i < MIXER_MAX_VOICES; i++) { mixer_voices[i].Sound = NULL; }
+	mixer_active = 0;
 }
 
 void Audio_SetSounds(int volume) {
@@ -541,6 +648,8 @@ static void AudioManager_Init(void) {
 		Directory_Enum(&path, NULL, AudioManager_FilesCallback);
 	}
 	music_waitable = Waitable_Create();
+	mixer_waitable = Waitable_Create();
+	mixer_lock     = Mutex_Create();
 
 	volume = AudioManager_GetVolume(OPT_MUSIC_VOLUME, OPT_USE_MUSIC);
 	Audio_SetMusic(volume);
@@ -553,6 +662,8 @@ static void AudioManager_Free(void) {
 	Music_Free();
 	Sounds_Free();
 	Waitable_Free(music_waitable);
+	Waitable_Free(mixer_waitable);
+	Mutex_Free(mixer_lock);
 	Event_UnregisterBlock(&UserEvents.BlockChanged, NULL, Audio_PlayBlockSound);
 }
 
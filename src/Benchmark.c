@@ -0,0 +1,277 @@
+#include "Benchmark.h"
+#include "Platform.h"
+#include "Stream.h"
+#include "Errors.h"
+#include "Logger.h"
+#include "Funcs.h"
+#include "Game.h"
+#include "Gui.h"
+#include "World.h"
+#include "Entity.h"
+#include "Window.h"
+#include "Options.h"
+#include "Profiler.h"
+
+bool Benchmark_Active;
+const static char* bench_names[BENCH_STAGE_COUNT] = {
+	"MapUpdate", "MapNormal", "MapTranslucent", "Entities", "Particles", "Env", "Gui", "Other", "Frame"
+};
+
+struct BenchPoint { Vector3 Pos; float Yaw, Pitch; int Frames; };
+#define BENCH_MAX_POINTS 256
+#define BENCH_DEF_FRAMES 60
+static struct BenchPoint bench_points[BENCH_MAX_POINTS];
+static int bench_pointsCount;
+
+static bool bench_pending;
+static int bench_frame, bench_totalFrames;
+static float* bench_times; /* Milliseconds each stage took in each frame, in BENCH_STAGE_COUNT sized rows */
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Camera path-------------------------------------------------------*
+*#########################################################################################################################*/
+static bool Benchmark_ParsePoint(const String* line, struct BenchPoint* p) {
+	String parts[6];
+	int count = String_UNSAFE_Split(line, ' ', parts, 6);
+	if (count < 5) return false;
+
+	p->Frames = BENCH_DEF_FRAMES;
+	if (count == 6 && (!Convert_ParseInt(&parts[5], &p->Frames) || p->Frames <= 0)) return false;
+
+	return
+		Convert_ParseFloat(&parts[0], &p->Pos.X) && Convert_ParseFloat(&parts[1], &p->Pos.Y) &&
+		Convert_ParseFloat(&parts[2], &p->Pos.Z) && Convert_ParseFloat(&parts[3], &p->Yaw)   &&
+		Convert_ParseFloat(&parts[4], &p->Pitch);
+}
+
+static void Benchmark_LoadPath(const String* path) {
+	String line; char lineBuffer[STRING_SIZE];
+	uint8_t buffer[2048];
+	struct Stream stream, buffered;
+	ReturnCode res;
+
+	res = Stream_OpenFile(&stream, path);
+	if (res) { Logger_Warn2(res, "opening", path); return; }
+
+	/* ReadLine reads single byte at a time */
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	String_InitArray(line, lineBuffer);
+
+	while (bench_pointsCount < BENCH_MAX_POINTS) {
+		res = Stream_ReadLine(&buffered, &line);
+		if (res == ERR_END_OF_STREAM) break;
+		if (res) { Logger_Warn2(res, "reading from", path); break; }
+
+		String_UNSAFE_TrimStart(&line);
+		String_UNSAFE_TrimEnd(&line);
+		if (!line.length || line.buffer[0] == '#') continue;
+
+		if (Benchmark_ParsePoint(&line, &bench_points[bench_pointsCount])) {
+			bench_pointsCount++;
+		} else {
+			Platform_Log1("Invalid camera path point: %s", &line);
+		}
+	}
+
+	res = stream.Close(&stream);
+	if (res) { Logger_Warn2(res, "closing", path); }
+}
+
+/* Catmull-Rom spline through b and c, where a and d are the points before and after */
+static float Benchmark_Spline(float a, float b, float c, float d, float t) {
+	float t2 = t * t, t3 = t2 * t;
+	return 0.5f * ((2 * b) + (c - a) * t + (2*a - 5*b + 4*c - d) * t2 + (3*b - a - 3*c + d) * t3);
+}
+
+#define Bench_Point(i) &bench_points[max(0, min(i, bench_pointsCount - 1))]
+static void Benchmark_CalcPoint(int frame, struct BenchPoint* p) {
+	struct BenchPoint *a, *b, *c, *d;
+	float t;
+	int i;
+
+	/* Find the segment of the path the frame is in */
+	for (i = 0; i < bench_pointsCount - 1; i++) {
+		if (frame < bench_points[i].Frames) break;
+		frame -= bench_points[i].Frames;
+	}
+
+	a = Bench_Point(i - 1); b = Bench_Point(i);
+	c = Bench_Point(i + 1); d = Bench_Point(i + 2);
+	t = (float)frame / b->Frames;
+
+	p->Pos.X = Benchmark_Spline(a->Pos.X, b->Pos.X, c->Pos.X, d->Pos.X, t);
+	p->Pos.Y = Benchmark_Spline(a->Pos.Y, b->Pos.Y, c->Pos.Y, d->Pos.Y, t);
+	p->Pos.Z = Benchmark_Spline(a->Pos.Z, b->Pos.Z, c->Pos.Z, d->Pos.Z, t);
+	p->Yaw   = Benchmark_Spline(a->Yaw,   b->Yaw,   c->Yaw,   d->Yaw,   t);
+	p->Pitch = Benchmark_Spline(a->Pitch, b->Pitch, c->Pitch, d->Pitch, t);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------Results---------------------------------------------------------*
+*#########################################################################################################################*/
+static float* bench_sorted;
+static void Benchmark_QuickSort(int left, int right) {
+	float* keys = bench_sorted; float key;
+
+	while (left < right) {
+		int i = left, j = right;
+		float pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]) i++;
+			while (pivot < keys[j]) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(Benchmark_QuickSort)
+	}
+}
+
+static float Benchmark_Percentile(int percent) {
+	int i = (bench_totalFrames - 1) * percent / 100;
+	return bench_sorted[i];
+}
+
+static void Benchmark_Save(void) {
+	const static String path = String_FromConst("benchmark.csv");
+	String line; char lineBuffer[256];
+	struct Stream stream;
+	float mean, p50, p95, p99, maxTime;
+	int i, stage;
+	ReturnCode res;
+
+	res = Stream_CreateFile(&stream, &path);
+	if (res) { Logger_Warn2(res, "creating", &path); return; }
+	String_InitArray(line, lineBuffer);
+
+	String_AppendConst(&line, "stage,mean_ms,p50_ms,p95_ms,p99_ms,max_ms");
+	res = Stream_WriteLine(&stream, &line);
+	bench_sorted = Mem_Alloc(bench_totalFrames, sizeof(float), "benchmark sorted times");
+
+	for (stage = 0; stage < BENCH_STAGE_COUNT && !res; stage++) {
+		mean = 0.0f;
+		for (i = 0; i < bench_totalFrames; i++) {
+			bench_sorted[i] = bench_times[i * BENCH_STAGE_COUNT + stage];
+			mean += bench_sorted[i];
+		}
+
+		mean /= bench_totalFrames;
+		Benchmark_QuickSort(0, bench_totalFrames - 1);
+		p50 = Benchmark_Percentile(50); p95 = Benchmark_Percentile(95);
+		p99 = Benchmark_Percentile(99); maxTime = bench_sorted[bench_totalFrames - 1];
+
+		line.length = 0;
+		String_Format4(&line, "%c,%f3,%f3,%f3", bench_names[stage], &mean, &p50, &p95);
+		String_Format2(&line, ",%f3,%f3", &p99, &maxTime);
+		Platform_Log1("  %s", &line);
+		res = Stream_WriteLine(&stream, &line);
+	}
+
+	if (res) Logger_Warn2(res, "writing to", &path);
+	Mem_Free(bench_sorted);
+
+	res = stream.Close(&stream);
+	if (res) { Logger_Warn2(res, "closing", &path); }
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Recording--------------------------------------------------------*
+*#########################################################################################################################*/
+void Benchmark_Init(const String* pathFile) {
+	int i;
+	Benchmark_LoadPath(pathFile);
+	if (!bench_pointsCount) { Platform_LogConst("Camera path is empty, not running benchmark"); return; }
+
+	for (i = 0; i < bench_pointsCount - 1; i++) {
+		bench_totalFrames += bench_points[i].Frames;
+	}
+	/* Need at least one frame, even if the path is only a single point */
+	bench_totalFrames = max(bench_totalFrames, 1);
+	bench_pending     = true;
+}
+
+static void Benchmark_Start(void) {
+	bench_pending    = false;
+	Benchmark_Active = true;
+	bench_frame      = 0;
+	bench_times      = Mem_AllocCleared(bench_totalFrames * BENCH_STAGE_COUNT, sizeof(float), "benchmark times");
+
+	/* Frame limiting would make all the frame times meaningless */
+	Game_SetFpsLimit(FPS_LIMIT_NONE);
+	Platform_Log1("Starting benchmark of %i frames", &bench_totalFrames);
+}
+
+static void Benchmark_Finish(void) {
+	Benchmark_Active = false;
+	Platform_Log1("Finished benchmark of %i frames", &bench_totalFrames);
+	Benchmark_Save();
+
+	Mem_Free(bench_times);
+	bench_times = NULL;
+	Window_Close();
+}
+
+/* Returns the stage a profiler zone with the given name is timed as, or -1 if not a stage */
+static int Benchmark_GetStage(const char* name) {
+	String str = String_FromReadonly(name);
+	int i;
+
+	for (i = 0; i < BENCH_OTHER; i++) {
+		if (String_CaselessEqualsConst(&str, bench_names[i])) return i;
+	}
+	return -1;
+}
+
+static float Benchmark_ZoneTime(struct ProfilerZone* zone) {
+	return Stopwatch_ElapsedMicroseconds(zone->Beg, zone->End) / 1000.0f;
+}
+
+void Benchmark_BeginFrame(void) {
+	struct Entity* e = &LocalPlayer_Instance.Base;
+	struct LocationUpdate update;
+	struct BenchPoint p;
+	if (!Benchmark_Active) return;
+
+	Benchmark_CalcPoint(bench_frame, &p);
+	LocationUpdate_MakePosAndOri(&update, p.Pos, p.Yaw, p.Pitch, false);
+	e->VTABLE->SetLocation(e, &update, false);
+}
+
+void Benchmark_EndFrame(void) {
+	struct ProfilerZone* zones;
+	float* times;
+	float elapsed;
+	int i, count, stage, stageDepth = -1;
+
+	/* Wait until the map has finished loading, then record from the start of the next frame */
+	if (bench_pending && World.Blocks && !Gui_Active) { Benchmark_Start(); return; }
+	if (!Benchmark_Active) return;
+
+	count = Profiler_GetFrame(0, &zones);
+	times = &bench_times[bench_frame * BENCH_STAGE_COUNT];
+
+	/* zones[0] is the frame itself */
+	for (i = 1; i < count; i++) {
+		/* Zones nested inside a stage are already included in that stage's time */
+		if (stageDepth >= 0 && zones[i].Depth > stageDepth) continue;
+		stageDepth = -1;
+
+		stage = Benchmark_GetStage(zones[i].Name);
+		if (stage == -1) continue;
+		times[stage] += Benchmark_ZoneTime(&zones[i]);
+		stageDepth    = zones[i].Depth;
+	}
+
+	elapsed = count ? Benchmark_ZoneTime(&zones[0]) : 0.0f;
+	times[BENCH_FRAME] = elapsed;
+
+	for (i = 0; i < BENCH_OTHER; i++) { elapsed -= times[i]; }
+	times[BENCH_OTHER] = max(elapsed, 0.0f);
+
+	bench_frame++;
+	if (bench_frame == bench_totalFrames) Benchmark_Finish();
+}
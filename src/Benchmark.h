@@ -0,0 +1,26 @@
+#ifndef CC_BENCHMARK_H
+#define CC_BENCHMARK_H
+#include "String.h"
+/* Flies the camera along a scripted path through a map, and records how long each stage of rendering took.
+   Stages are timed using the profiler zones with the same names. (e.g. Profiler_Begin("MapNormal"))
+   Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
+*/
+
+enum BenchmarkStage {
+	BENCH_MAP_UPDATE, BENCH_MAP_NORMAL, BENCH_MAP_TRANSLUCENT, BENCH_ENTITIES,
+	BENCH_PARTICLES, BENCH_ENV, BENCH_GUI, BENCH_OTHER, BENCH_FRAME, BENCH_STAGE_COUNT
+};
+
+/* Whether a flythrough is currently being recorded. */
+extern bool Benchmark_Active;
+/* Loads the camera path from the given file, then starts recording once a map has loaded. */
+/* Each line of the file is "x y z yaw pitch [frames]", where frames (default 60) is how many */
+/* frames the camera takes to move to the next point. Lines starting with # are ignored. */
+/* NOTE: Results are saved to benchmark.csv, then the window is closed. */
+void Benchmark_Init(const String* pathFile);
+/* Moves the camera to where it should be for the current frame. */
+void Benchmark_BeginFrame(void);
+/* Records how long each stage took in the frame just recorded by the profiler, */
+/* and finishes the benchmark after the last frame. */
+void Benchmark_EndFrame(void);
+#endif
@@ -13,73 +13,104 @@
 #include "Logger.h"
 #include "Vectors.h"
 #include "Chat.h"
+#include "Profiler.h"
+#include "Server.h"
+
+/* Number of slots in a tick wheel. Must be a power of two, and greater than the longest delay + 1 */
+#define TICKWHEEL_SLOTS 32
+#define TICKWHEEL_MASK (TICKWHEEL_SLOTS - 1)
+
+/* Block indices scheduled to be ticked on the same physics tick. */
+struct TickSlot {
+	int* Entries; /* Buffer holding the block indices */
+	int Count;    /* Number of used elements */
+	int Capacity; /* Max number of elements in the buffer */
+};
 
-/* Data for a resizable queue, used for liquid physic tick entries. */
-struct TickQueue {
-	uint32_t* Entries;     /* Buffer holding the items in the tick queue */
-	int EntriesSize; /* Max number of elements in the buffer */
-	int EntriesMask; /* EntriesSize - 1, as EntriesSize is always a power of two */
-	int Size;        /* Number of used elements */
-	int Head;        /* Head index into the buffer */
-	int Tail;        /* Tail index into the buffer */
+/* Timing wheel used for liquid physic tick entries. */
+/* Entries are only touched when the tick they are scheduled for is reached. */
+struct TickWheel {
+	struct TickSlot Slots[TICKWHEEL_SLOTS];
+	int Size; /* Total number of entries across all slots */
 };
 
-static void TickQueue_Init(struct TickQueue* queue) {
-	queue->Entries     = NULL;
-	queue->EntriesSize = 0;
-	queue->EntriesMask = 0;
-	queue->Head = 0;
-	queue->Tail = 0;
-	queue->Size = 0;
+static void TickWheel_Init(struct TickWheel* wheel) {
+	Mem_Set(wheel, 0, sizeof(struct TickWheel));
 }
 
-static void TickQueue_Clear(struct TickQueue* queue) {
-	if (!queue->Entries) return;
-	Mem_Free(queue->Entries);
-	TickQueue_Init(queue);
+static void TickWheel_Clear(struct TickWheel* wheel) {
+	int i;
+	for (i = 0; i < TICKWHEEL_SLOTS; i++) {
+		Mem_Free(wheel->Slots[i].Entries);
+	}
+	TickWheel_Init(wheel);
 }
 
-static void TickQueue_Resize(struct TickQueue* queue) {
-	uint32_t* entries;
-	int i, idx, capacity;
+static void TickWheel_Add(struct TickWheel* wheel, int tick, int index) {
+	struct TickSlot* slot = &wheel->Slots[tick & TICKWHEEL_MASK];
 
-	if (queue->EntriesSize >= (Int32_MaxValue / 4)) {
-		Chat_AddRaw("&cToo many physics entries, clearing");
-		TickQueue_Clear(queue);
-		return;
+	if (slot->Count == slot->Capacity) {
+		if (slot->Capacity >= (Int32_MaxValue / 8)) {
+			Chat_AddRaw("&cToo many physics entries, clearing");
+			TickWheel_Clear(wheel);
+			return;
+		}
+
+		slot->Capacity = slot->Capacity ? slot->Capacity * 2 : 32;
+		slot->Entries  = Mem_Realloc(slot->Entries, slot->Capacity, 4, "physics tick wheel");
 	}
+	slot->Entries[slot->Count++] = index;
+	wheel->Size++;
+}
 
-	capacity = queue->EntriesSize * 2;
-	if (capacity < 32) capacity = 32;
-	entries = Mem_Alloc(capacity, 4, "physics tick queue");
 
-	for (i = 0; i < queue->Size; i++) {
-		idx = (queue->Head + i) & queue->EntriesMask;
-		entries[i] = queue->Entries[idx];
-	}
-	Mem_Free(queue->Entries);
+/* Hash set used to skip duplicate block indices in the slot being ticked */
+static int* tickSeen;
+static int tickSeenMask;
+
+static int tickSeenCapacity;
 
-	queue->Entries     = entries;
-	queue->EntriesSize = capacity;
-	queue->EntriesMask = capacity - 1; /* capacity is power of two */
-	queue->Head = 0;
-	queue->Tail = queue->Size;
+static void TickSeen_Reset(int count) {
+	int capacity = 64;
+	while (capacity < count * 2) capacity *= 2;
+
+	if (capacity > tickSeenCapacity) {
+		Mem_Free(tickSeen);
+		tickSeen         = Mem_Alloc(capacity, 4, "physics seen set");
+		tickSeenCapacity = capacity;
+	}
+	/* Only use as much of the set as needed, so ticking few entries stays cheap */
+	tickSeenMask = capacity - 1;
+	Mem_Set(tickSeen, 0xFF, capacity * 4);
 }
 
-static void TickQueue_Enqueue(struct TickQueue* queue, uint32_t item) {
-	if (queue->Size == queue->EntriesSize)
-		TickQueue_Resize(queue);
+/* Returns whether the given block index was already added to the set */
+static bool TickSeen_Add(int index) {
+	int i = (int)(((uint32_t)index * 2654435761U) & tickSeenMask);
 
-	queue->Entries[queue->Tail] = item;
-	queue->Tail = (queue->Tail + 1) & queue->EntriesMask;
-	queue->Size++;
+	for (;;) {
+		if (tickSeen[i] == index) return true;
+		if (tickSeen[i] == -1) { tickSeen[i] = index; return false; }
+		i = (i + 1) & tickSeenMask;
+	}
 }
 
-static uint32_t TickQueue_Dequeue(struct TickQueue* queue) {
-	uint32_t result = queue->Entries[queue->Head];
-	queue->Head = (queue->Head + 1) & queue->EntriesMask;
-	queue->Size--;
-	return result;
+/* Calls the given function on each unique block index scheduled for the given tick */
+static void TickWheel_Tick(struct TickWheel* wheel, int tick, void (*process)(int index)) {
+	struct TickSlot* slot = &wheel->Slots[tick & TICKWHEEL_MASK];
+	int i, count = slot->Count;
+	if (!count) return;
+
+	/* Processing an entry never schedules into the slot being ticked */
+	TickSeen_Reset(count);
+	for (i = 0; i < count; i++) {
+		if (!TickSeen_Add(slot->Entries[i])) process(slot->Entries[i]);
+		/* Wheel was cleared due to too many entries */
+		if (!slot->Entries) return;
+	}
+
+	wheel->Size -= count;
+	slot->Count  = 0;
 }
 
 
@@ -87,30 +118,126 @@ struct Physics_ Physics;
 static RNGState physics_rnd;
 static int physics_tickCount;
 static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
-static struct TickQueue lavaQ, waterQ;
+static struct TickWheel lavaQ, waterQ;
+
+/* Number of blocks with an OnRandomTick handler in each chunk */
+static uint16_t* physics_chunkTicks;
+/* Chunks which have at least one randomly tickable block */
+static int* physics_activeChunks;
+/* Index of each chunk in physics_activeChunks, or -1 if not active */
+static int* physics_activeSlots;
+static int physics_activeCount;
+static int physics_chunksX, physics_chunksY, physics_chunksZ;
+
+/* Number of physics ticks before a liquid block spreads again */
+#define PHYSICS_LAVA_DELAY  30
+#define PHYSICS_WATER_DELAY 5
+
+static void Physics_FreeChunks(void) {
+	Mem_Free(physics_chunkTicks);
+	Mem_Free(physics_activeChunks);
+	Mem_Free(physics_activeSlots);
+
+	physics_chunkTicks   = NULL;
+	physics_activeChunks = NULL;
+	physics_activeSlots  = NULL;
+	physics_activeCount  = 0;
+}
+
+static void Physics_ActivateChunk(int chunk) {
+	physics_activeSlots[chunk] = physics_activeCount;
+	physics_activeChunks[physics_activeCount++] = chunk;
+}
+
+static void Physics_DeactivateChunk(int chunk) {
+	int slot = physics_activeSlots[chunk];
+	int last = physics_activeChunks[--physics_activeCount];
+
+	physics_activeChunks[slot] = last;
+	physics_activeSlots[last]  = slot;
+	physics_activeSlots[chunk] = -1;
+}
+
+static void Physics_CountChunks(void) {
+	bool tickable[256];
+	int x, y, z, cx, chunk, count;
+	int i, index = 0;
+
+	Physics_FreeChunks();
+	/* Random block ticks only happen when physics is enabled in singleplayer */
+	if (!Physics.Enabled || !Server.IsSinglePlayer || !World.Blocks) return;
+	for (i = 0; i < 256; i++) { tickable[i] = Physics.OnRandomTick[i] != NULL; }
+
+	physics_chunksX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	physics_chunksY = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
+	physics_chunksZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
+	count = physics_chunksX * physics_chunksY * physics_chunksZ;
+
+	physics_chunkTicks   = Mem_AllocCleared(count, 2, "physics chunk ticks");
+	physics_activeChunks = Mem_Alloc(count, 4, "physics active chunks");
+	physics_activeSlots  = Mem_Alloc(count, 4, "physics active slots");
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			chunk = ((y >> CHUNK_SHIFT) * physics_chunksZ + (z >> CHUNK_SHIFT)) * physics_chunksX;
+
+			for (x = 0; x < World.Width; x += CHUNK_SIZE, chunk++) {
+				count = 0;
+				for (cx = x; cx < x + CHUNK_SIZE && cx < World.Width; cx++, index++) {
+					count += tickable[World.Blocks[index]];
+				}
+				physics_chunkTicks[chunk] += count;
+			}
+		}
+	}
+
+	count = physics_chunksX * physics_chunksY * physics_chunksZ;
+	for (i = 0; i < count; i++) {
+		physics_activeSlots[i] = -1;
+		if (physics_chunkTicks[i]) Physics_ActivateChunk(i);
+	}
+}
+
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now) {
+	bool wasTickable, isTickable;
+	int chunk;
+	if (!Physics.Enabled || !Server.IsSinglePlayer || !physics_chunkTicks) return;
+
+	wasTickable = Physics.OnRandomTick[(BlockRaw)old] != NULL;
+	isTickable  = Physics.OnRandomTick[(BlockRaw)now] != NULL;
+	if (wasTickable == isTickable) return;
+
+	chunk = ((y >> CHUNK_SHIFT) * physics_chunksZ + (z >> CHUNK_SHIFT)) * physics_chunksX + (x >> CHUNK_SHIFT);
+	if (isTickable) {
+		if (!physics_chunkTicks[chunk]++) Physics_ActivateChunk(chunk);
+	} else if (physics_chunkTicks[chunk]) {
+		if (!--physics_chunkTicks[chunk]) Physics_DeactivateChunk(chunk);
+	}
+}
 
-#define PHYSICS_DELAY_MASK 0xF8000000UL
-#define PHYSICS_POS_MASK   0x07FFFFFFUL
-#define PHYSICS_DELAY_SHIFT 27
-#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
 
 static void Physics_OnNewMapLoaded(void* obj) {
-	TickQueue_Clear(&lavaQ);
-	TickQueue_Clear(&waterQ);
+	TickWheel_Clear(&lavaQ);
+	TickWheel_Clear(&waterQ);
+	Physics_CountChunks();
 
 	physics_maxWaterX = World.MaxX - 2;
 	physics_maxWaterY = World.MaxY - 2;
 	physics_maxWaterZ = World.MaxZ - 2;
 
 	Tree_Blocks = World.Blocks;
+#ifdef CC_TEST_PHYSICS
+	/* Benchmark checksums must be the same every run */
+	Random_Init(&physics_rnd, 1);
+#else
 	Random_InitFromCurrentTime(&physics_rnd);
+#endif
 	Tree_Rnd = &physics_rnd;
 }
 
 void Physics_SetEnabled(bool enabled) {
 	Physics.Enabled = enabled;
+	/* Chunk counts are not tracked while disabled, so must be recounted when enabled again */
 	Physics_OnNewMapLoaded(NULL);
 }
 
@@ -159,37 +286,33 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 }
 
 static void Physics_TickRandomBlocks(void) {
-	int lo, hi, index;
+	int i, j, chunk, lo, hi, index;
 	BlockID block;
 	PhysicsHandler tick;
 	int x, y, z, x2, y2, z2;
 
-	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
-		y2 = min(y + CHUNK_MAX, World.MaxY);
-		for (z = 0; z < World.Length; z += CHUNK_SIZE) {
-			z2 = min(z + CHUNK_MAX, World.MaxZ);
-			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
-				x2 = min(x + CHUNK_MAX, World.MaxX);
-
-				/* Inlined 3 random ticks for this chunk */
-				lo = World_Pack( x,  y,  z);
-				hi = World_Pack(x2, y2, z2);
-				
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
+	/* Ticks may activate or deactivate chunks, so iterate over a snapshot of the active set */
+	/* Chunks activated during this tick are appended after count, so are not ticked until next time */
+	int count = physics_activeCount;
 
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
+	for (i = 0; i < count && i < physics_activeCount; i++) {
+		chunk = physics_activeChunks[i];
+		x = (chunk % physics_chunksX) << CHUNK_SHIFT;
+		z = ((chunk / physics_chunksX) % physics_chunksZ) << CHUNK_SHIFT;
+		y = ((chunk / physics_chunksX) / physics_chunksZ) << CHUNK_SHIFT;
 
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-			}
+		x2 = min(x + CHUNK_MAX, World.MaxX);
+		y2 = min(y + CHUNK_MAX, World.MaxY);
+		z2 = min(z + CHUNK_MAX, World.MaxZ);
+		lo = World_Pack( x,  y,  z);
+		hi = World_Pack(x2, y2, z2);
+
+		/* 3 random ticks for this chunk */
+		for (j = 0; j < 3; j++) {
+			index = Random_Range(&physics_rnd, lo, hi);
+			block = World.Blocks[index];
+			tick = Physics.OnRandomTick[block];
+			if (tick) tick(index, block);
 		}
 	}
 }
@@ -220,16 +343,9 @@ static void Physics_DoFalling(int index, BlockID block) {
 	Physics_ActivateNeighbours(x, y, z, start);
 }
 
-static bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
-	uint32_t item = TickQueue_Dequeue(queue);
-	*posIndex     = (int)(item & PHYSICS_POS_MASK);
-
-	if (item >= PHYSICS_ONE_DELAY) {
-		item -= PHYSICS_ONE_DELAY;
-		TickQueue_Enqueue(queue, item);
-		return false;
-	}
-	return true;
+/* Schedules the given block to be ticked after the given number of physics ticks */
+static void Physics_Schedule(struct TickWheel* wheel, int index, int delay) {
+	TickWheel_Add(wheel, physics_tickCount + 1 + delay, index);
 }
 
 
@@ -318,7 +434,7 @@ static void Physics_HandleMushroom(int index, BlockID block) {
 
 
 static void Physics_PlaceLava(int index, BlockID block) {
-	TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | index);
+	Physics_Schedule(&lavaQ, index, PHYSICS_LAVA_DELAY);
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
@@ -326,7 +442,7 @@ static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
 	if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
 		Game_UpdateBlock(x, y, z, BLOCK_STONE);
 	} else if (Blocks.Collide[block] == COLLIDE_GAS) {
-		TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | posIndex);
+		Physics_Schedule(&lavaQ, posIndex, PHYSICS_LAVA_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_LAVA);
 	}
 }
@@ -342,21 +458,15 @@ static void Physics_ActivateLava(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateLava(index - World.OneY, x, y - 1, z);
 }
 
-static void Physics_TickLava(void) {
-	int i, count = lavaQ.Size;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
-			Physics_ActivateLava(index, block);
-		}
-	}
+static void Physics_TickLava(int index) {
+	BlockID block = World.Blocks[index];
+	if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) return;
+	Physics_ActivateLava(index, block);
 }
 
 
 static void Physics_PlaceWater(int index, BlockID block) {
-	TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | index);
+	Physics_Schedule(&waterQ, index, PHYSICS_WATER_DELAY);
 }
 
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
@@ -376,7 +486,7 @@ static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
 			}
 		}
 
-		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
+		Physics_Schedule(&waterQ, posIndex, PHYSICS_WATER_DELAY);
 		Game_UpdateBlock(x, y, z, BLOCK_WATER);
 	}
 }
@@ -392,16 +502,10 @@ static void Physics_ActivateWater(int index, BlockID block) {
 	if (y > 0)          Physics_PropagateWater(index - World.OneY,  x,     y - 1, z);
 }
 
-static void Physics_TickWater(void) {
-	int i, count = waterQ.Size;
-	for (i = 0; i < count; i++) {
-		int index;
-		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
-			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
-			Physics_ActivateWater(index, block);
-		}
-	}
+static void Physics_TickWater(int index) {
+	BlockID block = World.Blocks[index];
+	if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) return;
+	Physics_ActivateWater(index, block);
 }
 
 
@@ -436,7 +540,7 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					index = World_Pack(xx, yy, zz);
 					block = World.Blocks[index];
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
+						Physics_Schedule(&waterQ, index, 1);
 					}
 				}
 			}
@@ -509,8 +613,8 @@ static void Physics_HandleTnt(int index, BlockID block) {
 void Physics_Init(void) {
 	Event_RegisterVoid(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
 	Physics.Enabled = Options_GetBool(OPT_BLOCK_PHYSICS, true);
-	TickQueue_Init(&lavaQ);
-	TickQueue_Init(&waterQ);
+	TickWheel_Init(&lavaQ);
+	TickWheel_Init(&waterQ);
 
 	Physics.OnPlace[BLOCK_SAND]        = Physics_DoFalling;
 	Physics.OnPlace[BLOCK_GRAVEL]      = Physics_DoFalling;
@@ -551,15 +655,23 @@ void Physics_Init(void) {
 
 void Physics_Free(void) {
 	Event_UnregisterVoid(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+	Physics_FreeChunks();
+	TickWheel_Clear(&lavaQ);
+	TickWheel_Clear(&waterQ);
+
+	Mem_Free(tickSeen);
+	tickSeen         = NULL;
+	tickSeenCapacity = 0;
 }
 
 void Physics_Tick(void) {
 	if (!Physics.Enabled || !World.Blocks) return;
+	Profiler_Begin("Physics");
 
-	/*if ((tickCount % 5) == 0) {*/
-	Physics_TickLava();
-	Physics_TickWater();
-	/*}*/
 	physics_tickCount++;
+
+	TickWheel_Tick(&lavaQ,  physics_tickCount, Physics_TickLava);
+	TickWheel_Tick(&waterQ, physics_tickCount, Physics_TickWater);
 	Physics_TickRandomBlocks();
+	Profiler_End();
 }
@@ -23,6 +23,9 @@ CC_VAR extern struct Physics_ {
 
 void Physics_SetEnabled(bool enabled);
 void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Called by Game_UpdateBlock whenever a block in the world is changed. */
+/* Tracks which chunks contain blocks that can be randomly ticked. (only when physics is enabled in singleplayer) */
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now);
 void Physics_Init(void);
 void Physics_Free(void);
 void Physics_Tick(void);
@@ -14,6 +14,7 @@
 #include "Block.h"
 #include "EnvRenderer.h"
 #include "GameStructs.h"
+#include "Profiler.h"
 
 static char msgs[10][STRING_SIZE];
 String Chat_Status[3]       = { String_FromArray(msgs[0]), String_FromArray(msgs[1]), String_FromArray(msgs[2]) };
@@ -340,6 +341,28 @@ static struct ChatCommand GpuInfoCommand = {
 	}
 };
 
+static void TraceCommand_Execute(const String* args, int argsCount) {
+	const static String path = String_FromConst("profile.json");
+	ReturnCode res;
+	if (!Profiler_FramesCount) {
+		Chat_AddRaw("&cNo frames have been profiled yet, open the profiler overlay first");
+		return;
+	}
+
+	res = Profiler_DumpTrace(&path);
+	if (res) { Logger_Warn2(res, "saving trace to", &path); return; }
+	Chat_Add2("&eSaved %i profiled frames to %s", &Profiler_FramesCount, &path);
+}
+
+static struct ChatCommand TraceCommand = {
+	"Trace", TraceCommand_Execute, false,
+	{
+		"&a/client trace",
+		"&eSaves the frames recorded by the profiler overlay to profile.json",
+		"&eThis file can then be opened in chrome://tracing",
+	}
+};
+
 static void RenderTypeCommand_Execute(const String* args, int argsCount) {
 	int flags;
 	if (!argsCount) {
@@ -567,6 +590,7 @@ static void Chat_Init(void) {
 	Commands_Register(&ModelCommand);
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&TeleportCommand);
+	Commands_Register(&TraceCommand);
 
 	Chat_Logging = Options_GetBool(OPT_CHAT_LOGGING, true);
 }
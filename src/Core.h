@@ -79,6 +79,10 @@ typedef struct FontDesc_ { void* Handle; uint16_t Size, Style; } FontDesc;
 typedef struct TextureRec_ { float U1, V1, U2, V2; } TextureRec;
 
 /*#define CC_BUILD_GL11*/
+/* Uncomment to discard all audio output (e.g. for profiling the mixer without a sound device) */
+/*#define CC_BUILD_NOAUDIO*/
+/* Uncomment to use a graphics and window backend that draws nothing (e.g. for profiling without a GPU) */
+/*#define CC_BUILD_NULLGFX*/
 #ifndef CC_BUILD_MANUAL
 #ifdef _WIN32
 #define CC_BUILD_D3D9
@@ -116,6 +120,14 @@ typedef struct TextureRec_ { float U1, V1, U2, V2; } TextureRec;
 #endif
 #endif
 
+#ifdef CC_BUILD_NULLGFX
+#undef CC_BUILD_D3D9
+#undef CC_BUILD_GLMODERN
+#undef CC_BUILD_GL11
+#undef CC_BUILD_X11
+#undef CC_BUILD_SDL
+#endif
+
 #ifdef CC_BUILD_D3D9
 typedef void* GfxResourceID;
 #define GFX_NULL NULL
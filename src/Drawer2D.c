@@ -642,6 +642,148 @@ void Drawer2D_DrawClippedText(Bitmap* bmp, struct DrawTextArgs* args, int x, int
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Text cache--------------------------------------------------------*
+*#########################################################################################################################*/
+#define TEXTCACHE_MAX_ENTRIES 256
+struct TextCacheEntry {
+	struct Texture Tex; /* X and Y are unused */
+	FontDesc Font;
+	uint32_t Hash, LastUsed;
+	int RefCount, Length;
+	char* Text;
+	uint8_t Variant;
+	bool UseShadow, Bitmapped;
+	/* Whether this entry can no longer be looked up, but is still referenced. */
+	bool Stale;
+};
+static struct TextCacheEntry textCache[TEXTCACHE_MAX_ENTRIES];
+static uint32_t textCache_tick;
+
+static uint32_t TextCache_Hash(const String* text) {
+	uint32_t hash = 2166136261U;
+	int i;
+	for (i = 0; i < text->length; i++) {
+		hash = (hash ^ (uint8_t)text->buffer[i]) * 16777619U;
+	}
+	return hash;
+}
+
+static bool TextCache_Matches(struct TextCacheEntry* e, const struct DrawTextArgs* args, int variant, uint32_t hash) {
+	String text;
+	if (!e->Tex.ID || e->Stale || e->Hash != hash) return false;
+	if (e->Variant != variant || e->Length != args->Text.length) return false;
+	if (e->UseShadow != args->UseShadow || e->Bitmapped != Drawer2D_BitmappedText) return false;
+
+	if (e->Font.Handle != args->Font.Handle || e->Font.Size != args->Font.Size) return false;
+	if (e->Font.Style != args->Font.Style) return false;
+	text = String_Init(e->Text, e->Length, e->Length);
+	return String_Equals(&text, &args->Text);
+}
+
+static void TextCache_Remove(struct TextCacheEntry* e) {
+	Gfx_DeleteTexture(&e->Tex.ID);
+	Mem_Free(e->Text);
+	Mem_Set(e, 0, sizeof(struct TextCacheEntry));
+}
+
+bool TextCache_Get(struct Texture* tex, const struct DrawTextArgs* args, int variant) {
+	uint32_t hash = TextCache_Hash(&args->Text);
+	struct TextCacheEntry* e;
+	int i;
+
+	for (i = 0; i < TEXTCACHE_MAX_ENTRIES; i++) {
+		e = &textCache[i];
+		if (!TextCache_Matches(e, args, variant, hash)) continue;
+
+		e->RefCount++;
+		e->LastUsed = ++textCache_tick;
+		tex->ID     = e->Tex.ID;
+		tex->Width  = e->Tex.Width; tex->Height = e->Tex.Height;
+		tex->uv     = e->Tex.uv;
+		return true;
+	}
+	return false;
+}
+
+void TextCache_Add(const struct Texture* tex, const struct DrawTextArgs* args, int variant) {
+	struct TextCacheEntry* e;
+	struct TextCacheEntry* lru = NULL;
+	int i;
+	if (!tex->ID || !args->Text.length) return;
+
+	for (i = 0; i < TEXTCACHE_MAX_ENTRIES; i++) {
+		e = &textCache[i];
+		if (!e->Tex.ID) { lru = e; break; }
+
+		if (e->RefCount) continue;
+		if (!lru || e->LastUsed < lru->LastUsed) lru = e;
+	}
+	/* Every entry is in use, so texture just isn't cached */
+	if (!lru) return;
+	if (lru->Tex.ID) TextCache_Remove(lru);
+
+	lru->Tex       = *tex;
+	lru->Font      = args->Font;
+	lru->Hash      = TextCache_Hash(&args->Text);
+	lru->LastUsed  = ++textCache_tick;
+	lru->RefCount  = 1;
+	lru->Length    = args->Text.length;
+	lru->Variant   = variant;
+	lru->UseShadow = args->UseShadow;
+	lru->Bitmapped = Drawer2D_BitmappedText;
+
+	lru->Text = Mem_Alloc(lru->Length, 1, "text cache entry");
+	Mem_Copy(lru->Text, args->Text.buffer, lru->Length);
+}
+
+void TextCache_Release(GfxResourceID* texId) {
+	struct TextCacheEntry* e;
+	int i;
+	if (!(*texId)) return;
+
+	for (i = 0; i < TEXTCACHE_MAX_ENTRIES; i++) {
+		e = &textCache[i];
+		if (e->Tex.ID != *texId) continue;
+
+		e->RefCount--;
+		if (!e->RefCount && e->Stale) TextCache_Remove(e);
+		*texId = GFX_NULL;
+		return;
+	}
+	/* Texture wasn't made by the cache */
+	Gfx_DeleteTexture(texId);
+}
+
+static void TextCache_Clear(void) {
+	struct TextCacheEntry* e;
+	int i;
+
+	for (i = 0; i < TEXTCACHE_MAX_ENTRIES; i++) {
+		e = &textCache[i];
+		if (!e->Tex.ID) continue;
+
+		/* Still referenced entries are deleted once released */
+		if (e->RefCount) {
+			e->Stale = true;
+		} else {
+			TextCache_Remove(e);
+		}
+	}
+}
+
+static void TextCache_FontChanged(void* obj) { TextCache_Clear(); }
+static void TextCache_ColCodeChanged(void* obj, int code) { TextCache_Clear(); }
+
+void Drawer2D_MakeCachedTextTexture(struct Texture* tex, struct DrawTextArgs* args, int X, int Y) {
+	tex->X = X; tex->Y = Y;
+	if (TextCache_Get(tex, args, TEXTCACHE_PLAIN)) return;
+
+	Drawer2D_MakeTextTexture(tex, args, X, Y);
+	TextCache_Add(tex, args, TEXTCACHE_PLAIN);
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Drawer2D component----------------------------------------------------*
 *#########################################################################################################################*/
@@ -655,7 +797,8 @@ static void Drawer2D_HexEncodedCol(int i, int hex, uint8_t lo, uint8_t hi) {
 static void Drawer2D_Reset(void) {
 	BitmapCol col = BITMAPCOL_CONST(0, 0, 0, 0);
 	int i;
-	
+	TextCache_Clear();
+
 	for (i = 0; i < DRAWER2D_MAX_COLS; i++) {
 		Drawer2D_Cols[i] = col;
 	}
@@ -679,6 +822,7 @@ static void Drawer2D_TextureChanged(void* obj, struct Stream* src, const String*
 		Mem_Free(bmp.Scan0);
 	} else {
 		Drawer2D_SetFontBitmap(&bmp);
+		TextCache_Clear();
 		Event_RaiseVoid(&ChatEvents.FontChanged);
 	}
 }
@@ -720,11 +864,19 @@ static void Drawer2D_Init(void) {
 
 	Drawer2D_CheckFont();
 	Event_RegisterEntry(&TextureEvents.FileChanged, NULL, Drawer2D_TextureChanged);
+	/* Registered before other components, so cache is cleared before they recreate text */
+	Event_RegisterVoid(&ChatEvents.FontChanged,     NULL, TextCache_FontChanged);
+	Event_RegisterInt(&ChatEvents.ColCodeChanged,   NULL, TextCache_ColCodeChanged);
+	Event_RegisterVoid(&GfxEvents.ContextLost,      NULL, TextCache_FontChanged);
 }
 
 static void Drawer2D_Free(void) { 
 	Drawer2D_FreeFontBitmap();
+	TextCache_Clear();
 	Event_UnregisterEntry(&TextureEvents.FileChanged, NULL, Drawer2D_TextureChanged);
+	Event_UnregisterVoid(&ChatEvents.FontChanged,     NULL, TextCache_FontChanged);
+	Event_UnregisterInt(&ChatEvents.ColCodeChanged,   NULL, TextCache_ColCodeChanged);
+	Event_UnregisterVoid(&GfxEvents.ContextLost,      NULL, TextCache_FontChanged);
 }
 
 struct IGameComponent Drawer2D_Component = {
@@ -91,6 +91,20 @@ CC_API void Drawer2D_MakeTextTexture(struct Texture* tex, struct DrawTextArgs* a
 /* NOTE: bmp must always have power of two dimensions. */
 /* used specifies what region of the texture actually should be drawn. */
 CC_API void Drawer2D_Make2DTexture(struct Texture* tex, Bitmap* bmp, Size2D used, int X, int Y);
+/* Similar to Drawer2D_MakeTextTexture, but reuses a previously created texture for the same text if possible. */
+/* NOTE: The returned texture may be shared, so you MUST use TextCache_Release instead of Gfx_DeleteTexture. */
+CC_API void Drawer2D_MakeCachedTextTexture(struct Texture* tex, struct DrawTextArgs* args, int X, int Y);
+
+/* Kinds of texture stored in the text cache. (same text may be drawn differently) */
+enum TEXTCACHE_VARIANT { TEXTCACHE_PLAIN, TEXTCACHE_NAMETAG };
+/* Looks up a cached texture for the given text, and if found, references it and copies its ID/size/uv into tex. */
+CC_API bool TextCache_Get(struct Texture* tex, const struct DrawTextArgs* args, int variant);
+/* Adds a texture for the given text to the cache. Cache takes ownership of tex->ID. */
+/* NOTE: If all cache entries are in use, the texture is not cached. (TextCache_Release still deletes it) */
+CC_API void TextCache_Add(const struct Texture* tex, const struct DrawTextArgs* args, int variant);
+/* Releases a reference to a texture from the cache, then sets texId to 0. */
+/* If the texture was not created by the cache, it is deleted instead. */
+CC_API void TextCache_Release(GfxResourceID* texId);
 
 /* Returns whether the given colour code is used/valid. */
 bool Drawer2D_ValidColCodeAt(const String* text, int i);
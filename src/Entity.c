@@ -19,6 +19,7 @@
 #include "Stream.h"
 #include "Bitmap.h"
 #include "Logger.h"
+#include "Picking.h"
 
 const char* NameMode_Names[NAME_MODE_COUNT]   = { "None", "Hovered", "All", "AllHovered", "AllUnscaled" };
 const char* ShadowMode_Names[SHADOW_MODE_COUNT] = { "None", "SnapToBlock", "Circle", "CircleAll" };
@@ -216,6 +217,155 @@ bool Entity_TouchesAnyWater(struct Entity* e) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Entity grid-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Entities are indexed by which 16x16 column of blocks (on X/Z axes) they are in, */
+/* so that queries only need to check entities in nearby cells instead of every entity. */
+/* NOTE: Cells are only refreshed every tick, so queries always check neighbouring cells too. */
+#define GRID_CELL_SHIFT 4
+#define GRID_CELL_SIZE (1 << GRID_CELL_SHIFT)
+#define GRID_BUCKETS 256
+/* Entities larger than half a cell are always checked by queries, as they may span many cells. */
+#define GRID_LARGE_BUCKET GRID_BUCKETS
+#define GRID_NONE -1
+
+static int16_t grid_heads[GRID_BUCKETS + 1];
+static int16_t grid_next[ENTITIES_MAX_COUNT];
+static int16_t grid_bucket[ENTITIES_MAX_COUNT];
+static int grid_cellX[ENTITIES_MAX_COUNT], grid_cellZ[ENTITIES_MAX_COUNT];
+/* Used to avoid checking the same entity twice in one query */
+static uint32_t grid_stamps[ENTITIES_MAX_COUNT], grid_stamp;
+/* Bounds of the cells of all non-large entities in the grid */
+static int grid_minX, grid_minZ, grid_maxX, grid_maxZ;
+
+static int EntityGrid_Bucket(int cellX, int cellZ) {
+	uint32_t hash = ((uint32_t)cellX * 73856093U) ^ ((uint32_t)cellZ * 19349663U);
+	return hash & (GRID_BUCKETS - 1);
+}
+
+void Entities_ResetGrid(void) {
+	int i;
+	for (i = 0; i <= GRID_BUCKETS;       i++) { grid_heads[i] = GRID_NONE; }
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) { grid_bucket[i] = GRID_NONE; }
+
+	grid_minX = Int32_MaxValue; grid_maxX = Int32_MinValue;
+	grid_minZ = Int32_MaxValue; grid_maxZ = Int32_MinValue;
+}
+
+static void EntityGrid_Unlink(int id) {
+	int bucket = grid_bucket[id];
+	int16_t* link;
+	if (bucket == GRID_NONE) return;
+
+	for (link = &grid_heads[bucket]; *link != GRID_NONE; link = &grid_next[*link]) {
+		if (*link != id) continue;
+		*link = grid_next[id]; break;
+	}
+	grid_bucket[id] = GRID_NONE;
+}
+
+void Entities_UpdateGrid(EntityID id) {
+	struct Entity* e = Entities.List[id];
+	int cellX, cellZ, bucket;
+	if (!e) { EntityGrid_Unlink(id); return; }
+
+	cellX  = Math_Floor(e->Position.X) >> GRID_CELL_SHIFT;
+	cellZ  = Math_Floor(e->Position.Z) >> GRID_CELL_SHIFT;
+	bucket = max(e->Size.X, e->Size.Z) > (GRID_CELL_SIZE / 2) ? GRID_LARGE_BUCKET : EntityGrid_Bucket(cellX, cellZ);
+	if (bucket == grid_bucket[id] && cellX == grid_cellX[id] && cellZ == grid_cellZ[id]) return;
+
+	EntityGrid_Unlink(id);
+	grid_bucket[id] = bucket;
+	grid_cellX[id]  = cellX;
+	grid_cellZ[id]  = cellZ;
+	grid_next[id]      = grid_heads[bucket];
+	grid_heads[bucket] = id;
+	if (bucket == GRID_LARGE_BUCKET) return;
+
+	grid_minX = min(grid_minX, cellX); grid_maxX = max(grid_maxX, cellX);
+	grid_minZ = min(grid_minZ, cellZ); grid_maxZ = max(grid_maxZ, cellZ);
+}
+
+/* Recalculates bounds of the grid, which otherwise only grow as entities move */
+static void EntityGrid_CalcBounds(void) {
+	int i;
+	grid_minX = Int32_MaxValue; grid_maxX = Int32_MinValue;
+	grid_minZ = Int32_MaxValue; grid_maxZ = Int32_MinValue;
+
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
+		if (grid_bucket[i] == GRID_NONE || grid_bucket[i] == GRID_LARGE_BUCKET) continue;
+		grid_minX = min(grid_minX, grid_cellX[i]); grid_maxX = max(grid_maxX, grid_cellX[i]);
+		grid_minZ = min(grid_minZ, grid_cellZ[i]); grid_maxZ = max(grid_maxZ, grid_cellZ[i]);
+	}
+}
+
+/* Adds entities in the given cell that haven't been checked in this query yet */
+static int EntityGrid_AddCell(int cellX, int cellZ, EntityID* ids, int count) {
+	int id = grid_heads[EntityGrid_Bucket(cellX, cellZ)];
+
+	for (; id != GRID_NONE; id = grid_next[id]) {
+		if (grid_cellX[id] != cellX || grid_cellZ[id] != cellZ) continue;
+		if (grid_stamps[id] == grid_stamp) continue;
+
+		grid_stamps[id] = grid_stamp;
+		ids[count++]    = (EntityID)id;
+	}
+	return count;
+}
+
+static int EntityGrid_AddLarge(EntityID* ids, int count) {
+	int id = grid_heads[GRID_LARGE_BUCKET];
+
+	for (; id != GRID_NONE; id = grid_next[id]) {
+		if (grid_stamps[id] == grid_stamp) continue;
+		grid_stamps[id] = grid_stamp;
+		ids[count++]    = (EntityID)id;
+	}
+	return count;
+}
+
+/* Adds entities in the 3x3 cells around the given cell */
+static int EntityGrid_AddAround(int cellX, int cellZ, EntityID* ids, int count) {
+	int x, z;
+	for (z = cellZ - 1; z <= cellZ + 1; z++) {
+		for (x = cellX - 1; x <= cellX + 1; x++) {
+			count = EntityGrid_AddCell(x, z, ids, count);
+		}
+	}
+	return count;
+}
+
+int Entities_QueryNearby(Vector3 pos, float radius, EntityID* ids) {
+	int minX, minZ, maxX, maxZ, x, z, count = 0;
+	grid_stamp++;
+
+	minX = (Math_Floor(pos.X - radius) >> GRID_CELL_SHIFT) - 1;
+	minZ = (Math_Floor(pos.Z - radius) >> GRID_CELL_SHIFT) - 1;
+	maxX = (Math_Floor(pos.X + radius) >> GRID_CELL_SHIFT) + 1;
+	maxZ = (Math_Floor(pos.Z + radius) >> GRID_CELL_SHIFT) + 1;
+
+	minX = max(minX, grid_minX); maxX = min(maxX, grid_maxX);
+	minZ = max(minZ, grid_minZ); maxZ = min(maxZ, grid_maxZ);
+
+	for (z = minZ; z <= maxZ; z++) {
+		for (x = minX; x <= maxX; x++) {
+			count = EntityGrid_AddCell(x, z, ids, count);
+		}
+	}
+	return EntityGrid_AddLarge(ids, count);
+}
+
+/* Returns whether the ray has left the grid bounds and is only moving further away from them */
+static bool EntityGrid_RayOutside(struct RayTracer* t) {
+	if (t->X < grid_minX - 1 && t->step.X <= 0) return true;
+	if (t->X > grid_maxX + 1 && t->step.X >= 0) return true;
+	if (t->Z < grid_minZ - 1 && t->step.Z <= 0) return true;
+	if (t->Z > grid_maxZ + 1 && t->step.Z >= 0) return true;
+	return false;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Entities---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -227,18 +377,22 @@ void Entities_Tick(struct ScheduledTask* task) {
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->Tick(Entities.List[i], task->Interval);
+		Entities_UpdateGrid(i);
 	}
+	EntityGrid_CalcBounds();
 }
 
 void Entities_RenderModels(double delta, float t) {
 	int i;
 	Gfx_SetTexturing(true);
 	Gfx_SetAlphaTest(true);
+	Model_BeginBatch();
 	
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
 	}
+	Model_EndBatch();
 	Gfx_SetTexturing(false);
 	Gfx_SetAlphaTest(false);
 }
@@ -328,6 +482,7 @@ void Entities_Remove(EntityID id) {
 	Event_RaiseInt(&EntityEvents.Removed, id);
 	Entities.List[id]->VTABLE->Despawn(Entities.List[id]);
 	Entities.List[id] = NULL;
+	EntityGrid_Unlink(id);
 }
 
 EntityID Entities_GetCloset(struct Entity* src) {
@@ -336,17 +491,40 @@ EntityID Entities_GetCloset(struct Entity* src) {
 	float closestDist = MATH_POS_INF;
 	EntityID targetId = ENTITIES_SELF_ID;
 
-	float t0, t1;
-	int i;
-
-	for (i = 0; i < ENTITIES_SELF_ID; i++) { /* because we don't want to pick against local player */
-		struct Entity* entity = Entities.List[i];
-		if (!entity) continue;
-
-		if (Intersection_RayIntersectsRotatedBox(eyePos, dir, entity, &t0, &t1) && t0 < closestDist) {
-			closestDist = t0;
-			targetId = (EntityID)i;
+	EntityID ids[ENTITIES_MAX_COUNT];
+	struct RayTracer tracer;
+	Vector3 origin, flatDir;
+	float t0, t1, tEnter;
+	int i, count, steps;
+
+	grid_stamp++;
+	count   = EntityGrid_AddLarge(ids, 0);
+	origin  = Vector3_Create3(eyePos.X / GRID_CELL_SIZE, 0.0f, eyePos.Z / GRID_CELL_SIZE);
+	flatDir = Vector3_Create3(dir.X, 0.0f, dir.Z);
+	RayTracer_SetVectors(&tracer, origin, flatDir);
+	tEnter = 0.0f;
+
+	/* Walk along cells the ray passes through, until past closest entity found so far */
+	for (steps = 0; steps < 4096; steps++) {
+		if (tEnter * GRID_CELL_SIZE > closestDist || EntityGrid_RayOutside(&tracer)) break;
+		count = EntityGrid_AddAround(tracer.X, tracer.Z, ids, count);
+
+		for (i = 0; i < count; i++) {
+			struct Entity* entity = Entities.List[ids[i]];
+			/* because we don't want to pick against local player */
+			if (!entity || ids[i] == ENTITIES_SELF_ID) continue;
+
+			if (Intersection_RayIntersectsRotatedBox(eyePos, dir, entity, &t0, &t1) && t0 < closestDist) {
+				closestDist = t0;
+				targetId = ids[i];
+			}
 		}
+		count = 0;
+
+		/* Ray is pointing straight up or down */
+		if (tracer.tMax.X >= MATH_LARGENUM && tracer.tMax.Z >= MATH_LARGENUM) break;
+		tEnter = min(tracer.tMax.X, tracer.tMax.Z);
+		RayTracer_Step(&tracer);
 	}
 	return targetId;
 }
@@ -463,6 +641,95 @@ struct IGameComponent TabList_Component = {
 };
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Skin atlas--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Standard 64x64 and 64x32 skins are packed into 64x64 cells of a few shared atlas textures, */
+/* so that players with different skins can be drawn without changing the bound texture. */
+#define SKINATLAS_CELL_SIZE 64
+#define SKINATLAS_MAX_SIZE 1024
+#define SKINATLAS_MAX_PAGES 4
+#define SKINATLAS_MAX_CELLS ((SKINATLAS_MAX_SIZE / SKINATLAS_CELL_SIZE) * (SKINATLAS_MAX_SIZE / SKINATLAS_CELL_SIZE))
+
+static GfxResourceID skinAtlas_pages[SKINATLAS_MAX_PAGES];
+static bool skinAtlas_used[SKINATLAS_MAX_PAGES][SKINATLAS_MAX_CELLS];
+static int skinAtlas_width, skinAtlas_height;
+
+static void SkinAtlas_CalcSize(void) {
+	if (skinAtlas_width) return;
+	skinAtlas_width  = min(Gfx.MaxTexWidth,  SKINATLAS_MAX_SIZE);
+	skinAtlas_height = min(Gfx.MaxTexHeight, SKINATLAS_MAX_SIZE);
+}
+
+static bool SkinAtlas_FindFree(int* page, int* cell) {
+	int cells = (skinAtlas_width / SKINATLAS_CELL_SIZE) * (skinAtlas_height / SKINATLAS_CELL_SIZE);
+	int i, j;
+
+	for (i = 0; i < SKINATLAS_MAX_PAGES; i++) {
+		for (j = 0; j < cells; j++) {
+			if (skinAtlas_used[i][j]) continue;
+			*page = i; *cell = j; return true;
+		}
+	}
+	return false;
+}
+
+/* Attempts to add the given skin to the atlas, updating the entity's texture and UV scale/offset. */
+static bool SkinAtlas_Add(struct Entity* e, Bitmap* bmp) {
+	Bitmap blank;
+	int page, cell, cellsX, x, y;
+
+	if (bmp->Width != SKINATLAS_CELL_SIZE) return false;
+	if (bmp->Height != SKINATLAS_CELL_SIZE && bmp->Height != SKINATLAS_CELL_SIZE / 2) return false;
+	SkinAtlas_CalcSize();
+	if (!SkinAtlas_FindFree(&page, &cell)) return false;
+
+	if (!skinAtlas_pages[page]) {
+		Bitmap_AllocateClearedPow2(&blank, skinAtlas_width, skinAtlas_height);
+		skinAtlas_pages[page] = Gfx_CreateTexture(&blank, true, false);
+		Mem_Free(blank.Scan0);
+	}
+
+	cellsX = skinAtlas_width / SKINATLAS_CELL_SIZE;
+	x = (cell % cellsX) * SKINATLAS_CELL_SIZE;
+	y = (cell / cellsX) * SKINATLAS_CELL_SIZE;
+	Gfx_UpdateTexturePart(skinAtlas_pages[page], x, y, bmp, false);
+	skinAtlas_used[page][cell] = true;
+
+	e->TextureId = skinAtlas_pages[page];
+	e->uScale  = (float)bmp->Width  / skinAtlas_width;
+	e->vScale  = (float)bmp->Height / skinAtlas_height;
+	e->uOffset = (float)x / skinAtlas_width;
+	e->vOffset = (float)y / skinAtlas_height;
+	return true;
+}
+
+/* Frees the atlas cell used by the entity's skin. Returns false if the skin isn't in the atlas. */
+static bool SkinAtlas_Remove(struct Entity* e) {
+	int cellsX, cell, i;
+	if (!e->TextureId) return false;
+
+	for (i = 0; i < SKINATLAS_MAX_PAGES; i++) {
+		if (skinAtlas_pages[i] != e->TextureId) continue;
+
+		cellsX = skinAtlas_width / SKINATLAS_CELL_SIZE;
+		cell   = (int)(e->vOffset * skinAtlas_height / SKINATLAS_CELL_SIZE) * cellsX
+			   + (int)(e->uOffset * skinAtlas_width  / SKINATLAS_CELL_SIZE);
+		skinAtlas_used[i][cell] = false;
+		return true;
+	}
+	return false;
+}
+
+static void SkinAtlas_Free(void) {
+	int i;
+	for (i = 0; i < SKINATLAS_MAX_PAGES; i++) {
+		Gfx_DeleteTexture(&skinAtlas_pages[i]);
+	}
+	Mem_Set(skinAtlas_used, 0, sizeof(skinAtlas_used));
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------Player----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -492,6 +759,8 @@ static void Player_MakeNameTexture(struct Player* player) {
 	if (size.Width == 0) {
 		player->NameTex.ID = GFX_NULL;
 		player->NameTex.X  = PLAYER_NAME_EMPTY_TEX;
+	} else if (TextCache_Get(&player->NameTex, &args, TEXTCACHE_NAMETAG)) {
+		player->NameTex.X = 0; player->NameTex.Y = 0;
 	} else {
 		String_InitArray(colorlessName, colorlessBuffer);
 		size.Width += NAME_OFFSET; size.Height += NAME_OFFSET;
@@ -511,6 +780,7 @@ static void Player_MakeNameTexture(struct Player* player) {
 		}
 		Drawer2D_Make2DTexture(&player->NameTex, &bmp, size, 0, 0);
 		Mem_Free(bmp.Scan0);
+		TextCache_Add(&player->NameTex, &args, TEXTCACHE_NAMETAG);
 	}
 	Drawer2D_BitmappedText = bitmapped;
 }
@@ -603,6 +873,8 @@ static void Player_CopySkin(struct Player* player, struct Player* from) {
 	dst->SkinType  = src->SkinType;
 	dst->uScale    = src->uScale;
 	dst->vScale    = src->vScale;
+	dst->uOffset   = src->uOffset;
+	dst->vOffset   = src->vOffset;
 
 	/* Custom mob textures */
 	dst->MobTextureId = GFX_NULL;
@@ -613,7 +885,8 @@ static void Player_CopySkin(struct Player* player, struct Player* from) {
 /* Resets skin data for the given player */
 void Player_ResetSkin(struct Player* player) {
 	struct Entity* e = &player->Base;
-	e->uScale = 1.0f; e->vScale = 1.0f;
+	e->uScale  = 1.0f; e->vScale  = 1.0f;
+	e->uOffset = 0.0f; e->vOffset = 0.0f;
 	e->MobTextureId = GFX_NULL;
 	e->TextureId    = GFX_NULL;
 	e->SkinType     = SKIN_64x32;
@@ -697,6 +970,16 @@ static void Player_EnsurePow2(struct Player* p, Bitmap* bmp) {
 	*bmp = scaled;
 }
 
+/* Frees the texture (or skin atlas cell) used by the given player's skin. */
+static void Player_FreeSkin(struct Player* p) {
+	struct Entity* e = &p->Base;
+	if (SkinAtlas_Remove(e)) {
+		e->TextureId = GFX_NULL;
+	} else {
+		Gfx_DeleteTexture(&e->TextureId);
+	}
+}
+
 static void Player_CheckSkin(struct Player* p) {
 	struct Entity* e = &p->Base;
 	struct Player* first;
@@ -727,7 +1010,7 @@ static void Player_CheckSkin(struct Player* p) {
 		Mem_Free(bmp.Scan0); return;
 	}
 
-	Gfx_DeleteTexture(&e->TextureId);
+	Player_FreeSkin(p);
 	Player_SetSkinAll(p, true);
 	Player_EnsurePow2(p, &bmp);
 	e->SkinType = Utils_GetSkinType(&bmp);
@@ -736,7 +1019,9 @@ static void Player_CheckSkin(struct Player* p) {
 		Chat_Add1("&cSkin %s is too large", &skin);
 	} else if (e->SkinType != SKIN_INVALID) {
 		if (e->Model->UsesHumanSkin) Player_ClearHat(&bmp, e->SkinType);
-		e->TextureId = Gfx_CreateTexture(&bmp, true, false);
+		if (!SkinAtlas_Add(e, &bmp)) {
+			e->TextureId = Gfx_CreateTexture(&bmp, true, false);
+		}
 		Player_SetSkinAll(p, false);
 	}
 	Mem_Free(bmp.Scan0);
@@ -747,7 +1032,7 @@ static void Player_Despawn(struct Entity* e) {
 	struct Player* first  = Player_FirstOtherWithSameSkin(player);
 
 	if (!first) {
-		Gfx_DeleteTexture(&e->TextureId);
+		Player_FreeSkin(player);
 		Player_ResetSkin(player);
 	}
 	e->VTABLE->ContextLost(e);
@@ -755,7 +1040,7 @@ static void Player_Despawn(struct Entity* e) {
 
 static void Player_ContextLost(struct Entity* e) {
 	struct Player* player = (struct Player*)e;
-	Gfx_DeleteTexture(&player->NameTex.ID);
+	TextCache_Release(&player->NameTex.ID);
 	player->NameTex.X = 0; /* X is used as an 'empty name' flag */
 }
 
@@ -1145,6 +1430,7 @@ static void Entities_Init(void) {
 		ShadowMode_Names, Array_Elems(ShadowMode_Names));
 	if (Game_ClassicMode) Entities.ShadowsMode = SHADOW_MODE_NONE;
 
+	Entities_ResetGrid();
 	Entities.List[ENTITIES_SELF_ID] = &LocalPlayer_Instance.Base;
 	LocalPlayer_Init();
 }
@@ -1159,6 +1445,7 @@ static void Entities_Free(void) {
 	Event_UnregisterVoid(&GfxEvents.ContextLost,      NULL, Entities_ContextLost);
 	Event_UnregisterVoid(&GfxEvents.ContextRecreated, NULL, Entities_ContextRecreated);
 	Event_UnregisterVoid(&ChatEvents.FontChanged,     NULL, Entities_ChatFontChanged);
+	SkinAtlas_Free();
 
 	if (ShadowComponent_ShadowTex) {
 		Gfx_DeleteTexture(&ShadowComponent_ShadowTex);
@@ -82,7 +82,8 @@ struct Entity {
 	uint8_t SkinType, EntityType;
 	bool NoShade, OnGround;
 	GfxResourceID TextureId, MobTextureId;
-	float uScale, vScale;
+	/* Scale and offset applied to skin texture coordinates. (used for non power of two skins, and skin atlas) */
+	float uScale, vScale, uOffset, vOffset;
 	struct Matrix Transform;
 
 	struct AnimatedComp Anim;
@@ -134,6 +135,15 @@ void Entities_RenderHoveredNames(double delta);
 void Entities_Remove(EntityID id);
 /* Gets the ID of the closest entity to the given entity. */
 EntityID Entities_GetCloset(struct Entity* src);
+/* Removes all entities from the entity grid. */
+void Entities_ResetGrid(void);
+/* Updates the cell in the entity grid the given entity is stored in. */
+/* NOTE: Called every tick for all entities, only call this when entity is moved between ticks. */
+void Entities_UpdateGrid(EntityID id);
+/* Stores IDs of entities within radius blocks on X/Z axes of the given position, returning the count. */
+/* NOTE: Nearby entities beyond radius may also be returned, callers must still check actual distance. */
+/* NOTE: ids must be able to hold ENTITIES_MAX_COUNT IDs. */
+int Entities_QueryNearby(Vector3 pos, float radius, EntityID* ids);
 /* Draws shadows under entities, depending on Entities.ShadowsMode */
 void Entities_DrawShadows(void);
 
@@ -1217,15 +1217,17 @@ void PhysicsComp_CalculateJumpVelocity(struct PhysicsComp* comp, float jumpHeigh
 }
 
 void PhysicsComp_DoEntityPush(struct Entity* entity) {
+	EntityID ids[ENTITIES_MAX_COUNT];
 	struct Entity* other;
 	bool yIntersects;
 	Vector3 dir;
 	float dist, pushStrength;
-	int id;
+	int i, count;
 	dir.Y = 0.0f;
 
-	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
-		other = Entities.List[id];
+	count = Entities_QueryNearby(entity->Position, 1.0f, ids);
+	for (i = 0; i < count; i++) {
+		other = Entities.List[ids[i]];
 		if (!other || other == entity) continue;
 		if (!other->Model->Pushes)     continue;
 
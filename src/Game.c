@@ -32,6 +32,10 @@
 #include "Menus.h"
 #include "Audio.h"
 #include "Stream.h"
+#include "BlockPhysics.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "IsometricDrawer.h"
 
 struct _GameData Game;
 int  Game_Port;
@@ -199,6 +203,7 @@ void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
 	Lighting_OnBlockChanged(x, y, z, old, block);
+	Physics_OnBlockUpdated(x, y, z, old, block);
 
 	/* Refresh the chunk the block was located in. */
 	chunk = MapRenderer_GetChunk(cx, cy, cz);
@@ -453,6 +458,7 @@ static void Game_Load(void) {
 
 	Game_AddComponent(&Animations_Component);
 	Game_AddComponent(&Inventory_Component);
+	Game_AddComponent(&IsometricDrawer_Component);
 	Env_Reset();
 
 	Game_AddComponent(&MapRenderer_Component);
@@ -527,23 +533,37 @@ static void Game_Render3D(double delta, float t) {
 	Vector3 pos;
 	bool left, middle, right;
 
+	Profiler_Begin("Env");
 	if (EnvRenderer_ShouldRenderSkybox()) EnvRenderer_RenderSkybox(delta);
+	Profiler_End();
+
 	AxisLinesRenderer_Render(delta);
+	Profiler_Begin("Entities");
 	Entities_RenderModels(delta, t);
 	Entities_RenderNames(delta);
+	Profiler_End();
 
+	Profiler_Begin("Particles");
 	Particles_Render(delta, t);
+	Profiler_End();
 	Camera.Active->GetPickedBlock(&Game_SelectedPos); /* TODO: only pick when necessary */
 
+	Profiler_Begin("Env");
 	EnvRenderer_UpdateFog();
 	EnvRenderer_RenderSky(delta);
 	EnvRenderer_RenderClouds(delta);
+	Profiler_End();
 
 	MapRenderer_Update(delta);
 	MapRenderer_RenderNormal(delta);
+
+	Profiler_Begin("Env");
 	EnvRenderer_RenderMapSides(delta);
+	Profiler_End();
 
+	Profiler_Begin("Entities");
 	Entities_DrawShadows();
+	Profiler_End();
 	if (Game_SelectedPos.Valid && !Game_HideGui) {
 		PickedPosRenderer_Update(&Game_SelectedPos);
 		PickedPosRenderer_Render(delta);
@@ -553,9 +573,13 @@ static void Game_Render3D(double delta, float t) {
 	pos = LocalPlayer_Instance.Base.Position;
 	if (Camera.CurrentPos.Y < Env_EdgeHeight && (pos.X < 0 || pos.Z < 0 || pos.X > World.Width || pos.Z > World.Length)) {
 		MapRenderer_RenderTranslucent(delta);
+		Profiler_Begin("Env");
 		EnvRenderer_RenderMapEdges(delta);
+		Profiler_End();
 	} else {
+		Profiler_Begin("Env");
 		EnvRenderer_RenderMapEdges(delta);
+		Profiler_End();
 		MapRenderer_RenderTranslucent(delta);
 	}
 
@@ -566,7 +590,9 @@ static void Game_Render3D(double delta, float t) {
 	}
 
 	Selections_Render(delta);
+	Profiler_Begin("Entities");
 	Entities_RenderHoveredNames(delta);
+	Profiler_End();
 
 	left   = InputHandler_IsMousePressed(MOUSE_LEFT);
 	middle = InputHandler_IsMousePressed(MOUSE_MIDDLE);
@@ -630,6 +656,7 @@ static void Game_RenderFrame(double delta) {
 	float t;
 
 	frameStart = Stopwatch_Measure();
+	Profiler_BeginFrame();
 	Gfx_BeginFrame();
 	Gfx_BindIb(Gfx_defaultIb);
 	Game.Time += delta;
@@ -646,9 +673,12 @@ static void Game_RenderFrame(double delta) {
 		InputHandler_SetFOV(Game_ZoomFov, false);
 	}
 
+	Profiler_Begin("Tasks");
 	Game_DoScheduledTasks(delta);
+	Profiler_End();
 	entTask = Game_Tasks[entTaskI];
 	t = (float)(entTask.Accumulator / entTask.Interval);
+	Benchmark_BeginFrame();
 	LocalPlayer_SetInterpPosition(t);
 
 	Gfx_Clear();
@@ -657,7 +687,9 @@ static void Game_RenderFrame(double delta) {
 
 	visible = !Gui_Active || !Gui_Active->BlocksWorld;
 	if (visible && World.Blocks) {
+		Profiler_Begin("Render3D");
 		Game_Render3D(delta, t);
+		Profiler_End();
 	} else {
 		PickedPos_SetAsInvalid(&Game_SelectedPos);
 	}
@@ -665,7 +697,12 @@ static void Game_RenderFrame(double delta) {
 	Gui_RenderGui(delta);
 	if (Game_ScreenshotRequested) Game_TakeScreenshot();
 
+	Profiler_Begin("EndFrame");
 	Gfx_EndFrame();
+	Profiler_End();
+
+	Profiler_EndFrame();
+	Benchmark_EndFrame();
 	if (game_limitMs) Game_LimitFPS(frameStart);
 }
 
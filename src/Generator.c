@@ -12,15 +12,33 @@ volatile bool Gen_Done;
 int Gen_Seed;
 bool Gen_Vanilla;
 BlockRaw* Gen_Blocks;
+const char* Gen_StageNames[GEN_MAX_STAGES];
+uint64_t Gen_StageTimes[GEN_MAX_STAGES + 1];
+int Gen_NumStages;
 
 static void Gen_Init(void) {
 	Gen_CurrentProgress = 0.0f;
 	Gen_CurrentState    = "";
+	Gen_NumStages       = 0;
 
 	Gen_Blocks = Mem_Alloc(World.Volume, 1, "map blocks for gen");
 	Gen_Done   = false;
 }
 
+static void Gen_SetState(const char* state) {
+	Gen_CurrentState = state;
+	if (Gen_NumStages == GEN_MAX_STAGES) return;
+
+	Gen_StageNames[Gen_NumStages] = state;
+	Gen_StageTimes[Gen_NumStages] = Stopwatch_Measure();
+	Gen_NumStages++;
+}
+
+static void Gen_Finish(void) {
+	Gen_StageTimes[Gen_NumStages] = Stopwatch_Measure();
+	Gen_Done = true;
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------Flatgrass gen-------------------------------------------------------*
@@ -43,16 +61,16 @@ static void FlatgrassGen_MapSet(int yBeg, int yEnd, BlockRaw block) {
 void FlatgrassGen_Generate(void) {
 	Gen_Init();
 
-	Gen_CurrentState = "Setting air blocks";
+	Gen_SetState("Setting air blocks");
 	FlatgrassGen_MapSet(World.Height / 2, World.MaxY, BLOCK_AIR);
 
-	Gen_CurrentState = "Setting dirt blocks";
+	Gen_SetState("Setting dirt blocks");
 	FlatgrassGen_MapSet(0, World.Height / 2 - 2, BLOCK_DIRT);
 
-	Gen_CurrentState = "Setting grass blocks";
+	Gen_SetState("Setting grass blocks");
 	FlatgrassGen_MapSet(World.Height / 2 - 1, World.Height / 2 - 1, BLOCK_GRASS);
 
-	Gen_Done = true;
+	Gen_Finish();
 }
 
 
@@ -157,6 +175,59 @@ static int waterLevel, minHeight;
 static int16_t* Heightmap;
 static RNGState rnd;
 
+/* Column independent stages are split into jobs of a few rows (on Z axis), */
+/* which are then processed by the generator thread and a few worker threads. */
+/* NOTE: Each column's result is the same no matter which thread computes it. */
+#ifdef CC_BUILD_WEB
+#define GEN_THREADS 1
+#else
+#define GEN_THREADS 4
+#endif
+#define GEN_JOB_ROWS 16
+typedef void (*Gen_RowsFunc)(int zBeg, int zEnd);
+
+static Gen_RowsFunc gen_rowsFunc;
+static void* gen_rowsMutex;
+static volatile int gen_nextRow;
+
+static void NotchyGen_RowsWorker(void) {
+	int zBeg, zEnd;
+	for (;;) {
+		Mutex_Lock(gen_rowsMutex);
+		{
+			zBeg = gen_nextRow;
+			gen_nextRow += GEN_JOB_ROWS;
+			Gen_CurrentProgress = (float)min(zBeg, World.Length) / World.Length;
+		}
+		Mutex_Unlock(gen_rowsMutex);
+
+		if (zBeg >= World.Length) return;
+		zEnd = min(zBeg + GEN_JOB_ROWS, World.Length);
+		gen_rowsFunc(zBeg, zEnd);
+	}
+}
+
+/* Calls func for all rows of the map, spread across multiple threads. */
+static void NotchyGen_RunRows(Gen_RowsFunc func) {
+	void* threads[GEN_THREADS];
+	int i;
+
+	gen_rowsFunc  = func;
+	gen_nextRow   = 0;
+	gen_rowsMutex = Mutex_Create();
+
+	for (i = 1; i < GEN_THREADS; i++) {
+		threads[i] = Thread_Start(NotchyGen_RowsWorker, false);
+	}
+	NotchyGen_RowsWorker();
+	for (i = 1; i < GEN_THREADS; i++) {
+		Thread_Join(threads[i]);
+	}
+
+	Mutex_Free(gen_rowsMutex);
+	gen_rowsMutex = NULL;
+}
+
 static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, BlockRaw block) {
 	int xBeg = Math_Floor(max(x - radius, 0));
 	int xEnd = Math_Floor(min(x + radius, World.MaxX));
@@ -183,63 +254,29 @@ static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, Bloc
 	}
 }
 
-#define STACK_FAST 8192
 static void NotchyGen_FloodFill(int index, BlockRaw block) {
-	int32_t* stack;
-	int32_t stack_default[STACK_FAST]; /* try to avoid malloc if we can */
-	int count = 0, limit = STACK_FAST;
-	int x, y, z;
-
-	stack = stack_default;
-	if (index < 0) return; /* y below map, don't bother starting */
-	stack[count++] = index;
-
-	while (count) {
-		index = stack[--count];
-
-		if (Gen_Blocks[index] != BLOCK_AIR) continue;
-		Gen_Blocks[index] = block;
-
-		x = index  % World.Width;
-		y = index  / World.OneY;
-		z = (index / World.Width) % World.Length;
-
-		/* need to increase stack */
-		if (count >= limit - FACE_COUNT) {
-			stack = Utils_Resize(stack, &limit, 4, STACK_FAST, STACK_FAST);
-		}
-
-		if (x > 0)          { stack[count++] = index - 1; }
-		if (x < World.MaxX) { stack[count++] = index + 1; }
-		if (z > 0)          { stack[count++] = index - World.Width; }
-		if (z < World.MaxZ) { stack[count++] = index + World.Width; }
-		if (y > 0)          { stack[count++] = index - World.OneY; }
-	}
-	if (limit > STACK_FAST) Mem_Free(stack);
+	World_FloodFill(Gen_Blocks, index, BLOCK_AIR, block, false);
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
+/* Noise used by the column independent stages. (shared with worker threads) */
+static struct CombinedNoise gen_n1, gen_n2;
+static struct OctaveNoise gen_n3;
+
+static void NotchyGen_HeightmapRows(int zBeg, int zEnd) {
 	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
+	int hIndex, adjHeight, rowsMin = Int32_MaxValue;
 	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
-
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
 
 		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
+			hLow   = CombinedNoise_Calc(&gen_n1, x * 1.3f, z * 1.3f) / 6 - 4;
 			height = hLow;
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
+			if (OctaveNoise_Calc(&gen_n3, (float)x, (float)z) <= 0) {
+				hHigh = CombinedNoise_Calc(&gen_n2, x * 1.3f, z * 1.3f) / 5 + 6;
 				height = max(hLow, hHigh);
 			}
 
@@ -247,10 +284,23 @@ static void NotchyGen_CreateHeightmap(void) {
 			if (height < 0) height *= 0.8f;
 
 			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
+			rowsMin   = min(adjHeight, rowsMin);
 			Heightmap[hIndex++] = adjHeight;
 		}
 	}
+
+	Mutex_Lock(gen_rowsMutex);
+	minHeight = min(rowsMin, minHeight);
+	Mutex_Unlock(gen_rowsMutex);
+}
+
+static void NotchyGen_CreateHeightmap(void) {
+	CombinedNoise_Init(&gen_n1, &rnd, 8, 8);
+	CombinedNoise_Init(&gen_n2, &rnd, 8, 8);	
+	OctaveNoise_Init(&gen_n3, &rnd, 6);
+
+	Gen_SetState("Building heightmap");
+	NotchyGen_RunRows(NotchyGen_HeightmapRows);
 }
 
 static int NotchyGen_CreateStrataFast(void) {
@@ -259,7 +309,7 @@ static int NotchyGen_CreateStrataFast(void) {
 	int y;
 
 	Gen_CurrentProgress = 0.0f;
-	Gen_CurrentState    = "Filling map";
+	Gen_SetState("Filling map");
 	/* Make lava layer at bottom */
 	Mem_Set(Gen_Blocks, BLOCK_LAVA, oneY);
 
@@ -282,23 +332,19 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
+static int gen_minStoneY;
+static struct OctaveNoise gen_strataNoise;
+static void NotchyGen_StrataRows(int zBeg, int zEnd) {
 	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
+	int minStoneY = gen_minStoneY, stoneHeight;
+	int hIndex, maxY = World.MaxY, index = 0;
 	int x, y, z;
-	struct OctaveNoise n;
 
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
-
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
 
 		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
+			dirtThickness = (int)(OctaveNoise_Calc(&gen_strataNoise, (float)x, (float)z) / 24 - 4);
 			dirtHeight    = Heightmap[hIndex++];
 			stoneHeight   = dirtHeight + dirtThickness;
 
@@ -319,6 +365,15 @@ static void NotchyGen_CreateStrata(void) {
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	gen_minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&gen_strataNoise, &rnd, 8);
+
+	Gen_SetState("Creating strata");
+	NotchyGen_RunRows(NotchyGen_StrataRows);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -328,7 +383,7 @@ static void NotchyGen_CarveCaves(void) {
 	int i, j;
 
 	cavesCount       = World.Volume / 8192;
-	Gen_CurrentState = "Carving caves";
+	Gen_SetState("Carving caves");
 	for (i = 0; i < cavesCount; i++) {
 		Gen_CurrentProgress = (float)i / cavesCount;
 
@@ -372,7 +427,7 @@ static void NotchyGen_CarveOreVeins(float abundance, const char* state, BlockRaw
 	int i, j;
 
 	numVeins         = (int)(World.Volume * abundance / 16384);
-	Gen_CurrentState = state;
+	Gen_SetState(state);
 	for (i = 0; i < numVeins; i++) {
 		Gen_CurrentProgress = (float)i / numVeins;
 
@@ -404,7 +459,7 @@ static void NotchyGen_FloodFillWaterBorders(void) {
 	int waterY = waterLevel - 1;
 	int index1, index2;
 	int x, z;
-	Gen_CurrentState = "Flooding edge water";
+	Gen_SetState("Flooding edge water");
 
 	index1 = World_Pack(0, waterY, 0);
 	index2 = World_Pack(0, waterY, World.Length - 1);
@@ -432,7 +487,7 @@ static void NotchyGen_FloodFillWater(void) {
 	int i, x, y, z;
 
 	numSources       = World.Width * World.Length / 800;
-	Gen_CurrentState = "Flooding water";
+	Gen_SetState("Flooding water");
 	for (i = 0; i < numSources; i++) {
 		Gen_CurrentProgress = (float)i / numSources;
 
@@ -448,7 +503,7 @@ static void NotchyGen_FloodFillLava(void) {
 	int i, x, y, z;
 
 	numSources       = World.Width * World.Length / 20000;
-	Gen_CurrentState = "Flooding lava";
+	Gen_SetState("Flooding lava");
 	for (i = 0; i < numSources; i++) {
 		Gen_CurrentProgress = (float)i / numSources;
 
@@ -459,18 +514,14 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
+static struct OctaveNoise gen_sandNoise, gen_gravelNoise;
+static void NotchyGen_SurfaceRows(int zBeg, int zEnd) {
+	int hIndex, index;
 	BlockRaw above;
 	int x, y, z;
-	struct OctaveNoise n1, n2;
-
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
 
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (z = zBeg; z < zEnd; z++) {
+		hIndex = z * World.Width;
 
 		for (x = 0; x < World.Width; x++) {
 			y = Heightmap[hIndex++];
@@ -480,15 +531,23 @@ static void NotchyGen_CreateSurfaceLayer(void) {
 			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
 			/* TODO: update heightmap */
-			if (above == BLOCK_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
+			if (above == BLOCK_WATER && (OctaveNoise_Calc(&gen_gravelNoise, (float)x, (float)z) > 12)) {
 				Gen_Blocks[index] = BLOCK_GRAVEL;
 			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
+				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&gen_sandNoise, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 			}
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {
+	OctaveNoise_Init(&gen_sandNoise,   &rnd, 8);
+	OctaveNoise_Init(&gen_gravelNoise, &rnd, 8);
+
+	Gen_SetState("Creating surface");
+	NotchyGen_RunRows(NotchyGen_SurfaceRows);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -497,7 +556,7 @@ static void NotchyGen_PlantFlowers(void) {
 	int i, j, k, index;
 
 	numPatches       = World.Width * World.Length / 3000;
-	Gen_CurrentState = "Planting flowers";
+	Gen_SetState("Planting flowers");
 	for (i = 0; i < numPatches; i++) {
 		Gen_CurrentProgress = (float)i / numPatches;
 
@@ -531,7 +590,7 @@ static void NotchyGen_PlantMushrooms(void) {
 	int i, j, k, index;
 
 	numPatches       = World.Volume / 2000;
-	Gen_CurrentState = "Planting mushrooms";
+	Gen_SetState("Planting mushrooms");
 	for (i = 0; i < numPatches; i++) {
 		Gen_CurrentProgress = (float)i / numPatches;
 
@@ -573,7 +632,7 @@ static void NotchyGen_PlantTrees(void) {
 	Tree_Rnd    = &rnd;
 
 	numPatches       = World.Width * World.Length / 4000;
-	Gen_CurrentState = "Planting trees";
+	Gen_SetState("Planting trees");
 	for (i = 0; i < numPatches; i++) {
 		Gen_CurrentProgress = (float)i / numPatches;
 
@@ -633,7 +692,7 @@ void NotchyGen_Generate(void) {
 
 	Mem_Free(Heightmap);
 	Heightmap = NULL;
-	Gen_Done  = true;
+	Gen_Finish();
 }
 
 
@@ -16,6 +16,13 @@ extern int Gen_Seed;
 extern bool Gen_Vanilla;
 extern BlockRaw* Gen_Blocks;
 
+#define GEN_MAX_STAGES 24
+/* Names of the stages the last map generation went through, and when each began. (see Stopwatch_Measure) */
+/* NOTE: Gen_StageTimes[Gen_NumStages] is when generation finished. */
+extern const char* Gen_StageNames[GEN_MAX_STAGES];
+extern uint64_t Gen_StageTimes[GEN_MAX_STAGES + 1];
+extern int Gen_NumStages;
+
 void FlatgrassGen_Generate(void);
 void NotchyGen_Generate(void);
 
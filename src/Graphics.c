@@ -17,12 +17,12 @@
 
 struct _GfxData Gfx;
 
-static char Gfx_ApiBuffer[7][STRING_SIZE];
-String Gfx_ApiInfo[7] = {
+static char Gfx_ApiBuffer[8][STRING_SIZE];
+String Gfx_ApiInfo[8] = {
 	String_FromArray(Gfx_ApiBuffer[0]), String_FromArray(Gfx_ApiBuffer[1]),
 	String_FromArray(Gfx_ApiBuffer[2]), String_FromArray(Gfx_ApiBuffer[3]),
 	String_FromArray(Gfx_ApiBuffer[4]), String_FromArray(Gfx_ApiBuffer[5]),
-	String_FromArray(Gfx_ApiBuffer[6]),
+	String_FromArray(Gfx_ApiBuffer[6]), String_FromArray(Gfx_ApiBuffer[7]),
 };
 
 GfxResourceID Gfx_defaultIb;
@@ -189,52 +189,59 @@ void Gfx_RestoreAlphaState(uint8_t draw) {
 /* Quoted from http://www.realtimerendering.com/blog/gpus-prefer-premultiplication/
    The short version: if you want your renderer to properly handle textures with alphas when using
    bilinear interpolation or mipmapping, you need to premultiply your PNG color data by their (unassociated) alphas. */
-static BitmapCol Gfx_Average(BitmapCol p1, BitmapCol p2) {
-	uint32_t a1, a2, aSum;
-	uint32_t b1, g1, r1;
-	uint32_t b2, g2, r2;
+static BitmapCol Gfx_Average(BitmapCol p1, BitmapCol p2, BitmapCol p3, BitmapCol p4) {
+	uint32_t a1 = p1.A, a2 = p2.A, a3 = p3.A, a4 = p4.A;
+	uint32_t aSum = a1 + a2 + a3 + a4, round;
 	BitmapCol ave;
 
-	a1 = p1.A; a2 = p2.A;
-	aSum = (a1 + a2);
-	aSum = aSum > 0 ? aSum : 1; /* avoid divide by 0 below */
-
-	/* Convert RGB to pre-multiplied form */
-	b1 = p1.B * a1; g1 = p1.G * a1; r1 = p1.R * a1;
-	b2 = p2.B * a2; g2 = p2.G * a2; r2 = p2.R * a2;
-
-	/* https://stackoverflow.com/a/347376
-	   We need to convert RGB back from the pre-multiplied average into normal form
-	   ((r1 + r2) / 2) / ((a1 + a2) / 2)
-	   but we just cancel out the / 2*/
-	ave.B = (b1 + b2) / aSum;
-	ave.G = (g1 + g2) / aSum;
-	ave.R = (r1 + r2) / aSum;
-	ave.A = aSum >> 1;
+	if (!aSum) { ave.B = 0; ave.G = 0; ave.R = 0; ave.A = 0; return ave; }
+	round = aSum >> 1;
+
+	/* Average RGB in pre-multiplied form, then convert back into normal form */
+	/* ((r1*a1 + r2*a2 + r3*a3 + r4*a4) / 4) / ((a1 + a2 + a3 + a4) / 4), but the / 4 cancels out */
+	ave.B = (p1.B * a1 + p2.B * a2 + p3.B * a3 + p4.B * a4 + round) / aSum;
+	ave.G = (p1.G * a1 + p2.G * a2 + p3.G * a3 + p4.G * a4 + round) / aSum;
+	ave.R = (p1.R * a1 + p2.R * a2 + p3.R * a3 + p4.R * a4 + round) / aSum;
+	ave.A = (aSum + 2) >> 2;
 	return ave;
 }
 
-void Gfx_GenMipmaps(int width, int height, uint8_t* lvlScan0, uint8_t* scan0) {
-	BitmapCol* baseSrc = (BitmapCol*)scan0;
-	BitmapCol* baseDst = (BitmapCol*)lvlScan0;
-	int srcWidth = width << 1;
+/* Averages each of the 4 channels of 4 pixels at once, treating a uint32_t as 2 lanes of 16 bits */
+/* NOTE: Only valid when all 4 pixels are fully opaque, as colours are not weighted by alpha */
+static uint32_t Gfx_AverageOpaque(uint32_t p1, uint32_t p2, uint32_t p3, uint32_t p4) {
+	uint32_t lo = (p1 & 0x00FF00FF)        + (p2 & 0x00FF00FF)        + (p3 & 0x00FF00FF)        + (p4 & 0x00FF00FF);
+	uint32_t hi = ((p1 >> 8) & 0x00FF00FF) + ((p2 >> 8) & 0x00FF00FF) + ((p3 >> 8) & 0x00FF00FF) + ((p4 >> 8) & 0x00FF00FF);
+
+	lo = ((lo + 0x00020002) >> 2) & 0x00FF00FF;
+	hi = ((hi + 0x00020002) >> 2) & 0x00FF00FF;
+	return lo | (hi << 8);
+}
 
+void Gfx_GenMipmaps(int width, int height, uint8_t* lvlScan0, int srcWidth, int srcHeight, uint8_t* scan0) {
+	BitmapColUnion* baseSrc = (BitmapColUnion*)scan0;
+	BitmapColUnion* baseDst = (BitmapColUnion*)lvlScan0;
+	BitmapColUnion* src0; BitmapColUnion* src1;
+	BitmapColUnion* dst;
+	BitmapColUnion p1, p2, p3, p4;
+	/* Once one dimension reaches 1 pixel, it is no longer halved by later levels */
+	int xStep = srcWidth  / width, rowStep = srcHeight / height;
 	int x, y;
+
 	for (y = 0; y < height; y++) {
-		int srcY = (y << 1);
-		BitmapCol* src0 = baseSrc + srcY * srcWidth;
-		BitmapCol* src1 = src0    + srcWidth;
-		BitmapCol* dst  = baseDst + y * width;
-
-		for (x = 0; x < width; x++) {
-			int srcX = (x << 1);
-			BitmapCol src00 = src0[srcX], src01 = src0[srcX + 1];
-			BitmapCol src10 = src1[srcX], src11 = src1[srcX + 1];
-
-			/* bilinear filter this mipmap */
-			BitmapCol ave0 = Gfx_Average(src00, src01);
-			BitmapCol ave1 = Gfx_Average(src10, src11);
-			dst[x] = Gfx_Average(ave0, ave1);
+		src0 = baseSrc + (y * rowStep) * srcWidth;
+		src1 = src0    + (rowStep - 1) * srcWidth;
+		dst  = baseDst + y * width;
+
+		for (x = 0; x < width; x++, src0 += xStep, src1 += xStep) {
+			p1 = src0[0]; p2 = src0[xStep - 1];
+			p3 = src1[0]; p4 = src1[xStep - 1];
+
+			/* Most pixels in terrain are opaque, so avoid the far slower pre-multiplied average */
+			if ((p1.C.A & p2.C.A & p3.C.A & p4.C.A) == 255) {
+				dst[x].Raw = Gfx_AverageOpaque(p1.Raw, p2.Raw, p3.Raw, p4.Raw);
+			} else {
+				dst[x].C   = Gfx_Average(p1.C, p2.C, p3.C, p4.C);
+			}
 		}
 	}
 }
@@ -249,6 +256,74 @@ int Gfx_MipmapsLevels(int width, int height) {
 	}
 }
 
+int Gfx_MipmapsSize(int width, int height) {
+	int lvls = Gfx_MipmapsLevels(width, height);
+	int lvl, size = 0;
+
+	for (lvl = 1; lvl <= lvls; lvl++) {
+		if (width > 1)  width /= 2;
+		if (height > 1) height /= 2;
+		size += Bitmap_DataSize(width, height);
+	}
+	return size;
+}
+
+void Gfx_GenMipmapChain(Bitmap* bmp, uint8_t* mipmaps) {
+	int lvls = Gfx_MipmapsLevels(bmp->Width, bmp->Height);
+	int lvl, width = bmp->Width, height = bmp->Height;
+	int prevWidth, prevHeight;
+	uint8_t* prev = bmp->Scan0;
+
+	for (lvl = 1; lvl <= lvls; lvl++) {
+		prevWidth = width; prevHeight = height;
+		if (width > 1)  width /= 2;
+		if (height > 1) height /= 2;
+
+		Gfx_GenMipmaps(width, height, mipmaps, prevWidth, prevHeight, prev);
+		prev     = mipmaps;
+		mipmaps += Bitmap_DataSize(width, height);
+	}
+}
+
+void Gfx_GenMipmapLayers(Bitmap* bmp, int layers, int beg, int end, uint8_t* mipmaps) {
+	int size = bmp->Width, count = end - beg;
+	int lvl, lvls = Gfx_MipmapsLevels(size, size);
+	uint8_t* prev = bmp->Scan0;
+
+	/* Box filter never crosses layer boundaries, so each range of layers is independent */
+	for (lvl = 1; lvl <= lvls; lvl++, size /= 2) {
+		Gfx_GenMipmaps(size / 2, (size / 2) * count, mipmaps + beg * Bitmap_DataSize(size / 2, size / 2),
+						size, size * count, prev + beg * Bitmap_DataSize(size, size));
+
+		prev     = mipmaps;
+		mipmaps += Bitmap_DataSize(size / 2, (size / 2) * layers);
+	}
+}
+
+GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
+	GfxResourceID texId;
+	uint8_t* chain;
+	if (!mipmaps) return Gfx_CreateTextureMips(bmp, managedPool, NULL);
+
+	chain = Mem_Alloc(Gfx_MipmapsSize(bmp->Width, bmp->Height), 1, "mipmaps");
+	Gfx_GenMipmapChain(bmp, chain);
+	texId = Gfx_CreateTextureMips(bmp, managedPool, chain);
+
+	Mem_Free(chain);
+	return texId;
+}
+
+/* Animated textures update small parts every frame, so try to avoid allocating mipmaps then */
+#define GFX_PART_MIPMAPS_SIZE Bitmap_DataSize(32, 32)
+static uint8_t* Gfx_MakePartMipmaps(Bitmap* part, uint8_t* buffer) {
+	uint8_t* chain = buffer;
+	int size = Gfx_MipmapsSize(part->Width, part->Height);
+
+	if (size > GFX_PART_MIPMAPS_SIZE) chain = Mem_Alloc(size, 1, "mipmaps");
+	Gfx_GenMipmapChain(part, chain);
+	return chain;
+}
+
 void Texture_Render(const struct Texture* tex) {
 	PackedCol white = PACKEDCOL_WHITE;
 	Gfx_BindTexture(tex->ID);
@@ -261,6 +336,212 @@ void Texture_RenderShaded(const struct Texture* tex, PackedCol shadeCol) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------------Null-----------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_NULLGFX
+/* Discards everything, but counts what would have been sent to the GPU. Useful for */
+/* measuring CPU side rendering cost on machines without a GPU (or even a display). */
+struct _GfxStats Gfx_Stats;
+static GfxResourceID null_lastID;
+static GfxResourceID null_boundTex, null_boundVb, null_boundIb;
+
+static void* null_lockData;
+static int null_lockCapacity;
+
+static GfxResourceID Null_NextID(void) { return ++null_lastID; }
+#define Null_StateChanged() Gfx_Stats.StateChanges++
+
+void Gfx_Init(void) {
+	Gfx.MinZNear     = 0.1f;
+	Gfx.MaxTexWidth  = 8192;
+	Gfx.MaxTexHeight = 8192;
+	Gfx.MaxTexLayers = 2048;
+	Gfx_InitDefaultResources();
+}
+
+void Gfx_Free(void) {
+	Gfx_FreeDefaultResources();
+	Mem_Free(null_lockData);
+	null_lockData     = NULL;
+	null_lockCapacity = 0;
+}
+
+void Gfx_ResetStats(void) { Mem_Set(&Gfx_Stats, 0, sizeof(Gfx_Stats)); }
+
+GfxResourceID Gfx_CreateTextureMips(Bitmap* bmp, bool managedPool, uint8_t* mipmaps) {
+	Gfx_Stats.TextureBytes += Bitmap_DataSize(bmp->Width, bmp->Height);
+	return Null_NextID();
+}
+
+GfxResourceID Gfx_CreateTextureArray(Bitmap* bmp, int layers, uint8_t* mipmaps) {
+	Gfx_Stats.TextureBytes += Bitmap_DataSize(bmp->Width, bmp->Height);
+	return Null_NextID();
+}
+
+void Gfx_UpdateTexturePart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps) {
+	uint8_t buffer[GFX_PART_MIPMAPS_SIZE];
+	uint8_t* chain;
+	Gfx_Stats.TextureBytes += Bitmap_DataSize(part->Width, part->Height);
+	if (!mipmaps) return;
+
+	/* Still generate mipmaps, so CPU cost of animations is the same as other backends */
+	chain = Gfx_MakePartMipmaps(part, buffer);
+	if (chain != buffer) Mem_Free(chain);
+}
+
+void Gfx_BindTexture(GfxResourceID texId) {
+	if (null_boundTex == texId) return;
+	null_boundTex = texId;
+	Gfx_Stats.TextureBinds++;
+}
+
+void Gfx_DeleteTexture(GfxResourceID* texId) { *texId = GFX_NULL; }
+void Gfx_SetTexturing(bool enabled)      { Null_StateChanged(); }
+void Gfx_EnableMipmaps(void)  { }
+void Gfx_DisableMipmaps(void) { }
+
+void Gfx_SetFog(bool enabled) {
+	if (gfx_fogEnabled == enabled) return;
+	gfx_fogEnabled = enabled;
+	Null_StateChanged();
+}
+void Gfx_SetFogCol(PackedCol col)     { Null_StateChanged(); }
+void Gfx_SetFogDensity(float value)   { Null_StateChanged(); }
+void Gfx_SetFogEnd(float value)       { Null_StateChanged(); }
+void Gfx_SetFogMode(FogFunc func)     { Null_StateChanged(); }
+
+void Gfx_SetFaceCulling(bool enabled)   { Null_StateChanged(); }
+void Gfx_SetAlphaTest(bool enabled)     { Null_StateChanged(); }
+void Gfx_SetAlphaTestFunc(CompareFunc func, float refValue) { Null_StateChanged(); }
+void Gfx_SetAlphaBlending(bool enabled) { Null_StateChanged(); }
+void Gfx_SetAlphaBlendFunc(BlendFunc srcFunc, BlendFunc dstFunc) { Null_StateChanged(); }
+void Gfx_SetAlphaArgBlend(bool enabled) { Null_StateChanged(); }
+
+void Gfx_Clear(void) { }
+void Gfx_ClearCol(PackedCol col)       { }
+void Gfx_SetDepthTest(bool enabled)    { Null_StateChanged(); }
+void Gfx_SetDepthTestFunc(CompareFunc func) { Null_StateChanged(); }
+void Gfx_SetColWriteMask(bool r, bool g, bool b, bool a) { Null_StateChanged(); }
+void Gfx_SetDepthWrite(bool enabled)   { Null_StateChanged(); }
+
+GfxResourceID Gfx_CreateDynamicVb(VertexFormat fmt, int maxVertices) { return Null_NextID(); }
+GfxResourceID Gfx_CreateVb(void* vertices, VertexFormat fmt, int count) {
+	Gfx_Stats.BufferBytes += count * gfx_strideSizes[fmt];
+	return Null_NextID();
+}
+
+GfxResourceID Gfx_CreateIb(void* indices, int indicesCount) {
+	Gfx_Stats.BufferBytes += indicesCount * 2;
+	return Null_NextID();
+}
+
+void Gfx_BindVb(GfxResourceID vb) {
+	if (null_boundVb == vb) return;
+	null_boundVb = vb;
+	Gfx_Stats.BufferBinds++;
+}
+
+void Gfx_BindIb(GfxResourceID ib) {
+	if (null_boundIb == ib) return;
+	null_boundIb = ib;
+	Gfx_Stats.BufferBinds++;
+}
+
+void Gfx_DeleteVb(GfxResourceID* vb) { *vb = GFX_NULL; }
+void Gfx_DeleteIb(GfxResourceID* ib) { *ib = GFX_NULL; }
+
+void Gfx_SetVertexFormat(VertexFormat fmt) {
+	if (fmt == gfx_batchFormat) return;
+	gfx_batchFormat = fmt;
+	gfx_batchStride = gfx_strideSizes[fmt];
+	Null_StateChanged();
+}
+
+void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
+	Gfx_Stats.BufferBytes += vCount * gfx_batchStride;
+	Gfx_BindVb(vb);
+}
+
+void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
+	int size = count * gfx_strideSizes[fmt];
+	if (size > null_lockCapacity) {
+		Mem_Free(null_lockData);
+		null_lockData     = Mem_Alloc(size, 1, "Gfx_LockDynamicVb");
+		null_lockCapacity = size;
+	}
+
+	Gfx_Stats.BufferBytes += size;
+	return null_lockData;
+}
+void Gfx_UnlockDynamicVb(GfxResourceID vb) { Gfx_BindVb(vb); }
+
+void Gfx_DrawVb_Lines(int verticesCount) {
+	Gfx_Stats.DrawCalls++;
+	Gfx_Stats.Vertices += verticesCount;
+}
+
+void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
+	Gfx_Stats.DrawCalls++;
+	Gfx_Stats.Vertices += verticesCount;
+}
+
+void Gfx_DrawVb_IndexedTris(int verticesCount) {
+	Gfx_Stats.DrawCalls++;
+	Gfx_Stats.Vertices += verticesCount;
+}
+
+void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
+	Gfx_Stats.DrawCalls++;
+	Gfx_Stats.Vertices += verticesCount;
+}
+
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount) {
+	int i;
+	Gfx_Stats.DrawCalls++;
+	for (i = 0; i < rangesCount; i++) { Gfx_Stats.Vertices += counts[i]; }
+}
+
+void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix) { Null_StateChanged(); }
+void Gfx_LoadIdentityMatrix(MatrixType type) { Null_StateChanged(); }
+
+void Gfx_CalcOrthoMatrix(float width, float height, struct Matrix* matrix) {
+	Matrix_OrthographicOffCenter(matrix, 0.0f, width, height, 0.0f, -10000.0f, 10000.0f);
+}
+void Gfx_CalcPerspectiveMatrix(float fov, float aspect, float zNear, float zFar, struct Matrix* matrix) {
+	Matrix_PerspectiveFieldOfView(matrix, fov, aspect, zNear, zFar);
+}
+
+ReturnCode Gfx_TakeScreenshot(struct Stream* output, int width, int height) {
+	return ReturnCode_NotSupported;
+}
+bool Gfx_WarnIfNecessary(void) { return false; }
+
+void Gfx_SetVSync(bool value) { gfx_vsync = value; }
+void Gfx_BeginFrame(void) { }
+void Gfx_EndFrame(void)   { Gfx_Stats.Frames++; }
+void Gfx_OnWindowResize(void) { }
+
+void Gfx_MakeApiInfo(void) {
+	int pointerSize = sizeof(void*) * 8;
+	String_Format1(&Gfx_ApiInfo[0], "-- Using null graphics (%i bit) --", &pointerSize);
+	String_Format2(&Gfx_ApiInfo[1], "Max texture size: (%i, %i)", &Gfx.MaxTexWidth, &Gfx.MaxTexHeight);
+}
+
+void Gfx_UpdateApiInfo(void) {
+	float frames = (float)max(Gfx_Stats.Frames, 1);
+	float draws  = Gfx_Stats.DrawCalls / frames;
+	float verts  = Gfx_Stats.Vertices  / frames;
+	float states = Gfx_Stats.StateChanges / frames;
+
+	Gfx_ApiInfo[2].length = 0;
+	String_Format2(&Gfx_ApiInfo[2], "Draws per frame: %f1, vertices per frame: %f1", &draws, &verts);
+	Gfx_ApiInfo[3].length = 0;
+	String_Format1(&Gfx_ApiInfo[3], "State changes per frame: %f1", &states);
+}
+#endif
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Direct3D9--------------------------------------------------------*
 *#########################################################################################################################*/
@@ -439,36 +720,29 @@ static void D3D9_SetTexturePartData(IDirect3DTexture9* texture, int x, int y, Bi
 	if (res) Logger_Abort2(res, "D3D9_SetTexturePartData - Unlock");
 }
 
-static void D3D9_DoMipmaps(IDirect3DTexture9* texture, int x, int y, Bitmap* bmp, bool partial) {
-	uint8_t* prev = bmp->Scan0;
-	uint8_t* cur;
+static void D3D9_DoMipmaps(IDirect3DTexture9* texture, int x, int y, Bitmap* bmp, uint8_t* mipmaps, bool partial) {
 	Bitmap mipmap;
-
 	int lvls = Gfx_MipmapsLevels(bmp->Width, bmp->Height);
 	int lvl, width = bmp->Width, height = bmp->Height;
+	/* Smaller levels of a part would overlap pixels outside it (e.g. neighbouring atlas tiles) */
+	if (partial) lvls = min(lvls, Math_Log2(min(width, height)));
 
 	for (lvl = 1; lvl <= lvls; lvl++) {
 		x /= 2; y /= 2;
 		if (width > 1)   width /= 2;
 		if (height > 1) height /= 2;
 
-		cur = Mem_Alloc(width * height, 4, "mipmaps");
-		Gfx_GenMipmaps(width, height, cur, prev);
-
-		Bitmap_Init(mipmap, width, height, cur);
+		Bitmap_Init(mipmap, width, height, mipmaps);
 		if (partial) {
 			D3D9_SetTexturePartData(texture, x, y, &mipmap, lvl);
 		} else {
 			D3D9_SetTextureData(texture, &mipmap, lvl);
 		}
-
-		if (prev != bmp->Scan0) Mem_Free(prev);
-		prev = cur;
+		mipmaps += Bitmap_DataSize(width, height);
 	}
-	if (prev != bmp->Scan0) Mem_Free(prev);
 }
 
-GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
+GfxResourceID Gfx_CreateTextureMips(Bitmap* bmp, bool managedPool, uint8_t* mipmaps) {
 	IDirect3DTexture9* tex;
 	ReturnCode res;
 	int mipmapsLevels = Gfx_MipmapsLevels(bmp->Width, bmp->Height);
@@ -484,7 +758,7 @@ GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
 		if (res) Logger_Abort2(res, "D3D9_CreateTexture");
 
 		D3D9_SetTextureData(tex, bmp, 0);
-		if (mipmaps) D3D9_DoMipmaps(tex, 0, 0, bmp, false);
+		if (mipmaps) D3D9_DoMipmaps(tex, 0, 0, bmp, mipmaps, false);
 	} else {
 		IDirect3DTexture9* sys;
 		res = IDirect3DDevice9_CreateTexture(device, bmp->Width, bmp->Height, levels,
@@ -492,7 +766,7 @@ GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
 		if (res) Logger_Abort2(res, "D3D9_CreateTexture - SystemMem");
 
 		D3D9_SetTextureData(sys, bmp, 0);
-		if (mipmaps) D3D9_DoMipmaps(sys, 0, 0, bmp, false);
+		if (mipmaps) D3D9_DoMipmaps(sys, 0, 0, bmp, mipmaps, false);
 
 		res = IDirect3DDevice9_CreateTexture(device, bmp->Width, bmp->Height, levels,
 			0, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &tex, NULL);
@@ -505,10 +779,20 @@ GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
 	return tex;
 }
 
+/* Direct3D 9 has no texture arrays (Gfx.MaxTexLayers is always 0) */
+GfxResourceID Gfx_CreateTextureArray(Bitmap* bmp, int layers, uint8_t* mipmaps) { return GFX_NULL; }
+
 void Gfx_UpdateTexturePart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps) {
 	IDirect3DTexture9* texture = (IDirect3DTexture9*)texId;
+	uint8_t buffer[GFX_PART_MIPMAPS_SIZE];
+	uint8_t* chain;
+
 	D3D9_SetTexturePartData(texture, x, y, part, 0);
-	if (mipmaps) D3D9_DoMipmaps(texture, x, y, part, true);
+	if (!mipmaps) return;
+
+	chain = Gfx_MakePartMipmaps(part, buffer);
+	D3D9_DoMipmaps(texture, x, y, part, chain, true);
+	if (chain != buffer) Mem_Free(chain);
 }
 
 void Gfx_BindTexture(GfxResourceID texId) {
@@ -788,6 +1072,25 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	if (res) Logger_Abort2(res, "D3D9_SetDynamicVbData - Bind");
 }
 
+void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
+	int size = count * gfx_strideSizes[fmt];
+	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
+	void* dst = NULL;
+
+	ReturnCode res = IDirect3DVertexBuffer9_Lock(vbuffer, 0, size, &dst, D3DLOCK_DISCARD);
+	if (res) Logger_Abort2(res, "D3D9_LockDynamicVb");
+	return dst;
+}
+
+void Gfx_UnlockDynamicVb(GfxResourceID vb) {
+	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
+	ReturnCode res = IDirect3DVertexBuffer9_Unlock(vbuffer);
+	if (res) Logger_Abort2(res, "D3D9_UnlockDynamicVb");
+
+	res = IDirect3DDevice9_SetStreamSource(device, 0, vbuffer, 0, gfx_batchStride);
+	if (res) Logger_Abort2(res, "D3D9_UnlockDynamicVb - Bind");
+}
+
 void Gfx_DrawVb_Lines(int verticesCount) {
 	ReturnCode res = IDirect3DDevice9_DrawPrimitive(device, D3DPT_LINELIST, 0, verticesCount >> 1);
 	if (res) Logger_Abort2(res, "D3D9_DrawVb_Lines");
@@ -811,6 +1114,13 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	if (res) Logger_Abort2(res, "D3D9_DrawIndexedVb_TrisT2fC4b");
 }
 
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount) {
+	int i;
+	for (i = 0; i < rangesCount; i++) {
+		Gfx_DrawIndexedVb_TrisT2fC4b(counts[i], starts[i]);
+	}
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------Matrices--------------------------------------------------------*
@@ -975,7 +1285,7 @@ void Gfx_OnWindowResize(void) {
  * - OpenGL 1.5 or OpenGL 1.2 + GL_ARB_vertex_buffer_object (default desktop backend)
  * - OpenGL 2.0 (alternative modern-ish backend)
 */
-#ifndef CC_BUILD_D3D9
+#if !defined CC_BUILD_D3D9 && !defined CC_BUILD_NULLGFX
 #if defined CC_BUILD_WIN
 #include <windows.h>
 #include <GL/gl.h>
@@ -1030,6 +1340,29 @@ typedef void (*GL_SetupVBRangeFunc)(int startVertex);
 static GL_SetupVBFunc gl_setupVBFunc;
 static GL_SetupVBRangeFunc gl_setupVBRangeFunc;
 
+/* OpenGL 1.x has no way of mapping buffer memory, so dynamic VB locks are instead written */
+/* into this staging memory, which is kept around so it doesn't need to be allocated each frame */
+static void* gl_lockData;
+static int gl_lockSize, gl_lockCapacity;
+
+void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
+	int size = count * gfx_strideSizes[fmt];
+	if (size > gl_lockCapacity) {
+		Mem_Free(gl_lockData);
+		gl_lockData     = Mem_Alloc(size, 1, "Gfx_LockDynamicVb");
+		gl_lockCapacity = size;
+	}
+
+	gl_lockSize = size;
+	return gl_lockData;
+}
+
+static void GL_FreeLockData(void) {
+	Mem_Free(gl_lockData);
+	gl_lockData     = NULL;
+	gl_lockCapacity = 0;
+}
+
 static void GL_CheckSupport(void);
 static void GL_InitState(void);
 void Gfx_Init(void) {
@@ -1049,45 +1382,57 @@ void Gfx_Init(void) {
 void Gfx_Free(void) {
 	Gfx_FreeDefaultResources();
 	GLContext_Free();
+	GL_FreeLockData();
 }
 
+/* Shadow copy of GL state, so that redundant state changes are never sent to the driver */
+/* NOTE: Initial values match the default state of a newly created context */
+static bool gl_faceCulling, gl_alphaBlending, gl_depthTest, gl_depthWrite = true;
+static int gl_srcBlend = -1, gl_dstBlend = -1, gl_depthFunc = -1, gl_colWriteMask = -1;
+static GfxResourceID gl_boundTex;
+static int gl_callsIssued, gl_callsElided, gl_frames;
+
 #define gl_Toggle(cap) if (enabled) { glEnable(cap); } else { glDisable(cap); }
+/* Only enables or disables the capability when it differs from the cached state */
+#define gl_CachedToggle(state, cap) \
+if (state == enabled) { gl_callsElided++; return; } \
+gl_callsIssued++; state = enabled; gl_Toggle(cap);
 
 
 /*########################################################################################################################*
 *---------------------------------------------------------Textures--------------------------------------------------------*
 *#########################################################################################################################*/
-static void GL_DoMipmaps(GfxResourceID texId, int x, int y, Bitmap* bmp, bool partial) {
-	uint8_t* prev = bmp->Scan0;
-	uint8_t* cur;
+#ifdef CC_BUILD_GLMODERN
+/* Texture arrays are only supported by the OpenGL 2.0 backend, see further below */
+static bool GL_UpdateTexArrayPart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps);
+static bool GL_BindTexArray(GfxResourceID texId);
+static void GL_FreeTexArray(GfxResourceID texId);
+#endif
 
+static void GL_DoMipmaps(int x, int y, Bitmap* bmp, uint8_t* mipmaps, bool partial) {
 	int lvls = Gfx_MipmapsLevels(bmp->Width, bmp->Height);
 	int lvl, width = bmp->Width, height = bmp->Height;
+	/* Smaller levels of a part would overlap pixels outside it (e.g. neighbouring atlas tiles) */
+	if (partial) lvls = min(lvls, Math_Log2(min(width, height)));
 
 	for (lvl = 1; lvl <= lvls; lvl++) {
 		x /= 2; y /= 2;
 		if (width > 1)  width /= 2;
 		if (height > 1) height /= 2;
 
-		cur = Mem_Alloc(width * height, 4, "mipmaps");
-		Gfx_GenMipmaps(width, height, cur, prev);
-
 		if (partial) {
-			glTexSubImage2D(GL_TEXTURE_2D, lvl, x, y, width, height, PIXEL_FORMAT, GL_UNSIGNED_BYTE, cur);
+			glTexSubImage2D(GL_TEXTURE_2D, lvl, x, y, width, height, PIXEL_FORMAT, GL_UNSIGNED_BYTE, mipmaps);
 		} else {
-			glTexImage2D(GL_TEXTURE_2D, lvl, GL_RGBA, width, height, 0, PIXEL_FORMAT, GL_UNSIGNED_BYTE, cur);
+			glTexImage2D(GL_TEXTURE_2D, lvl, GL_RGBA, width, height, 0, PIXEL_FORMAT, GL_UNSIGNED_BYTE, mipmaps);
 		}
-
-		if (prev != bmp->Scan0) Mem_Free(prev);
-		prev = cur;
+		mipmaps += Bitmap_DataSize(width, height);
 	}
-	if (prev != bmp->Scan0) Mem_Free(prev);
 }
 
-GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
+GfxResourceID Gfx_CreateTextureMips(Bitmap* bmp, bool managedPool, uint8_t* mipmaps) {
 	GLuint texId;
 	glGenTextures(1, &texId);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	Gfx_BindTexture(texId);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 	if (!Math_IsPowOf2(bmp->Width) || !Math_IsPowOf2(bmp->Height)) {
@@ -1106,22 +1451,43 @@ GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps) {
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bmp->Width, bmp->Height, 0, PIXEL_FORMAT, GL_UNSIGNED_BYTE, bmp->Scan0);
 
-	if (mipmaps) GL_DoMipmaps(texId, 0, 0, bmp, false);
+	if (mipmaps) GL_DoMipmaps(0, 0, bmp, mipmaps, false);
 	return texId;
 }
 
 void Gfx_UpdateTexturePart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps) {
-	glBindTexture(GL_TEXTURE_2D, texId);
+	uint8_t buffer[GFX_PART_MIPMAPS_SIZE];
+	uint8_t* chain;
+#ifdef CC_BUILD_GLMODERN
+	if (GL_UpdateTexArrayPart(texId, x, y, part, mipmaps)) return;
+#endif
+
+	Gfx_BindTexture(texId);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, part->Width, part->Height, PIXEL_FORMAT, GL_UNSIGNED_BYTE, part->Scan0);
-	if (mipmaps) GL_DoMipmaps(texId, x, y, part, true);
+	if (!mipmaps) return;
+
+	chain = Gfx_MakePartMipmaps(part, buffer);
+	GL_DoMipmaps(x, y, part, chain, true);
+	if (chain != buffer) Mem_Free(chain);
 }
 
 void Gfx_BindTexture(GfxResourceID texId) {
+	if (texId == gl_boundTex) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_boundTex = texId;
+#ifdef CC_BUILD_GLMODERN
+	if (GL_BindTexArray(texId)) return;
+#endif
 	glBindTexture(GL_TEXTURE_2D, texId);
 }
 
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	if (!texId || *texId == GFX_NULL) return;
+	/* Deleting the bound texture reverts the binding to texture 0 */
+	if (*texId == gl_boundTex) gl_boundTex = GFX_NULL;
+#ifdef CC_BUILD_GLMODERN
+	GL_FreeTexArray(*texId);
+#endif
 	glDeleteTextures(1, texId);
 	*texId = GFX_NULL;
 }
@@ -1134,11 +1500,15 @@ void Gfx_DisableMipmaps(void) { }
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
 static PackedCol gl_lastClearCol;
-void Gfx_SetFaceCulling(bool enabled) { gl_Toggle(GL_CULL_FACE); }
+void Gfx_SetFaceCulling(bool enabled) { gl_CachedToggle(gl_faceCulling, GL_CULL_FACE); }
 
-void Gfx_SetAlphaBlending(bool enabled) { gl_Toggle(GL_BLEND); }
+void Gfx_SetAlphaBlending(bool enabled) { gl_CachedToggle(gl_alphaBlending, GL_BLEND); }
 void Gfx_SetAlphaBlendFunc(BlendFunc srcFunc, BlendFunc dstFunc) {
 	static GLenum funcs[6] = { GL_ZERO, GL_ONE, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_DST_ALPHA, GL_ONE_MINUS_DST_ALPHA };
+	if (srcFunc == gl_srcBlend && dstFunc == gl_dstBlend) { gl_callsElided++; return; }
+
+	gl_callsIssued++;
+	gl_srcBlend = srcFunc; gl_dstBlend = dstFunc;
 	glBlendFunc(funcs[srcFunc], funcs[dstFunc]);
 }
 void Gfx_SetAlphaArgBlend(bool enabled) { }
@@ -1150,15 +1520,26 @@ void Gfx_ClearCol(PackedCol col) {
 }
 
 void Gfx_SetColWriteMask(bool r, bool g, bool b, bool a) {
+	int mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+	if (mask == gl_colWriteMask) { gl_callsElided++; return; }
+
+	gl_callsIssued++;
+	gl_colWriteMask = mask;
 	glColorMask(r, g, b, a);
 }
 
 void Gfx_SetDepthWrite(bool enabled) {
+	if (enabled == gl_depthWrite) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_depthWrite = enabled;
 	glDepthMask(enabled);
 }
 
-void Gfx_SetDepthTest(bool enabled) { gl_Toggle(GL_DEPTH_TEST); }
+void Gfx_SetDepthTest(bool enabled) { gl_CachedToggle(gl_depthTest, GL_DEPTH_TEST); }
 void Gfx_SetDepthTestFunc(CompareFunc func) {
+	if (func == gl_depthFunc) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_depthFunc = func;
 	glDepthFunc(gl_compare[func]);
 }
 
@@ -1174,54 +1555,76 @@ void Gfx_CalcPerspectiveMatrix(float fov, float aspect, float zNear, float zFar,
 *---------------------------------------------------Vertex/Index buffers--------------------------------------------------*
 *#########################################################################################################################*/
 #ifndef CC_BUILD_GL11
-static GLuint GL_GenAndBind(GLenum target) {
-	GLuint id;
-	_glGenBuffers(1, &id);
-	_glBindBuffer(target, id);
-	return id;
+static GfxResourceID gl_boundVb, gl_boundIb;
+void Gfx_BindVb(GfxResourceID vb) {
+	if (vb == gl_boundVb) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_boundVb = vb;
+	_glBindBuffer(GL_ARRAY_BUFFER, vb);
+}
+
+void Gfx_BindIb(GfxResourceID ib) {
+	if (ib == gl_boundIb) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_boundIb = ib;
+	_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib);
 }
 
 GfxResourceID Gfx_CreateDynamicVb(VertexFormat fmt, int maxVertices) {
-	GLuint id     = GL_GenAndBind(GL_ARRAY_BUFFER);
+	GLuint id;
 	uint32_t size = maxVertices * gfx_strideSizes[fmt];
+
+	_glGenBuffers(1, &id);
+	Gfx_BindVb(id);
 	_glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
 	return id;
 }
 
 GfxResourceID Gfx_CreateVb(void* vertices, VertexFormat fmt, int count) {
-	GLuint id     = GL_GenAndBind(GL_ARRAY_BUFFER);
+	GLuint id;
 	uint32_t size = count * gfx_strideSizes[fmt];
+
+	_glGenBuffers(1, &id);
+	Gfx_BindVb(id);
 	_glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 	return id;
 }
 
 GfxResourceID Gfx_CreateIb(void* indices, int indicesCount) {
-	GLuint id     = GL_GenAndBind(GL_ELEMENT_ARRAY_BUFFER);
+	GLuint id;
 	uint32_t size = indicesCount * 2;
+
+	_glGenBuffers(1, &id);
+	Gfx_BindIb(id);
 	_glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 	return id;
 }
 
-void Gfx_BindVb(GfxResourceID vb) { _glBindBuffer(GL_ARRAY_BUFFER, vb); }
-void Gfx_BindIb(GfxResourceID ib) { _glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib); }
-
+/* Deleting a bound buffer reverts the binding to buffer 0 */
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	if (!vb || *vb == GFX_NULL) return;
+	if (*vb == gl_boundVb) gl_boundVb = GFX_NULL;
 	_glDeleteBuffers(1, vb);
 	*vb = GFX_NULL;
 }
 
 void Gfx_DeleteIb(GfxResourceID* ib) {
 	if (!ib || *ib == GFX_NULL) return;
+	if (*ib == gl_boundIb) gl_boundIb = GFX_NULL;
 	_glDeleteBuffers(1, ib);
 	*ib = GFX_NULL;
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	uint32_t size = vCount * gfx_batchStride;
-	_glBindBuffer(GL_ARRAY_BUFFER, vb);
+	Gfx_BindVb(vb);
 	_glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
 }
+
+void Gfx_UnlockDynamicVb(GfxResourceID vb) {
+	Gfx_BindVb(vb);
+	_glBufferSubData(GL_ARRAY_BUFFER, 0, gl_lockSize, gl_lockData);
+}
 #endif
 
 
@@ -1261,7 +1664,15 @@ void Gfx_MakeApiInfo(void) {
 
 void Gfx_UpdateApiInfo(void) {
 	int totalKb = 0, curKb = 0;
-	float total, cur;
+	float total, cur, issued, elided;
+	int frames = max(gl_frames, 1);
+
+	issued = (float)gl_callsIssued / frames;
+	elided = (float)gl_callsElided / frames;
+	gl_callsIssued = 0; gl_callsElided = 0; gl_frames = 0;
+
+	Gfx_ApiInfo[7].length = 0;
+	String_Format2(&Gfx_ApiInfo[7], "State changes per frame: %f1 sent, %f1 skipped", &issued, &elided);
 
 	if (!nv_mem) return;
 	glGetIntegerv(0x9048, &totalKb);
@@ -1302,6 +1713,7 @@ void Gfx_Clear(void) {
 }
 
 void Gfx_EndFrame(void) {
+	gl_frames++;
 	GLContext_SwapBuffers();
 }
 
@@ -1316,12 +1728,13 @@ void Gfx_OnWindowResize(void) {
 #ifdef CC_BUILD_GLMODERN
 #define SHADER_FT_TEX (1 << 0)
 #define SHADER_FT_ALP (1 << 1)
+#define SHADER_FT_ARR (1 << 2)
 
 #define SHADER_UF_MVP (1 << 0)
 
 /* cached uniforms (cached for multiple programs */
 static struct Matrix _view, _proj, _mvp;
-static bool gfx_alphaTest;
+static bool gfx_alphaTest, gl_texArrayBound;
 
 /* shader programs (emulate fixed function) */
 static struct GLShader {
@@ -1329,27 +1742,37 @@ static struct GLShader {
 	int Uniforms;     /* which associated uniforms need to be resent to GPU */
 	GLuint Program;   /* OpenGL program ID (0 if not yet compiled) */
 	int Locations[1]; /* location of uniforms (not constant) */
-} shaders[4] = {
+} shaders[8] = {
 	{ 0 },
 	{ SHADER_FT_ALP },
 	{ SHADER_FT_TEX },
-	{ SHADER_FT_TEX | SHADER_FT_ALP }
+	{ SHADER_FT_TEX | SHADER_FT_ALP },
+	/* texture array variants (only used with textured vertex format) */
+	{ SHADER_FT_ARR },
+	{ SHADER_FT_ARR | SHADER_FT_ALP },
+	{ SHADER_FT_ARR | SHADER_FT_TEX },
+	{ SHADER_FT_ARR | SHADER_FT_TEX | SHADER_FT_ALP }
 };
 static struct GLShader* gl_activeShader;
 
 /* Generates source code for a GLSL vertex shader, based on shader's flags */
 static void Gfx_GenVertexShader(const struct GLShader* shader, String* dst) {
 	int uv = shader->Features & SHADER_FT_TEX;
+	int ar = uv && (shader->Features & SHADER_FT_ARR);
 	String_AppendConst(dst,         "attribute vec3 in_pos;\n");
 	String_AppendConst(dst,         "attribute vec4 in_col;\n");
 	if (uv) String_AppendConst(dst, "attribute vec2 in_uv;\n");
 	String_AppendConst(dst,         "varying vec4 out_col;\n");
 	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
+	if (ar) String_AppendConst(dst, "varying float out_layer;\n");
 	String_AppendConst(dst,         "uniform mat4 mvp;\n");
 	String_AppendConst(dst,         "void main() {\n");
 	String_AppendConst(dst,         "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
 	String_AppendConst(dst,         "  out_col = in_col;\n");
-	if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
+	/* Layer is computed per vertex, so it stays exact across the whole face */
+	if (ar) String_AppendConst(dst, "  out_layer = floor(in_uv.y);\n");
+	if (ar) String_AppendConst(dst, "  out_uv  = vec2(in_uv.x, in_uv.y - out_layer);\n");
+	else if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
 	String_AppendConst(dst,         "}");
 }
 
@@ -1357,13 +1780,18 @@ static void Gfx_GenVertexShader(const struct GLShader* shader, String* dst) {
 static void Gfx_GenFragmentShader(const struct GLShader* shader, String* dst) {
 	int uv = shader->Features & SHADER_FT_TEX;
 	int al = shader->Features & SHADER_FT_ALP;
+	int ar = uv && (shader->Features & SHADER_FT_ARR);
 
+	if (ar) String_AppendConst(dst, "#extension GL_EXT_texture_array : enable\n");
 	String_AppendConst(dst,         "precision highp float;\n");
 	String_AppendConst(dst,         "varying vec4 out_col;\n");
 	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
-	if (uv) String_AppendConst(dst, "uniform sampler2D texImage;\n");
+	if (ar) String_AppendConst(dst, "varying float out_layer;\n");
+	if (ar) String_AppendConst(dst, "uniform sampler2DArray texImage;\n");
+	else if (uv) String_AppendConst(dst, "uniform sampler2D texImage;\n");
 	String_AppendConst(dst,         "void main() {\n");
-	if (uv) String_AppendConst(dst, "  vec4 col = texture2D(texImage, out_uv) * out_col;");
+	if (ar) String_AppendConst(dst, "  vec4 col = texture2DArray(texImage, vec3(out_uv, out_layer)) * out_col;");
+	else if (uv) String_AppendConst(dst, "  vec4 col = texture2D(texImage, out_uv) * out_col;");
 	else    String_AppendConst(dst, "  vec4 col = out_col;");
 	if (al) String_AppendConst(dst, "  if (col.a < 0.5) discard;");
 	String_AppendConst(dst,         "  gl_FragColor = col;");
@@ -1468,6 +1896,7 @@ static void Gfx_SwitchProgram(void) {
 
 	if (gfx_alphaTest) index |= 1;
 	if (gfx_batchFormat == VERTEX_FORMAT_P3FT2FC4B) index |= 2;
+	if (gl_texArrayBound && (index & 2)) index |= 4;
 
 	shader = &shaders[index];
 	if (shader == gl_activeShader) return;
@@ -1485,7 +1914,12 @@ void Gfx_SetFogEnd(float value) { }
 void Gfx_SetFogMode(FogFunc func) { }
 
 void Gfx_SetTexturing(bool enabled) { }
-void Gfx_SetAlphaTest(bool enabled) { gfx_alphaTest = enabled; Gfx_SwitchProgram(); }
+void Gfx_SetAlphaTest(bool enabled) {
+	if (enabled == gfx_alphaTest) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gfx_alphaTest = enabled;
+	Gfx_SwitchProgram();
+}
 void Gfx_SetAlphaTestFunc(CompareFunc func, float refValue) { }
 
 void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix) {
@@ -1500,7 +1934,133 @@ void Gfx_LoadIdentityMatrix(MatrixType type) {
 	Gfx_LoadMatrix(type, &Matrix_Identity);
 }
 
-static void GL_CheckSupport(void) { }
+
+/*########################################################################################################################*
+*-----------------------------------------------------Texture arrays------------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+/* Not present in gl2.h, since texture arrays are only core in OpenGL 3.0 / OpenGL ES 3.0 */
+#define GL_TEXTURE_2D_ARRAY          0x8C1A
+#define GL_MAX_ARRAY_TEXTURE_LAYERS  0x88FF
+typedef void (APIENTRY *FUNC_GLTEXIMAGE3D) (GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, 
+	GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid* pixels);
+typedef void (APIENTRY *FUNC_GLTEXSUBIMAGE3D) (GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, 
+	GLsizei height, GLsizei depth, GLenum format, GLenum type, const GLvoid* pixels);
+static FUNC_GLTEXIMAGE3D    _glTexImage3D;
+static FUNC_GLTEXSUBIMAGE3D _glTexSubImage3D;
+
+/* Texture arrays need to be bound with a different target and sampled by different shaders, */
+/* so IDs of all texture arrays are tracked (only the terrain atlas uses one in practice) */
+#define GL_MAX_TEX_ARRAYS 4
+static struct GLTexArray { GfxResourceID ID; int LayerHeight; } gl_texArrays[GL_MAX_TEX_ARRAYS];
+
+static struct GLTexArray* GL_FindTexArray(GfxResourceID texId) {
+	int i;
+	for (i = 0; i < GL_MAX_TEX_ARRAYS; i++) {
+		if (gl_texArrays[i].ID == texId) return &gl_texArrays[i];
+	}
+	return NULL;
+}
+
+GfxResourceID Gfx_CreateTextureArray(Bitmap* bmp, int layers, uint8_t* mipmaps) {
+	struct GLTexArray* arr = GL_FindTexArray(GFX_NULL);
+	int width = bmp->Width, height = bmp->Height / layers;
+	int lvl, lvls = Gfx_MipmapsLevels(width, height);
+	GLuint texId;
+
+	if (!arr) Logger_Abort("Too many texture arrays");
+	if (!Math_IsPowOf2(width) || width != height) {
+		Logger_Abort("Texture array layers must be square with power of two dimensions");
+	}
+
+	glGenTextures(1, &texId);
+	arr->ID = texId; arr->LayerHeight = height;
+	Gfx_BindTexture(texId);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,  mipmaps ? lvls : 0);
+	_glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, layers, 0, PIXEL_FORMAT, GL_UNSIGNED_BYTE, bmp->Scan0);
+	if (!mipmaps) return texId;
+
+	/* Since layers are square, the first levels of the whole bitmap's chain are all layers one after another */
+	for (lvl = 1; lvl <= lvls; lvl++) {
+		width /= 2; height /= 2;
+		_glTexImage3D(GL_TEXTURE_2D_ARRAY, lvl, GL_RGBA, width, height, layers, 0, PIXEL_FORMAT, GL_UNSIGNED_BYTE, mipmaps);
+		mipmaps += Bitmap_DataSize(width, height * layers);
+	}
+	return texId;
+}
+
+static bool GL_UpdateTexArrayPart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps) {
+	struct GLTexArray* arr = texId ? GL_FindTexArray(texId) : NULL;
+	uint8_t buffer[GFX_PART_MIPMAPS_SIZE];
+	uint8_t* chain;
+	uint8_t* cur;
+	int lvl, lvls, width = part->Width, height = part->Height;
+	int layer, layers = 1;
+
+	if (!arr) return false;
+	layer = y / arr->LayerHeight;
+	y    -= layer * arr->LayerHeight;
+
+	/* Part covers multiple whole layers, so update all of those layers at once */
+	if (height > arr->LayerHeight) {
+		layers = height / arr->LayerHeight;
+		height = arr->LayerHeight;
+	}
+
+	Gfx_BindTexture(texId);
+	_glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width, height, layers, PIXEL_FORMAT, GL_UNSIGNED_BYTE, part->Scan0);
+	if (!mipmaps) return true;
+
+	/* Like Gfx_CreateTextureArray, first levels of the whole part's chain are all layers one after another */
+	chain = Gfx_MakePartMipmaps(part, buffer);
+	lvls  = Gfx_MipmapsLevels(width, height);
+
+	for (lvl = 1, cur = chain; lvl <= lvls; lvl++) {
+		x /= 2; y /= 2;
+		if (width > 1)  width /= 2;
+		if (height > 1) height /= 2;
+
+		_glTexSubImage3D(GL_TEXTURE_2D_ARRAY, lvl, x, y, layer, width, height, layers, PIXEL_FORMAT, GL_UNSIGNED_BYTE, cur);
+		cur += Bitmap_DataSize(width, height * layers);
+	}
+	if (chain != buffer) Mem_Free(chain);
+	return true;
+}
+
+static bool GL_BindTexArray(GfxResourceID texId) {
+	bool isArray = texId && GL_FindTexArray(texId);
+	if (isArray != gl_texArrayBound) {
+		gl_texArrayBound = isArray;
+		Gfx_SwitchProgram();
+	}
+
+	if (isArray) glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+	return isArray;
+}
+
+static void GL_FreeTexArray(GfxResourceID texId) {
+	struct GLTexArray* arr = GL_FindTexArray(texId);
+	if (arr) arr->ID = GFX_NULL;
+}
+
+static void GL_CheckSupport(void) {
+	const static String arrayExt = String_FromConst("GL_EXT_texture_array");
+	String extensions = String_FromReadonly(glGetString(GL_EXTENSIONS));
+
+	/* glTexImage3D is core since OpenGL 1.2, so only the shader side needs the extension */
+	if (!String_CaselessContains(&extensions, &arrayExt)) return;
+	_glTexImage3D    = (FUNC_GLTEXIMAGE3D)GLContext_GetAddress("glTexImage3D");
+	_glTexSubImage3D = (FUNC_GLTEXSUBIMAGE3D)GLContext_GetAddress("glTexSubImage3D");
+
+	if (!_glTexImage3D || !_glTexSubImage3D) return;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &Gfx.MaxTexLayers);
+}
+
 static void GL_InitState(void) {
 	glEnableVertexAttribArray(0);
 	glEnableVertexAttribArray(1);
@@ -1569,7 +2129,15 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  sizeof(VertexP3fT2fC4b), (void*)(offset + 12));
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, sizeof(VertexP3fT2fC4b), (void*)(offset + 16));
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
- }
+}
+
+/* OpenGL ES 2.0 has no multi draw, so ranges are just drawn one at a time */
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount) {
+	int i;
+	for (i = 0; i < rangesCount; i++) {
+		Gfx_DrawIndexedVb_TrisT2fC4b(counts[i], starts[i]);
+	}
+}
 #endif
 
 
@@ -1577,14 +2145,14 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 *------------------------------------------------------OpenGL legacy------------------------------------------------------*
 *#########################################################################################################################*/
 #ifndef CC_BUILD_GLMODERN
+/* Fixed function pipeline can't sample texture arrays (Gfx.MaxTexLayers is always 0) */
+GfxResourceID Gfx_CreateTextureArray(Bitmap* bmp, int layers, uint8_t* mipmaps) { return GFX_NULL; }
+
 static PackedCol gl_lastFogCol;
 static float gl_lastFogEnd = -1, gl_lastFogDensity = -1;
 static int gl_lastFogMode = -1;
 
-void Gfx_SetFog(bool enabled) {
-	gfx_fogEnabled = enabled;
-	gl_Toggle(GL_FOG);
-}
+void Gfx_SetFog(bool enabled) { gl_CachedToggle(gfx_fogEnabled, GL_FOG); }
 
 void Gfx_SetFogCol(PackedCol col) {
 	float rgba[4];
@@ -1617,9 +2185,16 @@ void Gfx_SetFogMode(FogFunc func) {
 	gl_lastFogMode = func;
 }
 
-void Gfx_SetTexturing(bool enabled) { gl_Toggle(GL_TEXTURE_2D); }
-void Gfx_SetAlphaTest(bool enabled) { gl_Toggle(GL_ALPHA_TEST); }
+static bool gl_texturing, gl_alphaTest;
+static int gl_alphaFunc = -1;
+static float gl_alphaRef;
+
+void Gfx_SetTexturing(bool enabled) { gl_CachedToggle(gl_texturing, GL_TEXTURE_2D); }
+void Gfx_SetAlphaTest(bool enabled) { gl_CachedToggle(gl_alphaTest, GL_ALPHA_TEST); }
 void Gfx_SetAlphaTestFunc(CompareFunc func, float value) {
+	if (func == gl_alphaFunc && value == gl_alphaRef) { gl_callsElided++; return; }
+	gl_callsIssued++;
+	gl_alphaFunc = func; gl_alphaRef = value;
 	glAlphaFunc(gl_compare[func], value);
 }
 
@@ -1726,8 +2301,36 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	glDrawElements(GL_TRIANGLES,        ICOUNT(verticesCount),   GL_UNSIGNED_SHORT, NULL);
 }
 
+typedef void (APIENTRY *FUNC_GLMULTIDRAWELEMENTS) (GLenum mode, const GLsizei* count, GLenum type, const GLvoid* const* indices, GLsizei primcount);
+static FUNC_GLMULTIDRAWELEMENTS _glMultiDrawElements;
+
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount) {
+	GLsizei indicesCounts[GFX_MAX_DRAW_RANGES];
+	const GLvoid* indicesOffsets[GFX_MAX_DRAW_RANGES];
+	int i, count = 0;
+
+	for (i = 0; i < rangesCount; i++) {
+		/* Instead of offsetting the vertex pointers, each range starts further into the shared */
+		/* index buffer. But that only works for ranges within the first GFX_MAX_VERTICES vertices */
+		if (!_glMultiDrawElements || starts[i] + counts[i] > GFX_MAX_VERTICES) {
+			Gfx_DrawIndexedVb_TrisT2fC4b(counts[i], starts[i]); continue;
+		}
+
+		indicesCounts[count]  = ICOUNT(counts[i]);
+		indicesOffsets[count] = (const GLvoid*)(uintptr_t)(ICOUNT(starts[i]) * 2);
+		count++;
+	}
+	if (!count) return;
+
+	glVertexPointer(3, GL_FLOAT,        sizeof(VertexP3fT2fC4b), (void*)0);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexP3fT2fC4b), (void*)12);
+	glTexCoordPointer(2, GL_FLOAT,      sizeof(VertexP3fT2fC4b), (void*)16);
+	_glMultiDrawElements(GL_TRIANGLES, indicesCounts, GL_UNSIGNED_SHORT, indicesOffsets, count);
+}
+
 static void GL_CheckSupport(void) {
-	const static String vboExt = String_FromConst("GL_ARB_vertex_buffer_object");
+	const static String vboExt   = String_FromConst("GL_ARB_vertex_buffer_object");
+	const static String multiExt = String_FromConst("GL_EXT_multi_draw_arrays");
 	String extensions = String_FromReadonly(glGetString(GL_EXTENSIONS));
 	String version    = String_FromReadonly(glGetString(GL_VERSION));
 
@@ -1751,6 +2354,13 @@ static void GL_CheckSupport(void) {
 		Logger_Abort("Only OpenGL 1.1 supported.\n\n" \
 			"Compile the game with CC_BUILD_GL11, or ask on the classicube forums for it");
 	}
+
+	/* Supported in core since 1.4 */
+	if (major > 1 || (major == 1 && minor >= 4)) {
+		_glMultiDrawElements = (FUNC_GLMULTIDRAWELEMENTS)GLContext_GetAddress("glMultiDrawElements");
+	} else if (String_CaselessContains(&extensions, &multiExt)) {
+		_glMultiDrawElements = (FUNC_GLMULTIDRAWELEMENTS)GLContext_GetAddress("glMultiDrawElementsEXT");
+	}
 	Gfx.CustomMipmapsLevels = true;
 }
 #else
@@ -1792,6 +2402,11 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	gl_dynamicListData = vertices;
 }
 
+void Gfx_UnlockDynamicVb(GfxResourceID vb) {
+	gl_activeList      = gl_DYNAMICLISTID;
+	gl_dynamicListData = gl_lockData;
+}
+
 static GfxResourceID gl_lastPartialList;
 void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	/* TODO: This renders the whole map, bad performance!! FIX FIX */
@@ -1800,6 +2415,11 @@ void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex) {
 	gl_lastPartialList = gl_activeList;
 }
 
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount) {
+	/* Display list always draws the whole chunk anyways */
+	Gfx_DrawIndexedVb_TrisT2fC4b(0, 0);
+}
+
 static void GL_CheckSupport(void) {
 	Gfx_MakeIndices(gl_indices, GFX_MAX_INDICES);
 }
@@ -37,6 +37,8 @@ void Gfx_Free(void);
 CC_VAR extern struct _GfxData {
 	/* Maximum dimensions textures can be created up to. (usually 1024 to 16384) */
 	int MaxTexWidth, MaxTexHeight;
+	/* Maximum number of layers a texture array can have. (0 if texture arrays are unsupported) */
+	int MaxTexLayers;
 	float MinZNear;
 	/* Whether context graphics has been lost (all creation/render fails) */
 	bool LostContext;
@@ -49,7 +51,7 @@ CC_VAR extern struct _GfxData {
 	ScheduledTaskCallback LostContextFunction;
 } Gfx;
 
-extern String Gfx_ApiInfo[7];
+extern String Gfx_ApiInfo[8];
 extern GfxResourceID Gfx_defaultIb;
 extern GfxResourceID Gfx_quadVb, Gfx_texVb;
 
@@ -61,7 +63,16 @@ extern GfxResourceID Gfx_quadVb, Gfx_texVb;
 /* NOTE: Only set mipmaps to true if Gfx_Mipmaps is also true, because whether textures
 use mipmapping may be either a per-texture or global state depending on the backend. */
 CC_API GfxResourceID Gfx_CreateTexture(Bitmap* bmp, bool managedPool, bool mipmaps);
+/* Creates a new texture, uploading the given mipmaps chain. (see Gfx_GenMipmapChain) */
+/* NOTE: Pass NULL for mipmaps to create a texture without mipmaps. */
+CC_API GfxResourceID Gfx_CreateTextureMips(Bitmap* bmp, bool managedPool, uint8_t* mipmaps);
+/* Creates a new texture array, from a bitmap of square layers stacked on top of each other. */
+/* V texture coordinates then select the layer, with V 0-1 being layer 0, V 1-2 being layer 1, etc */
+/* NOTE: mipmaps is either NULL, or the chain generated for the whole bitmap. (see Gfx_GenMipmapChain) */
+CC_API GfxResourceID Gfx_CreateTextureArray(Bitmap* bmp, int layers, uint8_t* mipmaps);
 /* Updates a region of the given texture. (and mipmapped regions if mipmaps) */
+/* NOTE: For texture arrays, y is relative to the top of the bitmap, and part must either be */
+/* inside one layer or cover whole layers. (i.e. y and height both multiples of layer height) */
 CC_API void Gfx_UpdateTexturePart(GfxResourceID texId, int x, int y, Bitmap* part, bool mipmaps);
 /* Sets the currently active texture. */
 CC_API void Gfx_BindTexture(GfxResourceID texId);
@@ -134,6 +145,11 @@ CC_API void Gfx_DeleteIb(GfxResourceID* ib);
 CC_API void Gfx_SetVertexFormat(VertexFormat fmt);
 /* Updates the data of a dynamic vertex buffer. */
 CC_API void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount);
+/* Locks a dynamic vertex buffer, returning memory that count vertices can be directly written into. */
+/* NOTE: Previous contents of the buffer are discarded. You MUST call Gfx_UnlockDynamicVb after writing. */
+CC_API void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count);
+/* Unlocks a dynamic vertex buffer locked by Gfx_LockDynamicVb, then makes it the active vertex buffer. */
+CC_API void  Gfx_UnlockDynamicVb(GfxResourceID vb);
 /* Renders vertices from the currently bound vertex buffer as lines. */
 CC_API void Gfx_DrawVb_Lines(int verticesCount);
 /* Renders vertices from the currently bound vertex and index buffer as triangles. */
@@ -143,6 +159,11 @@ CC_API void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex);
 CC_API void Gfx_DrawVb_IndexedTris(int verticesCount);
 /* Special case Gfx_DrawVb_IndexedTris_Range for map renderer */
 void Gfx_DrawIndexedVb_TrisT2fC4b(int verticesCount, int startVertex);
+/* Maximum number of ranges that can be passed to Gfx_DrawIndexedVb_MultiT2fC4b. */
+#define GFX_MAX_DRAW_RANGES 8
+/* Same as calling Gfx_DrawIndexedVb_TrisT2fC4b for each range, but submits all of the ranges */
+/* in a single draw call when the backend supports doing so. (e.g. glMultiDrawElements) */
+void Gfx_DrawIndexedVb_MultiT2fC4b(const int* counts, const int* starts, int rangesCount);
 
 /* Loads the given matrix over the currently active matrix. */
 CC_API void Gfx_LoadMatrix(MatrixType type, struct Matrix* matrix);
@@ -174,6 +195,16 @@ void Gfx_MakeApiInfo(void);
 /* NOTE: This is information such as current free memory, etc. */
 void Gfx_UpdateApiInfo(void);
 
+#ifdef CC_BUILD_NULLGFX
+/* What would have been sent to the GPU, as counted by the null backend. */
+CC_VAR extern struct _GfxStats {
+	int Frames, DrawCalls, StateChanges, TextureBinds, BufferBinds;
+	uint64_t Vertices, BufferBytes, TextureBytes;
+} Gfx_Stats;
+/* Resets all counters in Gfx_Stats to 0. */
+void Gfx_ResetStats(void);
+#endif
+
 /* Raises ContextLost event and updates state for lost contexts. */
 void Gfx_LoseContext(const char* reason);
 /* Raises ContextRecreated event and restores state from lost contexts. */
@@ -209,9 +240,17 @@ void Gfx_SetupAlphaState(uint8_t draw);
 /* Undoes changes to alpha test/blending state by Gfx_SetupAlphaState. */
 void Gfx_RestoreAlphaState(uint8_t draw);
 /* Generates the next mipmaps level bitmap for the given bitmap. */
-void Gfx_GenMipmaps(int width, int height, uint8_t* lvlScan0, uint8_t* scan0);
+void Gfx_GenMipmaps(int width, int height, uint8_t* lvlScan0, int srcWidth, int srcHeight, uint8_t* scan0);
 /* Returns the maximum number of mipmaps levels used for given size. */
 int Gfx_MipmapsLevels(int width, int height);
+/* Returns the number of bytes needed to store all the mipmaps levels for given size. */
+int Gfx_MipmapsSize(int width, int height);
+/* Generates all the mipmaps levels for the given bitmap, stored one after another in mipmaps. */
+/* NOTE: Does not touch any graphics state, so can be called from any thread. */
+void Gfx_GenMipmapChain(Bitmap* bmp, uint8_t* mipmaps);
+/* Generates the mipmaps levels of layers beg to end, for a bitmap of square layers. (see Gfx_CreateTextureArray) */
+/* NOTE: Output has the same layout as Gfx_GenMipmapChain, so can be called for different layers at once. */
+void Gfx_GenMipmapLayers(Bitmap* bmp, int layers, int beg, int end, uint8_t* mipmaps);
 
 /* Statically initialises the position and dimensions of this texture */
 #define Tex_Rect(x,y, width,height) x,y,width,height
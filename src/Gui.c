@@ -11,6 +11,7 @@
 #include "Logger.h"
 #include "Platform.h"
 #include "Bitmap.h"
+#include "Profiler.h"
 
 bool Gui_ClassicTexture, Gui_ClassicTabList, Gui_ClassicMenu;
 int  Gui_Chatlines;
@@ -243,6 +244,7 @@ void Gui_FreeOverlay(void* overlay) {
 
 void Gui_RenderGui(double delta) {
 	bool showHUD, hudBefore;
+	Profiler_Begin("Gui");
 	Gfx_Mode2D(Game.Width, Game.Height);
 
 	showHUD   = !Gui_Active || !Gui_Active->HidesHUD;
@@ -255,6 +257,7 @@ void Gui_RenderGui(double delta) {
 
 	if (Gui_OverlaysCount) { Elem_Render(Gui_Overlays[0], delta); }
 	Gfx_Mode3D();
+	Profiler_End();
 }
 
 void Gui_OnResize(void) {
@@ -339,3 +342,76 @@ void TextAtlas_AddInt(struct TextAtlas* atlas, int value, VertexP3fT2fC4b** vert
 		TextAtlas_Add(atlas, digits[i] - '0' , vertices);
 	}
 }
+
+
+/*########################################################################################################################*
+*------------------------------------------------------TextureBatch-------------------------------------------------------*
+*#########################################################################################################################*/
+bool TextureBatch_Begin(struct TextureBatch* batch, int maxQuads) {
+	if (!maxQuads) { batch->Count = 0; return false; }
+
+	if (maxQuads > batch->Capacity) {
+		TextureBatch_Free(batch);
+		batch->Vertices = Mem_Alloc(maxQuads * 4, sizeof(VertexP3fT2fC4b), "batch vertices");
+		batch->TexIds   = Mem_Alloc(maxQuads,     sizeof(GfxResourceID),   "batch textures");
+		batch->Capacity = maxQuads;
+	}
+
+	if (!batch->Vb) {
+		batch->Vb    = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FT2FC4B, batch->Capacity * 4);
+		batch->Dirty = true;
+	}
+
+	if (!batch->Dirty) return false;
+	batch->Count = 0;
+	return true;
+}
+
+void TextureBatch_Add(struct TextureBatch* batch, const struct Texture* tex) {
+	VertexP3fT2fC4b* ptr;
+	PackedCol white = PACKEDCOL_WHITE;
+	if (!tex->ID || batch->Count == batch->Capacity) return;
+
+	ptr = &batch->Vertices[batch->Count * 4];
+	Gfx_Make2DQuad(tex, white, &ptr);
+	batch->TexIds[batch->Count++] = tex->ID;
+}
+
+void TextureBatch_Render(struct TextureBatch* batch) {
+	int beg, end;
+	if (!batch->Count) return;
+	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
+
+#ifdef CC_BUILD_GL11
+	/* Dynamic VBs are just client side memory, so must always point to the vertices again */
+	Gfx_SetDynamicVbData(batch->Vb, batch->Vertices, batch->Count * 4);
+#else
+	if (batch->Dirty) {
+		Gfx_SetDynamicVbData(batch->Vb, batch->Vertices, batch->Count * 4);
+	} else {
+		Gfx_BindVb(batch->Vb);
+	}
+#endif
+	batch->Dirty = false;
+
+	for (beg = 0; beg < batch->Count; beg = end) {
+		for (end = beg + 1; end < batch->Count; end++) {
+			if (batch->TexIds[end] != batch->TexIds[beg]) break;
+		}
+
+		Gfx_BindTexture(batch->TexIds[beg]);
+		Gfx_DrawVb_IndexedTris_Range((end - beg) * 4, beg * 4);
+	}
+}
+
+void TextureBatch_Free(struct TextureBatch* batch) {
+	Gfx_DeleteVb(&batch->Vb);
+	Mem_Free(batch->Vertices);
+	Mem_Free(batch->TexIds);
+
+	batch->Vertices = NULL;
+	batch->TexIds   = NULL;
+	batch->Count    = 0;
+	batch->Capacity = 0;
+	batch->Dirty    = true;
+}
@@ -140,6 +140,22 @@ void TextAtlas_Free(struct TextAtlas* atlas);
 void TextAtlas_Add(struct TextAtlas* atlas, int charI, VertexP3fT2fC4b** vertices);
 void TextAtlas_AddInt(struct TextAtlas* atlas, int value, VertexP3fT2fC4b** vertices);
 
+/* Textured quads retained in a dynamic vertex buffer, which is only updated when the batch is Dirty. */
+struct TextureBatch {
+	GfxResourceID Vb;
+	VertexP3fT2fC4b* Vertices;
+	GfxResourceID* TexIds;
+	int Count, Capacity;
+	bool Dirty; /* Whether quads need to be added again. (e.g. a texture was changed or moved) */
+};
+/* Returns whether the quads of the batch must be added again with TextureBatch_Add. */
+bool TextureBatch_Begin(struct TextureBatch* batch, int maxQuads);
+/* Adds a quad for the given texture. Textures with no ID are skipped. */
+void TextureBatch_Add(struct TextureBatch* batch, const struct Texture* tex);
+/* Draws the quads, using one draw call for each run of quads with the same texture. */
+void TextureBatch_Render(struct TextureBatch* batch);
+void TextureBatch_Free(struct TextureBatch* batch);
+
 
 #define Elem_Init(elem)           (elem)->VTABLE->Init(elem)
 #define Elem_Render(elem, delta)  (elem)->VTABLE->Render(elem, delta)
@@ -78,6 +78,8 @@ static void HeldBlockRenderer_ResetHeldState(void) {
 	held_entity.MobTextureId = p->MobTextureId;
 	held_entity.uScale       = p->uScale;
 	held_entity.vScale       = p->vScale;
+	held_entity.uOffset      = p->uOffset;
+	held_entity.vOffset      = p->vOffset;
 }
 
 static void HeldBlockRenderer_SetBaseOffset(void) {
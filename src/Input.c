@@ -130,7 +130,7 @@ const uint8_t KeyBind_Defaults[KEYBIND_COUNT] = {
 	KEY_F5, KEY_F1, KEY_F7, 'C', 
 	KEY_LCTRL, 0, 0, 0, 
 	KEY_F6, KEY_LALT, KEY_F8, 
-	'G', KEY_F10, 0
+	'G', KEY_F10, 0, KEY_F9
 };
 const char* KeyBind_Names[KEYBIND_COUNT] = {
 	"Forward", "Back", "Left", "Right",
@@ -141,7 +141,7 @@ const char* KeyBind_Names[KEYBIND_COUNT] = {
 	"ThirdPerson", "HideGUI", "AxisLines", "ZoomScrolling", 
 	"HalfSpeed", "MouseLeft", "MouseMiddle", "MouseRight", 
 	"AutoRotate", "HotbarSwitching", "SmoothCamera", 
-	"DropBlock", "IDOverlay", "BreakableLiquids"
+	"DropBlock", "IDOverlay", "BreakableLiquids", "Profiler"
 };
 
 bool KeyBind_IsPressed(KeyBind binding) { return Key_Pressed[KeyBinds[binding]]; }
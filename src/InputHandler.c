@@ -169,6 +169,9 @@ static bool InputHandler_HandleNonClassicKey(Key key) {
 	} else if (key == KeyBinds[KEYBIND_IDOVERLAY]) {
 		if (Gui_OverlaysCount) return true;
 		Gui_ShowOverlay(TexIdsOverlay_MakeInstance(), false);
+	} else if (key == KeyBinds[KEYBIND_PROFILER]) {
+		if (Gui_OverlaysCount) return true;
+		Gui_ShowOverlay(ProfilerOverlay_MakeInstance(), false);
 	} else if (key == KeyBinds[KEYBIND_BREAK_LIQUIDS]) {
 		InputHandler_Toggle(key, &Game_BreakableLiquids,
 			"  &eBreakable liquids is &aenabled",
@@ -261,16 +264,18 @@ static bool InputHandler_PushbackPlace(struct AABB* blockBB) {
 }
 
 static bool InputHandler_IntersectsOthers(Vector3 pos, BlockID block) {
+	EntityID ids[ENTITIES_MAX_COUNT];
 	struct AABB blockBB, entityBB;
 	struct Entity* entity;
-	int id;
+	int i, count;
 
 	Vector3_Add(&blockBB.Min, &pos, &Blocks.MinBB[block]);
 	Vector3_Add(&blockBB.Max, &pos, &Blocks.MaxBB[block]);
 	
-	for (id = 0; id < ENTITIES_SELF_ID; id++) {
-		entity = Entities.List[id];
-		if (!entity) continue;
+	count = Entities_QueryNearby(pos, 1.0f, ids);
+	for (i = 0; i < count; i++) {
+		entity = Entities.List[ids[i]];
+		if (!entity || ids[i] == ENTITIES_SELF_ID) continue;
 
 		Entity_GetBounds(entity, &entityBB);
 		entityBB.Min.Y += 1.0f / 32.0f; /* when player is exactly standing on top of ground */
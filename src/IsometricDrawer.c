@@ -6,10 +6,14 @@
 #include "Block.h"
 #include "TexturePack.h"
 #include "Block.h"
+#include "Event.h"
+#include "Platform.h"
+#include "GameStructs.h"
+#include "Funcs.h"
 
-static float iso_scale;
 static VertexP3fT2fC4b* iso_vertices;
 static VertexP3fT2fC4b* iso_vertices_base;
+static int iso_maxVertices, iso_batchVertices;
 static GfxResourceID iso_vb;
 
 static bool iso_cacheInitalised;
@@ -23,7 +27,12 @@ static PackedCol iso_colXSide, iso_colZSide, iso_colYBottom;
 
 static struct Matrix iso_transform;
 static Vector3 iso_pos;
-static int iso_lastTexIndex, iso_texIndex;
+
+/* Max number of blocks buffered before they are flushed to the GPU */
+#define ISO_MAX_ICONS 128
+struct IsometricIcon { BlockID Block; float Scale; Vector3 Pos; };
+static struct IsometricIcon iso_icons[ISO_MAX_ICONS];
+static int iso_iconsCount;
 
 static void IsometricDrawer_RotateX(float cosA, float sinA) {
 	float y   = cosA  * iso_pos.Y + sinA * iso_pos.Z;
@@ -49,35 +58,34 @@ static void IsometricDrawer_InitCache(void) {
 	Matrix_Mul(&iso_transform, &rotY, &rotX);
 }
 
-static void IsometricDrawer_Flush(void) {
-	int count;
-	if (iso_lastTexIndex != -1) {
-		Gfx_BindTexture(Atlas1D_TexIds[iso_lastTexIndex]);
-		count = (int)(iso_vertices - iso_vertices_base);
-		Gfx_UpdateDynamicVb_IndexedTris(iso_vb, iso_vertices_base, count);
-	}
 
-	iso_lastTexIndex = iso_texIndex;
-	iso_vertices     = iso_vertices_base;
-}
+/*########################################################################################################################*
+*-------------------------------------------------------Block cache-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Geometry of each block, at unit scale and centred on origin. (only depends on block definition and terrain atlas) */
+static VertexP3fT2fC4b iso_blockVertices[BLOCK_COUNT][ISOMETRICDRAWER_MAXVERTICES];
+/* 1D atlas that each quad of each block's geometry uses. */
+static uint16_t iso_blockAtlas[BLOCK_COUNT][ISOMETRICDRAWER_MAXVERTICES / 4];
+static uint8_t iso_blockCount[BLOCK_COUNT];
+static bool iso_blockCached[BLOCK_COUNT];
+static uint16_t* iso_quadAtlas;
 
 static TextureLoc IsometricDrawer_GetTexLoc(BlockID block, Face face) {
-	TextureLoc loc = Block_Tex(block, face);
-	iso_texIndex   = Atlas1D_Index(loc);
-
-	if (iso_lastTexIndex != iso_texIndex) IsometricDrawer_Flush();
+	TextureLoc loc   = Block_Tex(block, face);
+	*iso_quadAtlas++ = Atlas1D_Index(loc);
 	return loc;
 }
 
 static void IsometricDrawer_SpriteZQuad(BlockID block, bool firstPart) {
 	TextureLoc loc = Block_Tex(block, FACE_ZMAX);
-	TextureRec rec = Atlas1D_TexRec(loc, 1, &iso_texIndex);
+	int texIndex;
+	TextureRec rec = Atlas1D_TexRec(loc, 1, &texIndex);
 
 	VertexP3fT2fC4b v;
 	float minX, maxX, minY, maxY;
 	float x1, x2;
 
-	if (iso_lastTexIndex != iso_texIndex) IsometricDrawer_Flush();
+	*iso_quadAtlas++ = texIndex;
 	v.Col = iso_col;
 	Block_Tint(v.Col, block);
 
@@ -86,12 +94,12 @@ static void IsometricDrawer_SpriteZQuad(BlockID block, bool firstPart) {
 	rec.U1 = (firstPart ? 0.0f : 0.5f);
 	rec.U2 = (firstPart ? 0.5f : 1.0f) * UV2_Scale;
 
-	minX = iso_scale * (1.0f - x1   * 2.0f) + iso_pos.X;
-	maxX = iso_scale * (1.0f - x2   * 2.0f) + iso_pos.X;
-	minY = iso_scale * (1.0f - 0.0f * 2.0f) + iso_pos.Y;
-	maxY = iso_scale * (1.0f - 1.1f * 2.0f) + iso_pos.Y;
+	minX = 1.0f - x1   * 2.0f;
+	maxX = 1.0f - x2   * 2.0f;
+	minY = 1.0f - 0.0f * 2.0f;
+	maxY = 1.0f - 1.1f * 2.0f;
 
-	v.Z = iso_pos.Z;
+	v.Z = 0.0f;
 	v.X = minX; v.Y = minY; v.U = rec.U2; v.V = rec.V2; *iso_vertices++ = v;
 	            v.Y = maxY;               v.V = rec.V1; *iso_vertices++ = v;
 	v.X = maxX;             v.U = rec.U1;               *iso_vertices++ = v;
@@ -100,13 +108,14 @@ static void IsometricDrawer_SpriteZQuad(BlockID block, bool firstPart) {
 
 static void IsometricDrawer_SpriteXQuad(BlockID block, bool firstPart) {
 	TextureLoc loc = Block_Tex(block, FACE_XMAX);
-	TextureRec rec = Atlas1D_TexRec(loc, 1, &iso_texIndex);
-	
+	int texIndex;
+	TextureRec rec = Atlas1D_TexRec(loc, 1, &texIndex);
+
 	VertexP3fT2fC4b v;
 	float minY, maxY, minZ, maxZ;
 	float z1, z2;
 
-	if (iso_lastTexIndex != iso_texIndex) IsometricDrawer_Flush();
+	*iso_quadAtlas++ = texIndex;
 	v.Col = iso_col;
 	Block_Tint(v.Col, block);
 
@@ -115,44 +124,24 @@ static void IsometricDrawer_SpriteXQuad(BlockID block, bool firstPart) {
 	rec.U1 = (firstPart ? 0.0f : 0.5f);
 	rec.U2 = (firstPart ? 0.5f : 1.0f) * UV2_Scale;
 
-	minY = iso_scale * (1.0f - 0.0f * 2.0f) + iso_pos.Y;
-	maxY = iso_scale * (1.0f - 1.1f * 2.0f) + iso_pos.Y;
-	minZ = iso_scale * (1.0f - z1   * 2.0f) + iso_pos.Z;
-	maxZ = iso_scale * (1.0f - z2   * 2.0f) + iso_pos.Z;
+	minY = 1.0f - 0.0f * 2.0f;
+	maxY = 1.0f - 1.1f * 2.0f;
+	minZ = 1.0f - z1   * 2.0f;
+	maxZ = 1.0f - z2   * 2.0f;
 
-	v.X = iso_pos.X;
+	v.X = 0.0f;
 	v.Y = minY; v.Z = minZ; v.U = rec.U2; v.V = rec.V2; *iso_vertices++ = v;
 	v.Y = maxY;                           v.V = rec.V1; *iso_vertices++ = v;
 	            v.Z = maxZ; v.U = rec.U1;               *iso_vertices++ = v;
 	v.Y = minY;                           v.V = rec.V2; *iso_vertices++ = v;
 }
 
-void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, GfxResourceID vb) {
-	IsometricDrawer_InitCache();
-	iso_lastTexIndex = -1;
-	iso_vertices = vertices;
-	iso_vertices_base = vertices;
-	iso_vb = vb;
-
-	Gfx_LoadMatrix(MATRIX_VIEW, &iso_transform);
-}
-
-void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
+static void IsometricDrawer_CacheBlock(BlockID block) {
 	bool bright = Blocks.FullBright[block];
 	Vector3 min, max;
-	if (Blocks.Draw[block] == DRAW_GAS) return;
 
-	/* isometric coords size: cosY * -scale - sinY * scale */
-	/* we need to divide by (2 * cosY), as the calling function expects size to be in pixels. */
-	iso_scale = size / (2.0f * iso_cosY);
-
-	/* screen to isometric coords (cos(-x) = cos(x), sin(-x) = -sin(x)) */
-	iso_pos.X = x; iso_pos.Y = y; iso_pos.Z = 0.0f;
-	IsometricDrawer_RotateX(iso_cosX, -iso_sinX);
-	IsometricDrawer_RotateY(iso_cosY, -iso_sinY);
-
-	/* See comment in GfxCommon_Draw2DTexture() */
-	iso_pos.X -= 0.5f; iso_pos.Y -= 0.5f;
+	iso_vertices  = iso_blockVertices[block];
+	iso_quadAtlas = iso_blockAtlas[block];
 
 	if (Blocks.Draw[block] == DRAW_SPRITE) {
 		IsometricDrawer_SpriteXQuad(block, true);
@@ -165,31 +154,153 @@ void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
 		Drawer.MaxBB = Blocks.MaxBB[block]; Drawer.MaxBB.Y = 1.0f - Drawer.MaxBB.Y;
 		min = Blocks.MinBB[block]; max = Blocks.MaxBB[block];
 
-		Drawer.X1 = iso_scale * (1.0f - min.X * 2.0f) + iso_pos.X; 
-		Drawer.X2 = iso_scale * (1.0f - max.X * 2.0f) + iso_pos.X;
-		Drawer.Y1 = iso_scale * (1.0f - min.Y * 2.0f) + iso_pos.Y; 
-		Drawer.Y2 = iso_scale * (1.0f - max.Y * 2.0f) + iso_pos.Y;
-		Drawer.Z1 = iso_scale * (1.0f - min.Z * 2.0f) + iso_pos.Z; 
-		Drawer.Z2 = iso_scale * (1.0f - max.Z * 2.0f) + iso_pos.Z;
+		Drawer.X1 = 1.0f - min.X * 2.0f; Drawer.X2 = 1.0f - max.X * 2.0f;
+		Drawer.Y1 = 1.0f - min.Y * 2.0f; Drawer.Y2 = 1.0f - max.Y * 2.0f;
+		Drawer.Z1 = 1.0f - min.Z * 2.0f; Drawer.Z2 = 1.0f - max.Z * 2.0f;
 
 		Drawer.Tinted  = Blocks.Tinted[block];
 		Drawer.TintCol = Blocks.FogCol[block];
 
-		Drawer_XMax(1, bright ? iso_col : iso_colXSide, 
+		Drawer_XMax(1, bright ? iso_col : iso_colXSide,
 			IsometricDrawer_GetTexLoc(block, FACE_XMAX), &iso_vertices);
-		Drawer_ZMin(1, bright ? iso_col : iso_colZSide, 
+		Drawer_ZMin(1, bright ? iso_col : iso_colZSide,
 			IsometricDrawer_GetTexLoc(block, FACE_ZMIN), &iso_vertices);
-		Drawer_YMax(1, iso_col, 
+		Drawer_YMax(1, iso_col,
 			IsometricDrawer_GetTexLoc(block, FACE_YMAX), &iso_vertices);
 	}
+
+	iso_blockCount[block]  = (uint8_t)(iso_vertices - iso_blockVertices[block]);
+	iso_blockCached[block] = true;
 }
 
-void IsometricDrawer_EndBatch(void) {
-	if (iso_vertices != iso_vertices_base) { 
-		iso_lastTexIndex = iso_texIndex; 
-		IsometricDrawer_Flush(); 
+static void IsometricDrawer_ClearCache(void* obj) {
+	Mem_Set(iso_blockCached, 0, sizeof(iso_blockCached));
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Batching---------------------------------------------------------*
+*#########################################################################################################################*/
+void IsometricDrawer_Flush(void) {
+	int offsets[ATLAS1D_MAX_ATLASES];
+	struct IsometricIcon* icon;
+	VertexP3fT2fC4b* src;
+	VertexP3fT2fC4b* dst;
+	VertexP3fT2fC4b v;
+	int i, j, k, tex, atlases = 0, count, total = 0, beg;
+	int icons = iso_iconsCount;
+
+	/* Count how many vertices use each 1D atlas */
+	Mem_Set(offsets, 0, sizeof(offsets));
+	for (i = 0; i < icons; i++) {
+		icon = &iso_icons[i];
+
+		for (j = 0; j < iso_blockCount[icon->Block] / 4; j++) {
+			tex = iso_blockAtlas[icon->Block][j];
+			offsets[tex] += 4;
+			atlases = max(atlases, tex + 1);
+		}
+	}
+
+	/* Vertices using the same 1D atlas are placed next to each other */
+	for (i = 0; i < atlases; i++) {
+		count = offsets[i]; offsets[i] = total; total += count;
+	}
+	iso_iconsCount    = 0;
+	iso_batchVertices = 0;
+	if (!total) return;
+
+	for (i = 0; i < icons; i++) {
+		icon = &iso_icons[i];
+		src  = iso_blockVertices[icon->Block];
+
+		for (j = 0; j < iso_blockCount[icon->Block] / 4; j++, src += 4) {
+			tex = iso_blockAtlas[icon->Block][j];
+			dst = iso_vertices_base + offsets[tex];
+			offsets[tex] += 4;
+
+			for (k = 0; k < 4; k++) {
+				v   = src[k];
+				v.X = v.X * icon->Scale + icon->Pos.X;
+				v.Y = v.Y * icon->Scale + icon->Pos.Y;
+				v.Z = v.Z * icon->Scale + icon->Pos.Z;
+				dst[k] = v;
+			}
+		}
+	}
+
+	/* offsets[i] is now the end of the vertices using atlas i */
+	Gfx_SetDynamicVbData(iso_vb, iso_vertices_base, total);
+	for (i = 0, beg = 0; i < atlases; i++) {
+		if (offsets[i] == beg) continue;
+
+		Gfx_BindTexture(Atlas1D_TexIds[i]);
+		Gfx_DrawVb_IndexedTris_Range(offsets[i] - beg, beg);
+		beg = offsets[i];
+	}
+}
+
+void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, int maxVertices, GfxResourceID vb) {
+	IsometricDrawer_InitCache();
+	iso_iconsCount    = 0;
+	iso_batchVertices = 0;
+	iso_vertices_base = vertices;
+	iso_maxVertices   = maxVertices;
+	iso_vb = vb;
+
+	Gfx_LoadMatrix(MATRIX_VIEW, &iso_transform);
+}
+
+void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y) {
+	struct IsometricIcon* icon;
+	if (Blocks.Draw[block] == DRAW_GAS) return;
+
+	if (!iso_blockCached[block]) IsometricDrawer_CacheBlock(block);
+	if (iso_iconsCount == ISO_MAX_ICONS || iso_batchVertices + iso_blockCount[block] > iso_maxVertices) {
+		IsometricDrawer_Flush();
 	}
 
-	iso_lastTexIndex = -1;
+	icon = &iso_icons[iso_iconsCount++];
+	iso_batchVertices += iso_blockCount[block];
+
+	/* isometric coords size: cosY * -scale - sinY * scale */
+	/* we need to divide by (2 * cosY), as the calling function expects size to be in pixels. */
+	icon->Block = block;
+	icon->Scale = size / (2.0f * iso_cosY);
+
+	/* screen to isometric coords (cos(-x) = cos(x), sin(-x) = -sin(x)) */
+	iso_pos.X = x; iso_pos.Y = y; iso_pos.Z = 0.0f;
+	IsometricDrawer_RotateX(iso_cosX, -iso_sinX);
+	IsometricDrawer_RotateY(iso_cosY, -iso_sinY);
+
+	/* See comment in GfxCommon_Draw2DTexture() */
+	iso_pos.X -= 0.5f; iso_pos.Y -= 0.5f;
+	icon->Pos = iso_pos;
+}
+
+void IsometricDrawer_EndBatch(void) {
+	if (iso_iconsCount) IsometricDrawer_Flush();
 	Gfx_LoadIdentityMatrix(MATRIX_VIEW);
 }
+
+
+/*########################################################################################################################*
+*------------------------------------------------IsometricDrawer component------------------------------------------------*
+*#########################################################################################################################*/
+static void IsometricDrawer_Init(void) {
+	Event_RegisterVoid(&TextureEvents.AtlasChanged,  NULL, IsometricDrawer_ClearCache);
+	Event_RegisterVoid(&BlockEvents.BlockDefChanged, NULL, IsometricDrawer_ClearCache);
+}
+
+static void IsometricDrawer_Reset(void) { IsometricDrawer_ClearCache(NULL); }
+
+static void IsometricDrawer_Free(void) {
+	Event_UnregisterVoid(&TextureEvents.AtlasChanged,  NULL, IsometricDrawer_ClearCache);
+	Event_UnregisterVoid(&BlockEvents.BlockDefChanged, NULL, IsometricDrawer_ClearCache);
+}
+
+struct IGameComponent IsometricDrawer_Component = {
+	IsometricDrawer_Init, /* Init  */
+	IsometricDrawer_Free, /* Free  */
+	IsometricDrawer_Reset /* Reset */
+};
@@ -4,13 +4,21 @@
 /* Draws 2D isometric blocks for the hotbar and inventory UIs.
    Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
 */
+struct IGameComponent;
+extern struct IGameComponent IsometricDrawer_Component;
 
 /* Maximum number of vertices used to draw a block in isometric way. */
 #define ISOMETRICDRAWER_MAXVERTICES 16
 /* Sets up state to begin drawing blocks isometrically. */
-void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, GfxResourceID vb);
-/* Buffers the vertices needed to draw the given block at the given position. */
+/* NOTE: Buffered blocks are flushed before more than maxVertices would be written to vertices. */
+void IsometricDrawer_BeginBatch(VertexP3fT2fC4b* vertices, int maxVertices, GfxResourceID vb);
+/* Buffers the given block to be drawn at the given position. */
+/* NOTE: The block's geometry is cached, and only rebuilt when block definitions or terrain atlas change. */
 void IsometricDrawer_DrawBatch(BlockID block, float size, float x, float y);
-/* Flushes buffered vertices to the GPU, then restores state. */
+/* Flushes buffered blocks to the GPU, so that blocks buffered afterwards are drawn over them. */
+void IsometricDrawer_Flush(void);
+/* Flushes buffered blocks to the GPU, then restores state. */
+/* NOTE: Blocks are drawn grouped by 1D atlas, so draw order is only kept between blocks using the same 1D atlas. */
+/*   (call IsometricDrawer_Flush beforehand if a block must be drawn over all previously buffered blocks) */
 void IsometricDrawer_EndBatch(void);
 #endif
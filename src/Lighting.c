@@ -7,10 +7,40 @@
 #include "Logger.h"
 #include "Event.h"
 #include "GameStructs.h"
+#include "Options.h"
+#include "Constants.h"
 
 int16_t* Lighting_Heightmap;
 #define HEIGHT_UNCALCULATED Int16_MaxValue
 
+bool Lighting_BlockLight;
+/* Block light levels of each chunk, stored as 4 bits per block. NULL if all levels are 0. */
+static uint8_t** light_chunks;
+static int light_chunksX, light_chunksY, light_chunksZ;
+#define LIGHT_CHUNK_BYTES (CHUNK_SIZE_3 / 2)
+#define Light_ChunkIndex(x, y, z) ((((y) >> CHUNK_SHIFT) * light_chunksZ + ((z) >> CHUNK_SHIFT)) * light_chunksX + ((x) >> CHUNK_SHIFT))
+#define Light_CellIndex(x, y, z)  ((((y) & CHUNK_MASK) << 8) | (((z) & CHUNK_MASK) << 4) | ((x) & CHUNK_MASK))
+
+int Lighting_GetBlockLight(int x, int y, int z) {
+	uint8_t* chunk;
+	int cell;
+	if (!light_chunks) return 0;
+
+	chunk = light_chunks[Light_ChunkIndex(x, y, z)];
+	if (!chunk) return 0;
+	cell  = Light_CellIndex(x, y, z);
+	return (chunk[cell >> 1] >> ((cell & 1) << 2)) & 0x0F;
+}
+
+/* Brightens a shadow colour towards the sunlight colour based on block light at the given coordinates. */
+static PackedCol Lighting_Shadow(PackedCol shadow, PackedCol sun, int x, int y, int z) {
+	int level;
+	if (!Lighting_BlockLight) return shadow;
+
+	level = Lighting_GetBlockLight(x, y, z);
+	return level ? PackedCol_Lerp(shadow, sun, level / (float)LIGHT_MAX_LEVEL) : shadow;
+}
+
 #define Lighting_CalcBody(get_block)\
 for (y = maxY; y >= 0; y--, i -= World.OneY) {\
 	block = get_block;\
@@ -53,38 +83,87 @@ bool Lighting_IsLit(int x, int y, int z) {
 }
 
 PackedCol Lighting_Col(int x, int y, int z) {
-	return y > Lighting_GetLightHeight(x, z) ? Env_SunCol : Env_ShadowCol;
+	return y > Lighting_GetLightHeight(x, z) ? Env_SunCol : Lighting_Shadow(Env_ShadowCol, Env_SunCol, x, y, z);
 }
 
 PackedCol Lighting_Col_XSide(int x, int y, int z) {
-	return y > Lighting_GetLightHeight(x, z) ? Env_SunXSide : Env_ShadowXSide;
+	return y > Lighting_GetLightHeight(x, z) ? Env_SunXSide : Lighting_Shadow(Env_ShadowXSide, Env_SunXSide, x, y, z);
 }
 
 PackedCol Lighting_Col_Sprite_Fast(int x, int y, int z) {
-	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunCol : Env_ShadowCol;
+	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunCol : Lighting_Shadow(Env_ShadowCol, Env_SunCol, x, y, z);
 }
 
 PackedCol Lighting_Col_YMax_Fast(int x, int y, int z) {
-	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunCol : Env_ShadowCol;
+	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunCol : Lighting_Shadow(Env_ShadowCol, Env_SunCol, x, y, z);
 }
 
 PackedCol Lighting_Col_YMin_Fast(int x, int y, int z) {
-	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunYMin : Env_ShadowYMin;
+	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunYMin : Lighting_Shadow(Env_ShadowYMin, Env_SunYMin, x, y, z);
 }
 
 PackedCol Lighting_Col_XSide_Fast(int x, int y, int z) {
-	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunXSide : Env_ShadowXSide;
+	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunXSide : Lighting_Shadow(Env_ShadowXSide, Env_SunXSide, x, y, z);
 }
 
 PackedCol Lighting_Col_ZSide_Fast(int x, int y, int z) {
-	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunZSide : Env_ShadowZSide;
+	return y > Lighting_Heightmap[Lighting_Pack(x, z)] ? Env_SunZSide : Lighting_Shadow(Env_ShadowZSide, Env_SunZSide, x, y, z);
+}
+
+#define Lighting_CalcAllBody(get_block)\
+for (y = World.MaxY; y >= 0 && count; y--) {\
+	i = y * World.OneY;\
+\
+	for (j = 0, left = 0; j < count; j++) {\
+		hIndex = columns[j];\
+		block  = get_block;\
+\
+		if (Blocks.BlocksLight[block]) {\
+			offset = (Blocks.LightOffset[block] >> FACE_YMAX) & 1;\
+			Lighting_Heightmap[hIndex] = y - offset;\
+		} else {\
+			columns[left++] = hIndex;\
+		}\
+	}\
+	count = left;\
+}
+
+/* Calculates light height of every column in one pass over the map, going down one Y layer at a time */
+/* NOTE: Reading whole layers is far more cache friendly than walking down each column separately. */
+static void Lighting_CalcHeightmap(void) {
+	int count = World.Width * World.Length;
+	int* columns = Mem_Alloc(count, 4, "lighting columns");
+	int i, j, y, left, hIndex, offset;
+	BlockID block;
+
+	/* Index of a column in heightmap is same as index of the column's block in each Y layer */
+	for (j = 0; j < count; j++) { columns[j] = j; }
+
+#ifndef EXTENDED_BLOCKS
+	Lighting_CalcAllBody(World.Blocks[i + hIndex]);
+#else
+	if (Block_UsedCount <= 256) {
+		Lighting_CalcAllBody(World.Blocks[i + hIndex]);
+	} else {
+		Lighting_CalcAllBody(World.Blocks[i + hIndex] | (World.Blocks2[i + hIndex] << 8));
+	}
+#endif
+
+	for (j = 0; j < count; j++) {
+		Lighting_Heightmap[columns[j]] = -10;
+	}
+	Mem_Free(columns);
 }
 
+static void Lighting_ResetBlockLight(void);
+static bool light_needsReset;
 void Lighting_Refresh(void) {
 	int i;
 	for (i = 0; i < World.Width * World.Length; i++) {
 		Lighting_Heightmap[i] = HEIGHT_UNCALCULATED;
 	}
+	/* Block definitions may change many times in a row, so only reset block light once on next tick */
+	light_needsReset = Lighting_BlockLight;
 }
 
 
@@ -218,6 +297,7 @@ static void Lighting_RefreshAffected(int x, int y, int z, BlockID block, int old
 	}
 }
 
+static void BlockLight_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
 void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = Lighting_Heightmap[hIndex];
@@ -225,6 +305,7 @@ void Lighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newB
 
 	/* Since light wasn't checked to begin with, means column never had meshes for any of its chunks built. */
 	/* So we don't need to do anything. */
+	BlockLight_OnBlockChanged(x, y, z, oldBlock, newBlock);
 	if (lightH == HEIGHT_UNCALCULATED) return;
 
 	Lighting_UpdateLighting(x, y, z, oldBlock, newBlock, hIndex, lightH);
@@ -349,21 +430,244 @@ void Lighting_LightHint(int startX, int startZ) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Block light-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Max number of queued light updates processed per tick, so large changes are spread over several frames */
+#define LIGHT_MAX_UPDATES 16384
+
+struct LightNode { int Index, Level; };
+/* Queue of block light updates that still need to be propagated */
+struct LightQueue {
+	struct LightNode* Nodes;
+	int Head, Count, Capacity;
+};
+static struct LightQueue light_addQ, light_removeQ;
+
+static void LightQueue_Push(struct LightQueue* queue, int index, int level) {
+	if (queue->Count == queue->Capacity) {
+		/* Reuse the space of already processed nodes before growing */
+		if (queue->Head && queue->Head >= queue->Capacity / 2) {
+			queue->Count -= queue->Head;
+			Mem_Copy(queue->Nodes, queue->Nodes + queue->Head, queue->Count * sizeof(struct LightNode));
+			queue->Head = 0;
+		} else {
+			queue->Capacity = queue->Capacity ? queue->Capacity * 2 : 256;
+			queue->Nodes    = Mem_Realloc(queue->Nodes, queue->Capacity, sizeof(struct LightNode), "block light queue");
+		}
+	}
+
+	queue->Nodes[queue->Count].Index = index;
+	queue->Nodes[queue->Count].Level = level;
+	queue->Count++;
+}
+
+static void LightQueue_Free(struct LightQueue* queue) {
+	Mem_Free(queue->Nodes);
+	queue->Nodes = NULL;
+	queue->Head  = 0; queue->Count = 0; queue->Capacity = 0;
+}
+
+static BlockID BlockLight_Block(int index) {
+#ifndef EXTENDED_BLOCKS
+	return World.Blocks[index];
+#else
+	return (BlockID)((World.Blocks[index] | (World.Blocks2[index] << 8)) & Block_IDMask);
+#endif
+}
+#define BlockLight_Emits(block) (Blocks.FullBright[block] ? LIGHT_MAX_LEVEL : 0)
+
+/* Marks the chunk containing the given block (and any chunks sharing a face with it) as needing to be redrawn */
+static void BlockLight_RefreshAt(int x, int y, int z) {
+	int cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int cy = y >> CHUNK_SHIFT, bY = y & CHUNK_MASK;
+	int cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	MapRenderer_RefreshChunk(cx, cy, cz);
+
+	if (bX == 0  && cx > 0) MapRenderer_RefreshChunk(cx - 1, cy, cz);
+	if (bY == 0  && cy > 0) MapRenderer_RefreshChunk(cx, cy - 1, cz);
+	if (bZ == 0  && cz > 0) MapRenderer_RefreshChunk(cx, cy, cz - 1);
+	if (bX == 15 && cx < MapRenderer_ChunksX - 1) MapRenderer_RefreshChunk(cx + 1, cy, cz);
+	if (bY == 15 && cy < MapRenderer_ChunksY - 1) MapRenderer_RefreshChunk(cx, cy + 1, cz);
+	if (bZ == 15 && cz < MapRenderer_ChunksZ - 1) MapRenderer_RefreshChunk(cx, cy, cz + 1);
+}
+
+/* Returns whether the block light level at the given coordinates was changed */
+static bool BlockLight_Store(int x, int y, int z, int level) {
+	int index = Light_ChunkIndex(x, y, z);
+	int cell  = Light_CellIndex(x, y, z);
+	int shift = (cell & 1) << 2;
+	uint8_t* chunk = light_chunks[index];
+
+	if (!chunk) {
+		if (!level) return false;
+		chunk = Mem_AllocCleared(LIGHT_CHUNK_BYTES, 1, "block light chunk");
+		light_chunks[index] = chunk;
+	}
+
+	if (((chunk[cell >> 1] >> shift) & 0x0F) == level) return false;
+	chunk[cell >> 1] = (uint8_t)((chunk[cell >> 1] & ~(0x0F << shift)) | (level << shift));
+	return true;
+}
+
+static void BlockLight_Set(int x, int y, int z, int level) {
+	if (BlockLight_Store(x, y, z, level)) BlockLight_RefreshAt(x, y, z);
+}
+
+/* Spreads light from the given block into its neighbours which are darker */
+static void BlockLight_Spread(int x, int y, int z, int level) {
+	if (Blocks.BlocksLight[BlockLight_Block(World_Pack(x, y, z))]) return;
+	if (Lighting_GetBlockLight(x, y, z) >= level) return;
+
+	BlockLight_Set(x, y, z, level);
+	LightQueue_Push(&light_addQ, World_Pack(x, y, z), level);
+}
+
+/* Clears light that came from the given block in its neighbours */
+static void BlockLight_Unspread(int x, int y, int z, int level) {
+	int index = World_Pack(x, y, z);
+	int other = Lighting_GetBlockLight(x, y, z);
+	if (!other) return;
+
+	if (other >= level) {
+		/* Lit from somewhere else, so light needs to be spread back into the cleared region */
+		LightQueue_Push(&light_addQ, index, other);
+	} else if (BlockLight_Emits(BlockLight_Block(index))) {
+		LightQueue_Push(&light_addQ, index, other);
+	} else {
+		BlockLight_Set(x, y, z, 0);
+		LightQueue_Push(&light_removeQ, index, other);
+	}
+}
+
+#define BlockLight_Neighbours(func, level)\
+if (x > 0)          func(x - 1, y, z, level);\
+if (x < World.MaxX) func(x + 1, y, z, level);\
+if (y > 0)          func(x, y - 1, z, level);\
+if (y < World.MaxY) func(x, y + 1, z, level);\
+if (z > 0)          func(x, y, z - 1, level);\
+if (z < World.MaxZ) func(x, y, z + 1, level);
+
+static void BlockLight_Process(int budget) {
+	struct LightNode node;
+	int x, y, z, level;
+
+	/* All removals must be finished before light is spread again */
+	while (budget > 0 && light_removeQ.Head < light_removeQ.Count) {
+		node = light_removeQ.Nodes[light_removeQ.Head++];
+		World_Unpack(node.Index, x, y, z);
+		BlockLight_Neighbours(BlockLight_Unspread, node.Level);
+		budget--;
+	}
+	if (light_removeQ.Head == light_removeQ.Count) { light_removeQ.Head = 0; light_removeQ.Count = 0; }
+	if (light_removeQ.Count) return;
+
+	while (budget > 0 && light_addQ.Head < light_addQ.Count) {
+		node = light_addQ.Nodes[light_addQ.Head++];
+		World_Unpack(node.Index, x, y, z);
+
+		/* Light might have been changed since this node was queued */
+		level = Lighting_GetBlockLight(x, y, z) - 1;
+		if (level > 0) { BlockLight_Neighbours(BlockLight_Spread, level); }
+		budget--;
+	}
+	if (light_addQ.Head == light_addQ.Count) { light_addQ.Head = 0; light_addQ.Count = 0; }
+}
+
+static void BlockLight_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
+	int index, oldLevel, newLevel;
+	if (!light_chunks) return;
+	index    = World_Pack(x, y, z);
+	oldLevel = Lighting_GetBlockLight(x, y, z);
+	newLevel = BlockLight_Emits(newBlock);
+
+	/* Light needs to be cleared when a light source is removed, or light is now blocked */
+	if (oldLevel > newLevel && (BlockLight_Emits(oldBlock) || Blocks.BlocksLight[newBlock])) {
+		BlockLight_Set(x, y, z, 0);
+		LightQueue_Push(&light_removeQ, index, oldLevel);
+	}
+
+	if (newLevel > oldLevel) {
+		BlockLight_Set(x, y, z, newLevel);
+		LightQueue_Push(&light_addQ, index, newLevel);
+	} else if (!Blocks.BlocksLight[newBlock] && Blocks.BlocksLight[oldBlock]) {
+		/* Light from neighbours can now pass through this block */
+		if (x > 0)          LightQueue_Push(&light_addQ, index - 1,           0);
+		if (x < World.MaxX) LightQueue_Push(&light_addQ, index + 1,           0);
+		if (y > 0)          LightQueue_Push(&light_addQ, index - World.OneY,  0);
+		if (y < World.MaxY) LightQueue_Push(&light_addQ, index + World.OneY,  0);
+		if (z > 0)          LightQueue_Push(&light_addQ, index - World.Width, 0);
+		if (z < World.MaxZ) LightQueue_Push(&light_addQ, index + World.Width, 0);
+	}
+}
+
+static void BlockLight_Tick(struct ScheduledTask* task) {
+	if (light_needsReset) Lighting_ResetBlockLight();
+	if (light_chunks) BlockLight_Process(LIGHT_MAX_UPDATES);
+}
+
+static void BlockLight_Free(void) {
+	int i, count = light_chunksX * light_chunksY * light_chunksZ;
+	if (light_chunks) {
+		for (i = 0; i < count; i++) { Mem_Free(light_chunks[i]); }
+	}
+
+	Mem_Free(light_chunks);
+	light_chunks = NULL;
+	LightQueue_Free(&light_addQ);
+	LightQueue_Free(&light_removeQ);
+}
+
+/* Clears all block light, then queues every light emitting block in the map to spread its light */
+static void Lighting_ResetBlockLight(void) {
+	int x, y, z, level, index = 0;
+	BlockLight_Free();
+	light_needsReset = false;
+	if (!Lighting_BlockLight || !World.Blocks) return;
+
+	light_chunksX = (World.Width  + CHUNK_MAX) >> CHUNK_SHIFT;
+	light_chunksY = (World.Height + CHUNK_MAX) >> CHUNK_SHIFT;
+	light_chunksZ = (World.Length + CHUNK_MAX) >> CHUNK_SHIFT;
+	light_chunks  = Mem_AllocCleared(light_chunksX * light_chunksY * light_chunksZ, sizeof(uint8_t*), "block light chunks");
+
+	for (y = 0; y < World.Height; y++) {
+		for (z = 0; z < World.Length; z++) {
+			for (x = 0; x < World.Width; x++, index++) {
+				level = BlockLight_Emits(BlockLight_Block(index));
+				if (!level) continue;
+
+				/* Map renderer has not been set up for this map yet, so don't refresh chunks */
+				BlockLight_Store(x, y, z, level);
+				LightQueue_Push(&light_addQ, index, level);
+			}
+		}
+	}
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------Lighting component----------------------------------------------------*
 *#########################################################################################################################*/
+static void Lighting_Init(void) {
+	Lighting_BlockLight = Options_GetBool(OPT_BLOCK_LIGHT, false);
+	ScheduledTask_Add(GAME_DEF_TICKS, BlockLight_Tick);
+}
+
 static void Lighting_Reset(void) {
 	Mem_Free(Lighting_Heightmap);
 	Lighting_Heightmap = NULL;
+	BlockLight_Free();
+	light_needsReset = false;
 }
 
 static void Lighting_OnNewMapLoaded(void) {
 	Lighting_Heightmap = Mem_Alloc(World.Width * World.Length, 2, "lighting heightmap");
-	Lighting_Refresh();
+	Lighting_CalcHeightmap();
+	Lighting_ResetBlockLight();
 }
 
 struct IGameComponent Lighting_Component = {
-	NULL,           /* Init  */
+	Lighting_Init,  /* Init  */
 	Lighting_Reset, /* Free  */
 	Lighting_Reset, /* Reset */
 	Lighting_Reset, /* OnNewMap */
@@ -10,6 +10,10 @@ extern struct IGameComponent Lighting_Component;
 
 #define Lighting_Pack(x, z) ((x) + World.Width * (z))
 extern int16_t* Lighting_Heightmap;
+/* Whether light from light emitting blocks (e.g. lava) spreads to nearby blocks. */
+extern bool Lighting_BlockLight;
+/* Max level of block light, as emitted by light emitting blocks. */
+#define LIGHT_MAX_LEVEL 15
 
 /* Equivalent to (but far more optimised form of)
 * for x = startX; x < startX + 18; x++
@@ -25,6 +29,9 @@ void Lighting_Refresh(void);
 /* Returns whether the block at the given coordinates is fully in sunlight. */
 /* NOTE: Does ***NOT*** check that the coordinates are inside the map. */
 bool Lighting_IsLit(int x, int y, int z);
+/* Returns the level of block light (0 to LIGHT_MAX_LEVEL) at the given coordinates. */
+/* NOTE: Does ***NOT*** check that the coordinates are inside the map. */
+int Lighting_GetBlockLight(int x, int y, int z);
 /* Returns the light colour of the block at the given coordinates. */
 /* NOTE: Does ***NOT*** check that the coordinates are inside the map. */
 PackedCol Lighting_Col(int x, int y, int z);
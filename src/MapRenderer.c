@@ -13,6 +13,7 @@
 #include "TexturePack.h"
 #include "Utils.h"
 #include "World.h"
+#include "Profiler.h"
 
 int MapRenderer_ChunksX, MapRenderer_ChunksY, MapRenderer_ChunksZ;
 int MapRenderer_1DUsedCount, MapRenderer_ChunksCount;
@@ -20,7 +21,7 @@ int MapRenderer_MaxUpdates;
 struct ChunkPartInfo* MapRenderer_PartsNormal;
 struct ChunkPartInfo* MapRenderer_PartsTranslucent;
 
-static bool inTranslucent;
+static bool inTranslucent, lastLayered;
 static int elementsPerBitmap;
 static Vector3I chunkPos;
 
@@ -99,27 +100,49 @@ static void MapRenderer_CheckWeather(double delta) {
 	Gfx_SetAlphaBlending(false);
 }
 
-#define MapRenderer_DrawNormalFaces(minFace, maxFace) \
+/* Ranges of vertices in a chunk's vertex buffer, collected so they can be drawn in one call */
+struct DrawRanges { int Count; int Counts[GFX_MAX_DRAW_RANGES], Starts[GFX_MAX_DRAW_RANGES]; };
+
+static void MapRenderer_AddRange(struct DrawRanges* r, int count, int start) {
+	int last = r->Count - 1;
+	Game_Vertices += count;
+
+	/* Extend the previous range when this range directly follows it */
+	if (last >= 0 && r->Starts[last] + r->Counts[last] == start) {
+		r->Counts[last] += count;
+	} else {
+		r->Counts[r->Count] = count;
+		r->Starts[r->Count] = start;
+		r->Count++;
+	}
+}
+
+static void MapRenderer_DrawRanges(struct DrawRanges* r) {
+	if (!r->Count) return;
+	Gfx_DrawIndexedVb_MultiT2fC4b(r->Counts, r->Starts, r->Count);
+	r->Count = 0;
+}
+
+/* When both faces are visible, backface culling must be used to hide the faces pointing away */
+#define MapRenderer_AddNormalFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
-	Gfx_SetFaceCulling(true); \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace] + part.Counts[maxFace], offset); \
-	Gfx_SetFaceCulling(false); \
-	Game_Vertices += (part.Counts[minFace] + part.Counts[maxFace]); \
+	MapRenderer_AddRange(&culled, part.Counts[minFace] + part.Counts[maxFace], offset); \
 } else if (drawMin) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace], offset); \
-	Game_Vertices += part.Counts[minFace]; \
+	MapRenderer_AddRange(&unculled, part.Counts[minFace], offset); \
 } else if (drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[maxFace], offset + part.Counts[minFace]); \
-	Game_Vertices += part.Counts[maxFace]; \
+	MapRenderer_AddRange(&unculled, part.Counts[maxFace], offset + part.Counts[minFace]); \
 }
 
 static void MapRenderer_RenderNormalBatch(int batch) {
 	int batchOffset = MapRenderer_ChunksCount * batch;
+	struct DrawRanges culled, unculled;
 	struct ChunkInfo* info;
 	struct ChunkPartInfo part;
 	bool drawMin, drawMax;
 	int i, offset, count;
 
+	culled.Count = 0; unculled.Count = 0;
+
 	for (i = 0; i < renderChunksCount; i++) {
 		info = renderChunks[i];
 		if (!info->NormalParts) continue;
@@ -137,38 +160,36 @@ static void MapRenderer_RenderNormalBatch(int batch) {
 		offset  = part.Offset + part.SpriteCount;
 		drawMin = info->DrawXMin && part.Counts[FACE_XMIN];
 		drawMax = info->DrawXMax && part.Counts[FACE_XMAX];
-		MapRenderer_DrawNormalFaces(FACE_XMIN, FACE_XMAX);
+		MapRenderer_AddNormalFaces(FACE_XMIN, FACE_XMAX);
 
 		offset  += part.Counts[FACE_XMIN] + part.Counts[FACE_XMAX];
 		drawMin = info->DrawZMin && part.Counts[FACE_ZMIN];
 		drawMax = info->DrawZMax && part.Counts[FACE_ZMAX];
-		MapRenderer_DrawNormalFaces(FACE_ZMIN, FACE_ZMAX);
+		MapRenderer_AddNormalFaces(FACE_ZMIN, FACE_ZMAX);
 
 		offset  += part.Counts[FACE_ZMIN] + part.Counts[FACE_ZMAX];
 		drawMin = info->DrawYMin && part.Counts[FACE_YMIN];
 		drawMax = info->DrawYMax && part.Counts[FACE_YMAX];
-		MapRenderer_DrawNormalFaces(FACE_YMIN, FACE_YMAX);
+		MapRenderer_AddNormalFaces(FACE_YMIN, FACE_YMAX);
+
+		if (part.SpriteCount) {
+			offset = part.Offset;
+			count  = part.SpriteCount >> 2; /* 4 per sprite */
+
+			if (info->DrawXMax || info->DrawZMin) MapRenderer_AddRange(&culled, count, offset);
+			offset += count;
+			if (info->DrawXMin || info->DrawZMax) MapRenderer_AddRange(&culled, count, offset);
+			offset += count;
+			if (info->DrawXMin || info->DrawZMin) MapRenderer_AddRange(&culled, count, offset);
+			offset += count;
+			if (info->DrawXMax || info->DrawZMax) MapRenderer_AddRange(&culled, count, offset);
+		}
 
-		if (!part.SpriteCount) continue;
-		offset = part.Offset;
-		count  = part.SpriteCount >> 2; /* 4 per sprite */
+		MapRenderer_DrawRanges(&unculled);
+		if (!culled.Count) continue;
 
 		Gfx_SetFaceCulling(true);
-		if (info->DrawXMax || info->DrawZMin) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
-		} offset += count;
-
-		if (info->DrawXMin || info->DrawZMax) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
-		} offset += count;
-
-		if (info->DrawXMin || info->DrawZMin) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
-		} offset += count;
-
-		if (info->DrawXMax || info->DrawZMax) {
-			Gfx_DrawIndexedVb_TrisT2fC4b(count, offset); Game_Vertices += count;
-		}
+		MapRenderer_DrawRanges(&culled);
 		Gfx_SetFaceCulling(false);
 	}
 }
@@ -176,6 +197,7 @@ static void MapRenderer_RenderNormalBatch(int batch) {
 void MapRenderer_RenderNormal(double delta) {
 	int batch;
 	if (!mapChunks) return;
+	Profiler_Begin("MapNormal");
 
 	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
 	Gfx_SetTexturing(true);
@@ -195,30 +217,31 @@ void MapRenderer_RenderNormal(double delta) {
 	MapRenderer_CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
 	Gfx_SetTexturing(false);
+	Profiler_End();
 #if DEBUG_OCCLUSION
 	DebugPickedPos();
 #endif
 }
 
-#define MapRenderer_DrawTranslucentFaces(minFace, maxFace) \
+#define MapRenderer_AddTranslucentFaces(minFace, maxFace) \
 if (drawMin && drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace] + part.Counts[maxFace], offset); \
-	Game_Vertices += (part.Counts[minFace] + part.Counts[maxFace]); \
+	MapRenderer_AddRange(&ranges, part.Counts[minFace] + part.Counts[maxFace], offset); \
 } else if (drawMin) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[minFace], offset); \
-	Game_Vertices += part.Counts[minFace]; \
+	MapRenderer_AddRange(&ranges, part.Counts[minFace], offset); \
 } else if (drawMax) { \
-	Gfx_DrawIndexedVb_TrisT2fC4b(part.Counts[maxFace], offset + part.Counts[minFace]); \
-	Game_Vertices += part.Counts[maxFace]; \
+	MapRenderer_AddRange(&ranges, part.Counts[maxFace], offset + part.Counts[minFace]); \
 }
 
 static void MapRenderer_RenderTranslucentBatch(int batch) {
 	int batchOffset = MapRenderer_ChunksCount * batch;
+	struct DrawRanges ranges;
 	struct ChunkInfo* info;
 	struct ChunkPartInfo part;
 	bool drawMin, drawMax;
 	int i, offset;
 
+	ranges.Count = 0;
+
 	for (i = 0; i < renderChunksCount; i++) {
 		info = renderChunks[i];
 		if (!info->TranslucentParts) continue;
@@ -236,23 +259,25 @@ static void MapRenderer_RenderTranslucentBatch(int batch) {
 		offset  = part.Offset;
 		drawMin = (inTranslucent || info->DrawXMin) && part.Counts[FACE_XMIN];
 		drawMax = (inTranslucent || info->DrawXMax) && part.Counts[FACE_XMAX];
-		MapRenderer_DrawTranslucentFaces(FACE_XMIN, FACE_XMAX);
+		MapRenderer_AddTranslucentFaces(FACE_XMIN, FACE_XMAX);
 
 		offset  += part.Counts[FACE_XMIN] + part.Counts[FACE_XMAX];
 		drawMin = (inTranslucent || info->DrawZMin) && part.Counts[FACE_ZMIN];
 		drawMax = (inTranslucent || info->DrawZMax) && part.Counts[FACE_ZMAX];
-		MapRenderer_DrawTranslucentFaces(FACE_ZMIN, FACE_ZMAX);
+		MapRenderer_AddTranslucentFaces(FACE_ZMIN, FACE_ZMAX);
 
 		offset  += part.Counts[FACE_ZMIN] + part.Counts[FACE_ZMAX];
 		drawMin = (inTranslucent || info->DrawYMin) && part.Counts[FACE_YMIN];
 		drawMax = (inTranslucent || info->DrawYMax) && part.Counts[FACE_YMAX];
-		MapRenderer_DrawTranslucentFaces(FACE_YMIN, FACE_YMAX);
+		MapRenderer_AddTranslucentFaces(FACE_YMIN, FACE_YMAX);
+		MapRenderer_DrawRanges(&ranges);
 	}
 }
 
 void MapRenderer_RenderTranslucent(double delta) {
 	int vertices, batch;
 	if (!mapChunks) return;
+	Profiler_Begin("MapTranslucent");
 
 	/* First fill depth buffer */
 	vertices = Game_Vertices;
@@ -294,6 +319,7 @@ void MapRenderer_RenderTranslucent(double delta) {
 	}
 	Gfx_SetAlphaBlending(false);
 	Gfx_SetTexturing(false);
+	Profiler_End();
 }
 
 
@@ -600,8 +626,10 @@ static void MapRenderer_UpdateSortOrder(void) {
 
 void MapRenderer_Update(double deltaTime) {
 	if (!mapChunks) return;
+	Profiler_Begin("MapUpdate");
 	MapRenderer_UpdateSortOrder();
 	MapRenderer_UpdateChunks(deltaTime);
+	Profiler_End();
 }
 
 
@@ -664,7 +692,10 @@ void MapRenderer_BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 	Game.ChunkUpdates++;
 	(*chunkUpdates)++;
 	info->PendingDelete = false;
+
+	Profiler_Begin("BuildChunk");
 	Builder_MakeChunk(info);
+	Profiler_End();
 
 	if (!info->NormalParts && !info->TranslucentParts) {
 		info->Empty = true; return;
@@ -700,12 +731,14 @@ static void MapRenderer_EnvVariableChanged(void* obj, int envVar) {
 
 static void MapRenderer_TerrainAtlasChanged(void* obj) {
 	if (MapRenderer_1DUsedCount) {
-		bool refreshRequired = elementsPerBitmap != Atlas1D_TilesPerAtlas;
+		/* Texture V coords in chunk meshes change when switching to/from a layered atlas too */
+		bool refreshRequired = elementsPerBitmap != Atlas1D_TilesPerAtlas || lastLayered != Atlas1D_Layered;
 		if (refreshRequired) MapRenderer_Refresh();
 	}
 
 	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
 	elementsPerBitmap = Atlas1D_TilesPerAtlas;
+	lastLayered       = Atlas1D_Layered;
 	MapRenderer_ResetPartFlags();
 }
 
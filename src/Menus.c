@@ -28,6 +28,7 @@
 #include "Stream.h"
 #include "Builder.h"
 #include "Logger.h"
+#include "Profiler.h"
 
 #define MenuBase_Layout Screen_Layout struct Widget** Widgets; int WidgetsCount;
 struct Menu { MenuBase_Layout };
@@ -129,6 +130,19 @@ struct TexIdsOverlay {
 	struct TextWidget Title;
 };
 
+#define PROFILER_OVERLAY_LINES 16
+struct ProfilerOverlayStat { const char* Name; int Depth, Calls; float Total, Max; };
+struct ProfilerOverlay {
+	MenuScreen_Layout
+	struct TextWidget Title;
+	struct TextWidget Lines[PROFILER_OVERLAY_LINES];
+	struct ProfilerOverlayStat Stats[PROFILER_OVERLAY_LINES];
+	int StatsCount;
+	GfxResourceID DynamicVb;
+	int FlameX, FlameY, FlameWidth;
+	double Accumulator;
+};
+
 struct UrlWarningOverlay {
 	MenuScreen_Layout
 	struct ButtonWidget Buttons[2];
@@ -1821,14 +1835,14 @@ struct Screen* HacksKeyBindingsScreen_MakeInstance(void) {
 *#########################################################################################################################*/
 static void OtherKeyBindingsScreen_ContextRecreated(void* screen) {
 	struct KeyBindingsScreen* s = screen;
-	KeyBindingsScreen_MakeWidgets(s, -140, 10, 6, "Other controls", 260);
+	KeyBindingsScreen_MakeWidgets(s, -145, 10, 7, "Other controls", 260);
 }
 
 struct Screen* OtherKeyBindingsScreen_MakeInstance(void) {
-	static uint8_t binds[12] = { KEYBIND_EXT_INPUT, KEYBIND_HIDE_FPS, KEYBIND_HIDE_GUI, KEYBIND_HOTBAR_SWITCH, KEYBIND_DROP_BLOCK,KEYBIND_SCREENSHOT, KEYBIND_FULLSCREEN, KEYBIND_AXIS_LINES, KEYBIND_AUTOROTATE, KEYBIND_SMOOTH_CAMERA, KEYBIND_IDOVERLAY, KEYBIND_BREAK_LIQUIDS };
-	static const char* descs[12] = { "Show ext input", "Hide FPS", "Hide gui", "Hotbar switching", "Drop block", "Screenshot", "Fullscreen", "Show axis lines", "Auto-rotate", "Smooth camera", "ID overlay", "Breakable liquids" };
-	static struct ButtonWidget buttons[12];
-	static struct Widget* widgets[12 + 4];
+	static uint8_t binds[13] = { KEYBIND_EXT_INPUT, KEYBIND_HIDE_FPS, KEYBIND_HIDE_GUI, KEYBIND_HOTBAR_SWITCH, KEYBIND_DROP_BLOCK, KEYBIND_SCREENSHOT, KEYBIND_PROFILER, KEYBIND_FULLSCREEN, KEYBIND_AXIS_LINES, KEYBIND_AUTOROTATE, KEYBIND_SMOOTH_CAMERA, KEYBIND_IDOVERLAY, KEYBIND_BREAK_LIQUIDS };
+	static const char* descs[13] = { "Show ext input", "Hide FPS", "Hide gui", "Hotbar switching", "Drop block", "Screenshot", "Profiler", "Fullscreen", "Show axis lines", "Auto-rotate", "Smooth camera", "ID overlay", "Breakable liquids" };
+	static struct ButtonWidget buttons[13];
+	static struct Widget* widgets[13 + 4];
 
 	struct KeyBindingsScreen* s = KeyBindingsScreen_Make(Array_Elems(binds), binds, descs, buttons, widgets, OtherKeyBindingsScreen_ContextRecreated);
 	s->LeftPage  = Menu_SwitchKeysHacks;
@@ -3092,6 +3106,265 @@ struct Screen* TexIdsOverlay_MakeInstance(void) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------ProfilerOverlay-----------------------------------------------------*
+*#########################################################################################################################*/
+#define PROFILER_OVERLAY_ROW 10
+#define PROFILER_OVERLAY_VERTICES ((PROFILER_MAX_ZONES + 2) * 4)
+/* Colour codes of zones, so that the flame bars use the same colour as their line of text */
+const static char profilerOverlay_cols[8] = { '7', 'c', 'a', 'e', '9', 'd', 'b', '6' };
+static struct ProfilerOverlay ProfilerOverlay_Instance;
+
+static int ProfilerOverlay_FindStat(struct ProfilerOverlay* s, const char* name) {
+	int i;
+	for (i = 0; i < s->StatsCount; i++) {
+		if (s->Stats[i].Name == name) return i;
+	}
+	return -1;
+}
+
+static void ProfilerOverlay_CalcStats(struct ProfilerOverlay* s) {
+	float frameTimes[PROFILER_OVERLAY_LINES];
+	struct ProfilerOverlayStat* stat;
+	struct ProfilerZone* zones;
+	int frame, i, j, count;
+	float ms;
+
+	s->StatsCount = 0;
+	for (frame = 0; frame < Profiler_FramesCount; frame++) {
+		count = Profiler_GetFrame(frame, &zones);
+		for (i = 0; i < PROFILER_OVERLAY_LINES; i++) { frameTimes[i] = 0.0f; }
+
+		for (i = 0; i < count; i++) {
+			j = ProfilerOverlay_FindStat(s, zones[i].Name);
+			if (j == -1) {
+				if (s->StatsCount == PROFILER_OVERLAY_LINES) continue;
+				j    = s->StatsCount++;
+				stat = &s->Stats[j];
+
+				stat->Name  = zones[i].Name;  stat->Depth = zones[i].Depth;
+				stat->Total = 0.0f; stat->Max = 0.0f; stat->Calls = 0;
+			}
+
+			frameTimes[j] += Stopwatch_ElapsedMicroseconds(zones[i].Beg, zones[i].End) / 1000.0f;
+			s->Stats[j].Calls++;
+		}
+
+		for (i = 0; i < s->StatsCount; i++) {
+			ms = frameTimes[i];
+			s->Stats[i].Total += ms;
+			s->Stats[i].Max    = max(s->Stats[i].Max, ms);
+		}
+	}
+}
+
+static void ProfilerOverlay_UpdateLines(struct ProfilerOverlay* s) {
+	String line; char lineBuffer[STRING_SIZE];
+	struct ProfilerOverlayStat* stat;
+	float avg, calls;
+	int i, j;
+
+	ProfilerOverlay_CalcStats(s);
+	String_InitArray(line, lineBuffer);
+
+	for (i = 0; i < PROFILER_OVERLAY_LINES; i++) {
+		line.length = 0;
+		stat = &s->Stats[i];
+
+		if (i < s->StatsCount) {
+			for (j = 0; j < stat->Depth; j++) { String_AppendConst(&line, "  "); }
+			avg   = stat->Total / Profiler_FramesCount;
+			calls = (float)stat->Calls / Profiler_FramesCount;
+
+			String_Format4(&line, "&%r%c&f: %f2 ms avg, %f2 ms max",
+				&profilerOverlay_cols[i % Array_Elems(profilerOverlay_cols)], stat->Name, &avg, &stat->Max);
+			if (calls > 1.0f) String_Format1(&line, " (%f1 calls)", &calls);
+		}
+		TextWidget_Set(&s->Lines[i], &line, &s->TextFont);
+	}
+}
+
+static void ProfilerOverlay_MakeBar(int x, int y, int width, int height, PackedCol col, VertexP3fC4b** ptr) {
+	VertexP3fC4b* v = *ptr;
+	v->X = (float)x;           v->Y = (float)y;            v->Z = 0.0f; v->Col = col; v++;
+	v->X = (float)(x + width); v->Y = (float)y;            v->Z = 0.0f; v->Col = col; v++;
+	v->X = (float)(x + width); v->Y = (float)(y + height); v->Z = 0.0f; v->Col = col; v++;
+	v->X = (float)x;           v->Y = (float)(y + height); v->Z = 0.0f; v->Col = col; v++;
+	*ptr = v;
+}
+
+static PackedCol ProfilerOverlay_ZoneCol(struct ProfilerOverlay* s, const char* name) {
+	PackedCol white = PACKEDCOL_WHITE;
+	PackedCol col;
+	BitmapCol bmpCol;
+	int i = ProfilerOverlay_FindStat(s, name);
+	if (i == -1) return white;
+
+	bmpCol = Drawer2D_GetCol(profilerOverlay_cols[i % Array_Elems(profilerOverlay_cols)]);
+	col.R = bmpCol.R; col.G = bmpCol.G; col.B = bmpCol.B; col.A = 255;
+	return col;
+}
+
+/* Draws zones of the most recent frame as a flame graph, where each row is one level deeper */
+static void ProfilerOverlay_RenderFlame(struct ProfilerOverlay* s) {
+	VertexP3fC4b vertices[PROFILER_OVERLAY_VERTICES];
+	VertexP3fC4b* ptr = vertices;
+	PackedCol backCol   = PACKEDCOL_CONST(0, 0, 0, 160);
+	PackedCol budgetCol = PACKEDCOL_CONST(255, 255, 255, 255);
+	struct ProfilerZone* zones;
+	int i, count, depth, x, y, width;
+	float frameMs, scale;
+
+	count = Profiler_GetFrame(0, &zones);
+	if (!count) return;
+
+	depth = 0;
+	for (i = 0; i < count; i++) { depth = max(depth, zones[i].Depth); }
+
+	/* Scale is fixed to 2 frames at 60 FPS, unless the frame took longer than that */
+	frameMs = Stopwatch_ElapsedMicroseconds(zones[0].Beg, zones[0].End) / 1000.0f;
+	scale   = s->FlameWidth / max(frameMs, 1000.0f / 30.0f);
+
+	ProfilerOverlay_MakeBar(s->FlameX - 2, s->FlameY - 2, s->FlameWidth + 4,
+		(depth + 1) * PROFILER_OVERLAY_ROW + 4, backCol, &ptr);
+
+	for (i = 0; i < count; i++) {
+		x     = (int)(Stopwatch_ElapsedMicroseconds(zones[0].Beg, zones[i].Beg) / 1000.0f * scale);
+		width = (int)(Stopwatch_ElapsedMicroseconds(zones[i].Beg, zones[i].End) / 1000.0f * scale);
+		y     = s->FlameY + zones[i].Depth * PROFILER_OVERLAY_ROW;
+
+		ProfilerOverlay_MakeBar(s->FlameX + x, y, max(width, 1), PROFILER_OVERLAY_ROW - 1,
+			ProfilerOverlay_ZoneCol(s, zones[i].Name), &ptr);
+	}
+
+	/* Mark where a frame at 60 FPS would end */
+	x = (int)(1000.0f / 60.0f * scale);
+	ProfilerOverlay_MakeBar(s->FlameX + x, s->FlameY - 2, 1, 
+		(depth + 1) * PROFILER_OVERLAY_ROW + 4, budgetCol, &ptr);
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FC4B);
+	count = (int)(ptr - vertices);
+	Gfx_UpdateDynamicVb_IndexedTris(s->DynamicVb, vertices, count);
+}
+
+static void ProfilerOverlay_ContextLost(void* screen) {
+	struct ProfilerOverlay* s = screen;
+	Menu_ContextLost(s);
+	Gfx_DeleteVb(&s->DynamicVb);
+}
+
+static void ProfilerOverlay_ContextRecreated(void* screen) {
+	const static String title = String_FromConst("Frame profiler (/client trace saves these frames)");
+	struct ProfilerOverlay* s = screen;
+	int i, y = 80;
+
+	s->DynamicVb = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FC4B, PROFILER_OVERLAY_VERTICES);
+	Menu_Label(s, 0, &s->Title, &title, &s->TitleFont,
+		ANCHOR_MIN, ANCHOR_MIN, 10, y);
+	y += s->Title.Height;
+
+	for (i = 0; i < PROFILER_OVERLAY_LINES; i++) {
+		TextWidget_Make(&s->Lines[i]);
+		s->Lines[i].ReducePadding = true;
+		s->Widgets[i + 1] = (struct Widget*)&s->Lines[i];
+		Widget_SetLocation(&s->Lines[i], ANCHOR_MIN, ANCHOR_MIN, 10, y);
+
+		y += Drawer2D_FontHeight(&s->TextFont, true);
+	}
+	ProfilerOverlay_UpdateLines(s);
+	
+	s->FlameX     = 10;
+	s->FlameY     = y + 6;
+	s->FlameWidth = max(Game.Width / 3, 300);
+}
+
+static void ProfilerOverlay_Init(void* screen) {
+	struct ProfilerOverlay* s = screen;
+	Profiler_Enabled = true;
+	s->Accumulator   = 0.0;
+
+	Drawer2D_MakeFont(&s->TextFont, 12, FONT_STYLE_NORMAL);
+	MenuScreen_Init(s);
+}
+
+static void ProfilerOverlay_Render(void* screen, double delta) {
+	struct ProfilerOverlay* s = screen;
+	
+	s->Accumulator += delta;
+	if (s->Accumulator >= 0.5) {
+		ProfilerOverlay_UpdateLines(s);
+		s->Accumulator = 0.0;
+	}
+	ProfilerOverlay_RenderFlame(s);
+
+	Gfx_SetTexturing(true);
+	Menu_Render(s, delta);
+	Gfx_SetTexturing(false);
+}
+
+static void ProfilerOverlay_Free(void* screen) {
+	Profiler_Enabled = false;
+	MenuScreen_Free(screen);
+}
+
+static bool ProfilerOverlay_KeyDown(void* screen, Key key, bool was) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+
+	if (key == KeyBinds[KEYBIND_PROFILER]) {
+		Gui_FreeOverlay(screen); return true;
+	}
+	return Elem_HandlesKeyDown(active, key, was);
+}
+
+static bool ProfilerOverlay_KeyPress(void* screen, char keyChar) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesKeyPress(active, keyChar);
+}
+
+static bool ProfilerOverlay_KeyUp(void* screen, Key key) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesKeyUp(active, key);
+}
+
+static bool ProfilerOverlay_MouseDown(void* screen, int x, int y, MouseButton btn) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesMouseDown(active, x, y, btn);
+}
+
+static bool ProfilerOverlay_MouseUp(void* screen, int x, int y, MouseButton btn) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesMouseUp(active, x, y, btn);
+}
+
+static bool ProfilerOverlay_MouseMove(void* screen, int x, int y) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesMouseMove(active, x, y);
+}
+
+static bool ProfilerOverlay_MouseScroll(void* screen, float delta) {
+	struct Screen* active = Gui_GetUnderlyingScreen();
+	return Elem_HandlesMouseScroll(active, delta);
+}
+
+static struct ScreenVTABLE ProfilerOverlay_VTABLE = {
+	ProfilerOverlay_Init,      ProfilerOverlay_Render,  ProfilerOverlay_Free,      Gui_DefaultRecreate,
+	ProfilerOverlay_KeyDown,   ProfilerOverlay_KeyUp,   ProfilerOverlay_KeyPress,
+	ProfilerOverlay_MouseDown, ProfilerOverlay_MouseUp, ProfilerOverlay_MouseMove, ProfilerOverlay_MouseScroll,
+	Menu_OnResize,             ProfilerOverlay_ContextLost, ProfilerOverlay_ContextRecreated,
+};
+struct Screen* ProfilerOverlay_MakeInstance(void) {
+	static struct Widget* widgets[PROFILER_OVERLAY_LINES + 1];
+	struct ProfilerOverlay* s = &ProfilerOverlay_Instance;
+	
+	s->HandlesAllInput = false;
+	s->Widgets         = widgets;
+	s->WidgetsCount    = Array_Elems(widgets);
+
+	s->VTABLE = &ProfilerOverlay_VTABLE;
+	return (struct Screen*)s;
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------UrlWarningOverlay----------------------------------------------------*
 *#########################################################################################################################*/
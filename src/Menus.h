@@ -35,5 +35,6 @@ struct Screen* NostalgiaScreen_MakeInstance(void);
 
 struct Screen* UrlWarningOverlay_MakeInstance(const String* url);
 struct Screen* TexIdsOverlay_MakeInstance(void);
+struct Screen* ProfilerOverlay_MakeInstance(void);
 struct Screen* TexPackOverlay_MakeInstance(const String* url);
 #endif
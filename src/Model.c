@@ -12,6 +12,7 @@
 #include "Block.h"
 #include "Stream.h"
 #include "Funcs.h"
+#include "Platform.h"
 
 struct _ModelsData Models;
 
@@ -38,6 +39,7 @@ void Model_Init(struct Model* model) {
 	model->CalcHumanAnims = false;
 	model->UsesHumanSkin  = false;
 	model->Pushes = true;
+	model->Batchable = false;
 
 	model->Gravity        = 0.08f;
 	model->Drag           = Vector3_Create3(0.91f, 0.98f, 0.91f);
@@ -92,6 +94,11 @@ float Model_RenderDistance(struct Entity* entity) {
 	return dx * dx + dy * dy + dz * dz;
 }
 
+/* Transform of the entity whose vertices are being added to batches. NULL when not batching. */
+static struct Matrix* batch_transform;
+static bool batch_active;
+static void ModelBatch_Add(void);
+
 void Model_Render(struct Model* model, struct Entity* entity) {
 	struct Matrix m;
 	Vector3 pos = entity->Position;
@@ -99,8 +106,16 @@ void Model_Render(struct Model* model, struct Entity* entity) {
 
 	Model_SetupState(model, entity);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
-
 	model->GetTransform(entity, pos, &entity->Transform);
+
+	if (batch_active && model->Batchable) {
+		batch_transform = &entity->Transform;
+		Model_SetAlphaTest(true);
+		model->Draw(entity);
+		batch_transform = NULL;
+		return;
+	}
+
 	Matrix_Mul(&m, &entity->Transform, &Gfx.View);
 
 	Gfx_LoadMatrix(MATRIX_VIEW, &m);
@@ -120,8 +135,10 @@ void Model_SetupState(struct Model* model, struct Entity* entity) {
 	/* only apply when using humanoid skins */
 	_64x64 &= model->UsesHumanSkin || entity->MobTextureId;
 
-	Models.uScale = entity->uScale * 0.015625f;
-	Models.vScale = entity->vScale * (_64x64 ? 0.015625f : 0.03125f);
+	Models.uScale  = entity->uScale * 0.015625f;
+	Models.vScale  = entity->vScale * (_64x64 ? 0.015625f : 0.03125f);
+	Models.uOffset = entity->uOffset;
+	Models.vOffset = entity->vOffset;
 
 	Models.Cols[0] = col;
 	if (!entity->NoShade) {
@@ -143,7 +160,11 @@ void Model_SetupState(struct Model* model, struct Entity* entity) {
 
 void Model_UpdateVB(void) {
 	struct Model* model = Models.Active;
-	Gfx_UpdateDynamicVb_IndexedTris(Models.Vb, Models.Vertices, model->index);
+	if (batch_transform) {
+		ModelBatch_Add();
+	} else {
+		Gfx_UpdateDynamicVb_IndexedTris(Models.Vb, Models.Vertices, model->index);
+	}
 	model->index = 0;
 }
 
@@ -156,17 +177,27 @@ void Model_ApplyTexture(struct Entity* entity) {
 	tex = model->UsesHumanSkin ? entity->TextureId : entity->MobTextureId;
 	if (tex) {
 		Models.skinType = entity->SkinType;
+		_64x64 = Models.skinType != SKIN_64x32;
+
+		Models.uScale  = entity->uScale * 0.015625f;
+		Models.vScale  = entity->vScale * (_64x64 ? 0.015625f : 0.03125f);
+		Models.uOffset = entity->uOffset;
+		Models.vOffset = entity->vOffset;
 	} else {
 		data = model->defaultTex;
 		tex  = data->TexID;
 		Models.skinType = data->SkinType;
+		Model_SetDefaultTexScale();
 	}
+	Model_BindTexture(tex);
+}
 
-	Gfx_BindTexture(tex);
-	_64x64 = Models.skinType != SKIN_64x32;
-
-	Models.uScale = entity->uScale * 0.015625f;
-	Models.vScale = entity->vScale * (_64x64 ? 0.015625f : 0.03125f);
+void Model_SetDefaultTexScale(void) {
+	bool _64x64 = Models.skinType != SKIN_64x32;
+	Models.uScale  = 0.015625f;
+	Models.vScale  = _64x64 ? 0.015625f : 0.03125f;
+	Models.uOffset = 0.0f;
+	Models.vOffset = 0.0f;
 }
 
 void Model_DrawPart(struct ModelPart* part) {
@@ -182,8 +213,8 @@ void Model_DrawPart(struct ModelPart* part) {
 		dst->X = v.X; dst->Y = v.Y; dst->Z = v.Z;
 		dst->Col = Models.Cols[i >> 2];
 
-		dst->U = (v.U & UV_POS_MASK) * Models.uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.V & UV_POS_MASK) * Models.vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
+		dst->U = (v.U & UV_POS_MASK) * Models.uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * Models.uScale + Models.uOffset;
+		dst->V = (v.V & UV_POS_MASK) * Models.vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * Models.vScale + Models.vOffset;
 		src++; dst++;
 	}
 	model->index += count;
@@ -203,12 +234,14 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 	float cosZ = (float)Math_Cos(-angleZ), sinZ = (float)Math_Sin(-angleZ);
 	float t, x = part->RotX, y = part->RotY, z = part->RotZ;
 	
-	struct ModelVertex v;
+	Vector3 axes[3], v;
+	float vX, vY, vZ;
 	int i, count = part->Count;
 
-	for (i = 0; i < count; i++) {
-		v = *src;
-		v.X -= x; v.Y -= y; v.Z -= z;
+	/* Rotating is linear, so rather than rotating every vertex, the unit axes are rotated */
+	/* once and each vertex is then transformed by them (avoids branching per vertex) */
+	for (i = 0; i < 3; i++) {
+		v.X = (float)(i == 0); v.Y = (float)(i == 1); v.Z = (float)(i == 2);
 
 		/* Rotate locally */
 		if (Models.Rotation == ROTATE_ORDER_ZYX) {
@@ -229,11 +262,19 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 		if (head) {
 			t = Models.cosHead * v.X - Models.sinHead * v.Z; v.Z = Models.sinHead * v.X + Models.cosHead * v.Z; v.X = t;
 		}
-		dst->X = v.X + x; dst->Y = v.Y + y; dst->Z = v.Z + z;
+		axes[i] = v;
+	}
+
+	for (i = 0; i < count; i++) {
+		vX = src->X - x; vY = src->Y - y; vZ = src->Z - z;
+
+		dst->X = vX * axes[0].X + vY * axes[1].X + vZ * axes[2].X + x;
+		dst->Y = vX * axes[0].Y + vY * axes[1].Y + vZ * axes[2].Y + y;
+		dst->Z = vX * axes[0].Z + vY * axes[1].Z + vZ * axes[2].Z + z;
 		dst->Col = Models.Cols[i >> 2];
 
-		dst->U = (v.U & UV_POS_MASK) * Models.uScale - (v.U >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.V & UV_POS_MASK) * Models.vScale - (v.V >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
+		dst->U = (src->U & UV_POS_MASK) * Models.uScale - (src->U >> UV_MAX_SHIFT) * 0.01f * Models.uScale + Models.uOffset;
+		dst->V = (src->V & UV_POS_MASK) * Models.vScale - (src->V >> UV_MAX_SHIFT) * 0.01f * Models.vScale + Models.vOffset;
 		src++; dst++;
 	}
 	model->index += count;
@@ -282,6 +323,132 @@ void Model_DrawArmPart(struct ModelPart* part) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Model batching----------------------------------------------------*
+*#########################################################################################################################*/
+/* When batching, vertices of all entities which are drawn with the same texture and alpha test state */
+/* are transformed into world space on the CPU and grouped together, so each group can then be */
+/* drawn with only one texture bind and draw call (instead of one matrix load and draw per entity) */
+#define MODEL_MAX_BATCHES 64
+struct ModelBatch {
+	GfxResourceID TexId;
+	bool AlphaTest;
+	int Count, Capacity;
+	VertexP3fT2fC4b* Vertices;
+};
+
+static struct ModelBatch batches[MODEL_MAX_BATCHES];
+static int batches_count;
+static GfxResourceID batch_vb, batch_texId;
+static bool batch_alphaTest;
+
+void Model_BindTexture(GfxResourceID texId) {
+	batch_texId = texId;
+	if (!batch_transform) Gfx_BindTexture(texId);
+}
+
+void Model_SetAlphaTest(bool enabled) {
+	batch_alphaTest = enabled;
+	if (!batch_transform) Gfx_SetAlphaTest(enabled);
+}
+
+static void ModelBatch_Draw(struct ModelBatch* batch) {
+	VertexP3fT2fC4b* data;
+	int i, count;
+
+	Gfx_BindTexture(batch->TexId);
+	Gfx_SetAlphaTest(batch->AlphaTest);
+
+	for (i = 0; i < batch->Count; i += count) {
+		count = min(batch->Count - i, GFX_MAX_VERTICES);
+		data  = (VertexP3fT2fC4b*)Gfx_LockDynamicVb(batch_vb, VERTEX_FORMAT_P3FT2FC4B, count);
+		Mem_Copy(data, batch->Vertices + i, count * sizeof(VertexP3fT2fC4b));
+
+		Gfx_UnlockDynamicVb(batch_vb);
+		Gfx_DrawVb_IndexedTris(count);
+	}
+	batch->Count = 0;
+}
+
+static void ModelBatch_DrawAll(void) {
+	int i;
+	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+
+	for (i = 0; i < batches_count; i++) {
+		ModelBatch_Draw(&batches[i]);
+	}
+	batches_count = 0;
+	Gfx_SetAlphaTest(true);
+}
+
+static struct ModelBatch* ModelBatch_Get(GfxResourceID texId, bool alphaTest) {
+	struct ModelBatch* batch;
+	int i;
+
+	for (i = 0; i < batches_count; i++) {
+		batch = &batches[i];
+		if (batch->TexId == texId && batch->AlphaTest == alphaTest) return batch;
+	}
+
+	/* Too many different textures, so just draw what has been batched so far */
+	if (batches_count == MODEL_MAX_BATCHES) ModelBatch_DrawAll();
+	batch = &batches[batches_count++];
+
+	batch->TexId     = texId;
+	batch->AlphaTest = alphaTest;
+	batch->Count     = 0;
+	return batch;
+}
+
+static void ModelBatch_Add(void) {
+	struct ModelBatch* batch = ModelBatch_Get(batch_texId, batch_alphaTest);
+	struct Matrix* m = batch_transform;
+	VertexP3fT2fC4b* src = Models.Vertices;
+	VertexP3fT2fC4b* dst;
+	float x, y, z;
+	int i, count = Models.Active->index;
+
+	if (batch->Count + count > batch->Capacity) {
+		batch->Capacity = max(batch->Capacity * 2, batch->Count + count);
+		batch->Vertices = (VertexP3fT2fC4b*)Mem_Realloc(batch->Vertices, batch->Capacity, 
+			sizeof(VertexP3fT2fC4b), "model batch vertices");
+	}
+	dst = batch->Vertices + batch->Count;
+
+	for (i = 0; i < count; i++) {
+		x = src[i].X; y = src[i].Y; z = src[i].Z;
+
+		dst[i].X = x * m->Row0.X + y * m->Row1.X + z * m->Row2.X + m->Row3.X;
+		dst[i].Y = x * m->Row0.Y + y * m->Row1.Y + z * m->Row2.Y + m->Row3.Y;
+		dst[i].Z = x * m->Row0.Z + y * m->Row1.Z + z * m->Row2.Z + m->Row3.Z;
+		dst[i].Col = src[i].Col;
+		dst[i].U   = src[i].U; dst[i].V = src[i].V;
+	}
+	batch->Count += count;
+}
+
+void Model_BeginBatch(void) {
+	if (Gfx.LostContext) return;
+	batch_active = true;
+}
+
+void Model_EndBatch(void) {
+	if (!batch_active) return;
+	batch_active = false;
+	ModelBatch_DrawAll();
+}
+
+static void ModelBatch_Free(void) {
+	int i;
+	for (i = 0; i < MODEL_MAX_BATCHES; i++) {
+		Mem_Free(batches[i].Vertices);
+		batches[i].Vertices = NULL;
+		batches[i].Capacity = 0;
+	}
+}
+
+
 /*########################################################################################################################*
 *----------------------------------------------------------BoxDesc--------------------------------------------------------*
 *#########################################################################################################################*/
@@ -373,10 +540,12 @@ static struct ModelTex* textures_tail;
 
 static void Models_ContextLost(void* obj) {
 	Gfx_DeleteVb(&Models.Vb);
+	Gfx_DeleteVb(&batch_vb);
 }
 
 static void Models_ContextRecreated(void* obj) {
 	Models.Vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FT2FC4B, Models.MaxVertices);
+	batch_vb  = Gfx_CreateDynamicVb(VERTEX_FORMAT_P3FT2FC4B, GFX_MAX_VERTICES);
 }
 
 static void Model_Make(struct Model* model) {
@@ -446,7 +615,7 @@ static void HumanModel_DrawModelSet(struct Entity* entity, struct ModelSet* mode
 	int type;
 
 	Model_ApplyTexture(entity);
-	Gfx_SetAlphaTest(false);
+	Model_SetAlphaTest(false);
 
 	type = Models.skinType;
 	set  = &model->Limbs[type & 0x3];
@@ -462,7 +631,7 @@ static void HumanModel_DrawModelSet(struct Entity* entity, struct ModelSet* mode
 	Models.Rotation = ROTATE_ORDER_ZYX;
 	Model_UpdateVB();
 
-	Gfx_SetAlphaTest(true);
+	Model_SetAlphaTest(true);
 	if (type != SKIN_64x32) {
 		Model_DrawPart(&model->TorsoLayer);
 		Model_DrawRotate(entity->Anim.LeftLegX,  0, entity->Anim.LeftLegZ,  &set->LeftLegLayer,  false);
@@ -638,6 +807,7 @@ static struct Model  human_model = {
 
 static struct Model* HumanoidModel_GetInstance(void) {
 	Model_Init(&human_model);
+	human_model.Batchable = true;
 	human_model.DrawArm  = HumanModel_DrawArm;
 	human_model.CalcHumanAnims = true;
 	human_model.UsesHumanSkin  = true;
@@ -727,6 +897,7 @@ static struct Model chibi_model = { "chibi", chibi_vertices, &human_tex,
 
 static struct Model* ChibiModel_GetInstance(void) {
 	Model_Init(&chibi_model);
+	chibi_model.Batchable = true;
 	chibi_model.DrawArm  = ChibiModel_DrawArm;
 	chibi_model.armX = 3; chibi_model.armY = 6;
 	chibi_model.CalcHumanAnims = true;
@@ -765,6 +936,7 @@ static struct Model sitting_model = { "sit", human_vertices, &human_tex,
 
 static struct Model* SittingModel_GetInstance(void) {
 	Model_Init(&sitting_model);
+	sitting_model.Batchable = true;
 	sitting_model.DrawArm  = HumanModel_DrawArm;
 	sitting_model.CalcHumanAnims = true;
 	sitting_model.UsesHumanSkin  = true;
@@ -827,6 +999,7 @@ static struct Model head_model = { "head", human_vertices, &human_tex,
 
 static struct Model* HeadModel_GetInstance(void) {
 	Model_Init(&head_model);
+	head_model.Batchable = true;
 	head_model.UsesHumanSkin = true;
 	head_model.Pushes        = false;
 	head_model.GetTransform  = HeadModel_GetTransform;
@@ -936,6 +1109,7 @@ static struct Model chicken_model = { "chicken", chicken_vertices, &chicken_tex,
 
 static struct Model* ChickenModel_GetInstance(void) {
 	Model_Init(&chicken_model);
+	chicken_model.Batchable = true;
 	return &chicken_model;
 }
 
@@ -1014,6 +1188,7 @@ static struct Model creeper_model  = {
 
 static struct Model* CreeperModel_GetInstance(void) {
 	Model_Init(&creeper_model);
+	creeper_model.Batchable = true;
 	return &creeper_model;
 }
 
@@ -1091,6 +1266,7 @@ static struct Model pig_model  = { "pig", pig_vertices, &pig_tex,
 
 static struct Model* PigModel_GetInstance(void) {
 	Model_Init(&pig_model);
+	pig_model.Batchable = true;
 	return &pig_model;
 }
 
@@ -1202,7 +1378,9 @@ static void FurlessModel_Draw(struct Entity* entity) {
 
 static void SheepModel_Draw(struct Entity* entity) {
 	FurlessModel_Draw(entity);
-	Gfx_BindTexture(fur_tex.TexID);
+	Model_BindTexture(fur_tex.TexID);
+	Models.skinType = fur_tex.SkinType;
+	Model_SetDefaultTexScale();
 	Model_DrawRotate(-entity->HeadX * MATH_DEG2RAD, 0, 0, &fur_head, true);
 
 	Model_DrawPart(&fur_torso);
@@ -1233,11 +1411,13 @@ static struct Model nofur_model  = { "sheep_nofur", sheep_vertices, &sheep_tex,
 
 static struct Model* SheepModel_GetInstance(void) {
 	Model_Init(&sheep_model);
+	sheep_model.Batchable = true;
 	return &sheep_model;
 }
 
 static struct Model* NoFurModel_GetInstance(void) {
 	Model_Init(&nofur_model);
+	nofur_model.Batchable = true;
 	return &nofur_model;
 }
 
@@ -1318,6 +1498,7 @@ static struct Model skeleton_model  = { "skeleton", skeleton_vertices, &skeleton
 
 static struct Model* SkeletonModel_GetInstance(void) {
 	Model_Init(&skeleton_model);
+	skeleton_model.Batchable = true;
 	skeleton_model.DrawArm  = SkeletonModel_DrawArm;
 	skeleton_model.armX = 5;
 	return &skeleton_model;
@@ -1408,6 +1589,7 @@ static struct Model spider_model  = { "spider", spider_vertices, &spider_tex,
 
 static struct Model* SpiderModel_GetInstance(void) {
 	Model_Init(&spider_model);
+	spider_model.Batchable = true;
 	return &spider_model;
 }
 
@@ -1446,6 +1628,7 @@ static struct Model zombie_model  = { "zombie", human_vertices, &zombie_tex,
 
 static struct Model* ZombieModel_GetInstance(void) {
 	Model_Init(&zombie_model);
+	zombie_model.Batchable = true;
 	zombie_model.DrawArm  = ZombieModel_DrawArm;
 	return &zombie_model;
 }
@@ -1707,6 +1890,7 @@ static void Models_Free(void) {
 		Gfx_DeleteTexture(&tex->TexID);
 	}
 	Models_ContextLost(NULL);
+	ModelBatch_Free();
 
 	Event_UnregisterEntry(&TextureEvents.FileChanged, NULL, Models_TextureChanged);
 	Event_UnregisterVoid(&GfxEvents.ContextLost,      NULL, Models_ContextLost);
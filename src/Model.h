@@ -71,6 +71,10 @@ struct Model {
 	/* e.g. for HumanoidModel, when legs are at the peak of their swing, whole model is moved slightly down */
 	bool Bobbing;
 	bool UsesSkin, CalcHumanAnims, UsesHumanSkin, Pushes;
+	/* Whether this model can be drawn in a batch together with other entities. (false by default) */
+	/* NOTE: Only set this when Draw changes graphics state solely through Model_BindTexture */
+	/* and Model_SetAlphaTest. (e.g. BlockModel changes face culling, so is not batchable) */
+	bool Batchable;
 
 	float Gravity; Vector3 Drag, GroundFriction;
 
@@ -93,6 +97,8 @@ CC_VAR extern struct _ModelsData {
 	/* U/V scale applied to skin texture when rendering models. */
 	/* Default uScale is 1/32, vScale is 1/32 or 1/64 depending on skin. */
 	float uScale, vScale;
+	/* U/V offset applied to skin texture. (non-zero when skin is stored in skin atlas) */
+	float uOffset, vOffset;
 	/* Angle of offset of head from body rotation */
 	float cosHead, sinHead;
 	/* Order of axes rotation when rendering parts. */
@@ -127,10 +133,21 @@ CC_API void Model_Render(struct Model* model, struct Entity* entity);
 /* NOTE: Model_Render already calls this, you don't normally need to call this. */
 CC_API void Model_SetupState(struct Model* model, struct Entity* entity);
 /* Flushes buffered vertices to the GPU. */
+/* NOTE: When batching, vertices are instead transformed and added to a batch. */
 CC_API void Model_UpdateVB(void);
 /* Applies the skin texture of the given entity to the model. */
 /* Uses model's default texture if the entity doesn't have a custom skin. */
 CC_API void Model_ApplyTexture(struct Entity* entity);
+/* Resets U/V scale and offset to the defaults for a texture of Models.skinType. */
+CC_API void Model_SetDefaultTexScale(void);
+/* Sets the texture vertices flushed by Model_UpdateVB are drawn with. */
+CC_API void Model_BindTexture(GfxResourceID texId);
+/* Sets whether alpha testing is used when drawing vertices flushed by Model_UpdateVB. */
+CC_API void Model_SetAlphaTest(bool enabled);
+/* Starts grouping batchable models drawn by Model_Render by texture, instead of drawing each immediately. */
+void Model_BeginBatch(void);
+/* Draws all batches of models grouped since Model_BeginBatch, then stops batching. */
+void Model_EndBatch(void);
 /* Draws the given part with no part-specific rotation (e.g. torso). */
 CC_API void Model_DrawPart(struct ModelPart* part);
 /* Draws the given part with rotation around part's rotation origin. (e.g. arms, head) */
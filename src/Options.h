@@ -29,6 +29,7 @@ extern const char* FpsLimit_Names[FPS_LIMIT_COUNT];
 #define OPT_ENTITY_SHADOW "entityshadow"
 #define OPT_RENDER_TYPE "normal"
 #define OPT_SMOOTH_LIGHTING "gfx-smoothlighting"
+#define OPT_BLOCK_LIGHT "gfx-blocklight"
 #define OPT_MIPMAPS "gfx-mipmaps"
 #define OPT_SURVIVAL_MODE "game-survival"
 #define OPT_CHAT_LOGGING "chat-logging"
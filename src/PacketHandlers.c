@@ -182,6 +182,7 @@ static void Handlers_UpdateLocation(EntityID playerId, struct LocationUpdate* up
 	struct Entity* entity = Entities.List[playerId];
 	if (entity) {
 		entity->VTABLE->SetLocation(entity, update, interpolate);
+		Entities_UpdateGrid(playerId);
 	}
 }
 
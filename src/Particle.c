@@ -10,15 +10,28 @@
 #include "Game.h"
 #include "Event.h"
 #include "GameStructs.h"
+#include "Platform.h"
 
 
 /*########################################################################################################################*
 *------------------------------------------------------Particle base------------------------------------------------------*
 *#########################################################################################################################*/
 static GfxResourceID Particles_TexId, Particles_VB;
-#define PARTICLES_MAX 600
+#define PARTICLES_MAX 32768
 static RNGState rnd;
-static bool particle_hitTerrain;
+
+/* Particles are stored as a structure of arrays, so the movement of all particles */
+/* can be integrated in a few tight loops over contiguous floats (see Particle_PhysicsTick) */
+struct ParticleStore {
+	float LastX[PARTICLES_MAX], LastY[PARTICLES_MAX], LastZ[PARTICLES_MAX];
+	float NextX[PARTICLES_MAX], NextY[PARTICLES_MAX], NextZ[PARTICLES_MAX];
+	float VelX[PARTICLES_MAX],  VelY[PARTICLES_MAX],  VelZ[PARTICLES_MAX];
+	float Lifetime[PARTICLES_MAX];
+	uint8_t Size[PARTICLES_MAX];
+	/* Whether the particle should be removed at the end of the current tick. */
+	bool Dead[PARTICLES_MAX];
+	int Count;
+};
 
 void Particle_DoRender(Vector2* size, Vector3* pos, TextureRec* rec, PackedCol col, VertexP3fT2fC4b* vertices) {
 	struct Matrix* view;
@@ -48,10 +61,42 @@ void Particle_DoRender(Vector2* size, Vector3* pos, TextureRec* rec, PackedCol c
 				   v.V = rec->V2; vertices[3] = v;
 }
 
-static void Particle_Reset(struct Particle* p, Vector3 pos, Vector3 velocity, float lifetime) {
-	p->LastPos = pos; p->NextPos = pos;
-	p->Velocity = velocity;
-	p->Lifetime = lifetime;
+/* Adds a new particle to the end of the store, returning its index. */
+static int Particle_Add(struct ParticleStore* s, Vector3 pos, Vector3 velocity, float lifetime) {
+	int i = s->Count++;
+	s->LastX[i] = pos.X; s->LastY[i] = pos.Y; s->LastZ[i] = pos.Z;
+	s->NextX[i] = pos.X; s->NextY[i] = pos.Y; s->NextZ[i] = pos.Z;
+	s->VelX[i]  = velocity.X; s->VelY[i] = velocity.Y; s->VelZ[i] = velocity.Z;
+	s->Lifetime[i] = lifetime;
+	s->Dead[i]     = false;
+	return i;
+}
+
+/* Removes the particle at the given index, by moving the last particle into its slot. */
+static void Particle_RemoveAt(struct ParticleStore* s, int i) {
+	int last = --s->Count;
+	s->LastX[i] = s->LastX[last]; s->LastY[i] = s->LastY[last]; s->LastZ[i] = s->LastZ[last];
+	s->NextX[i] = s->NextX[last]; s->NextY[i] = s->NextY[last]; s->NextZ[i] = s->NextZ[last];
+	s->VelX[i]  = s->VelX[last];  s->VelY[i]  = s->VelY[last];  s->VelZ[i]  = s->VelZ[last];
+	s->Lifetime[i] = s->Lifetime[last];
+	s->Size[i]     = s->Size[last];
+	s->Dead[i]     = s->Dead[last];
+}
+
+/* Returns the index of the particle with the least lifetime left, which is removed first when the store is full. */
+/* NOTE: Particle_RemoveAt reorders particles, so index 0 is not necessarily the oldest particle. */
+static int Particle_NextExpiring(struct ParticleStore* s) {
+	int i, best = 0;
+	for (i = 1; i < s->Count; i++) {
+		if (s->Lifetime[i] < s->Lifetime[best]) best = i;
+	}
+	return best;
+}
+
+static void Particle_GetPos(struct ParticleStore* s, int i, float t, Vector3* pos) {
+	pos->X = t * (s->NextX[i] - s->LastX[i]) + s->LastX[i];
+	pos->Y = t * (s->NextY[i] - s->LastY[i]) + s->LastY[i];
+	pos->Z = t * (s->NextZ[i] - s->LastZ[i]) + s->LastZ[i];
 }
 
 static bool Particle_CanPass(BlockID block, bool throughLiquids) {
@@ -59,12 +104,10 @@ static bool Particle_CanPass(BlockID block, bool throughLiquids) {
 	return draw == DRAW_GAS || draw == DRAW_SPRITE || (throughLiquids && Blocks.IsLiquid[block]);
 }
 
-static bool Particle_CollideHor(Vector3* nextPos, BlockID block) {
-	Vector3 horPos = Vector3_Create3((float)Math_Floor(nextPos->X), 0.0f, (float)Math_Floor(nextPos->Z));
-	Vector3 min, max;
-	Vector3_Add(&min, &Blocks.MinBB[block], &horPos);
-	Vector3_Add(&max, &Blocks.MaxBB[block], &horPos);
-	return nextPos->X >= min.X && nextPos->Z >= min.Z && nextPos->X < max.X && nextPos->Z < max.Z;
+static bool Particle_CollideHor(float x, float z, BlockID block) {
+	float horX = (float)Math_Floor(x), horZ = (float)Math_Floor(z);
+	return x >= horX + Blocks.MinBB[block].X && z >= horZ + Blocks.MinBB[block].Z
+		&& x <  horX + Blocks.MaxBB[block].X && z <  horZ + Blocks.MaxBB[block].Z;
 }
 
 static BlockID Particle_GetBlock(int x, int y, int z) {
@@ -75,94 +118,121 @@ static BlockID Particle_GetBlock(int x, int y, int z) {
 	return Env_SidesBlock;
 }
 
-static bool Particle_TestY(struct Particle* p, int y, bool topFace, bool throughLiquids) {
+/* Returns whether the given position lies inside the collision bounds of a solid block. */
+static bool Particle_InsideBlock(float x, float y, float z, bool throughLiquids) {
+	BlockID cur = Particle_GetBlock((int)x, (int)y, (int)z);
+	float minY, maxY;
+	if (Particle_CanPass(cur, throughLiquids)) return false;
+
+	minY = Math_Floor(y) + Blocks.MinBB[cur].Y;
+	maxY = Math_Floor(y) + Blocks.MaxBB[cur].Y;
+	return y >= minY && y < maxY && Particle_CollideHor(x, z, cur);
+}
+
+/* Returns whether the particle hit the top/bottom face of the block at the given y. */
+static bool Particle_TestY(struct ParticleStore* s, int i, int y, bool topFace, bool throughLiquids) {
 	BlockID block;
-	Vector3 minBB, maxBB;
 	float collideY;
 	bool collideVer;
 
 	if (y < 0) {
-		p->NextPos.Y = ENTITY_ADJUSTMENT; p->LastPos.Y = ENTITY_ADJUSTMENT;
-		p->Velocity  = Vector3_Zero();
-		particle_hitTerrain = true;
-		return false;
+		s->NextY[i] = ENTITY_ADJUSTMENT; s->LastY[i] = ENTITY_ADJUSTMENT;
+		s->VelX[i]  = 0.0f; s->VelY[i] = 0.0f; s->VelZ[i] = 0.0f;
+		return true;
 	}
 
-	block = Particle_GetBlock((int)p->NextPos.X, y, (int)p->NextPos.Z);
-	if (Particle_CanPass(block, throughLiquids)) return true;
-	minBB = Blocks.MinBB[block]; maxBB = Blocks.MaxBB[block];
+	block = Particle_GetBlock((int)s->NextX[i], y, (int)s->NextZ[i]);
+	if (Particle_CanPass(block, throughLiquids)) return false;
 
-	collideY   = y + (topFace ? maxBB.Y : minBB.Y);
-	collideVer = topFace ? (p->NextPos.Y < collideY) : (p->NextPos.Y > collideY);
+	collideY   = y + (topFace ? Blocks.MaxBB[block].Y : Blocks.MinBB[block].Y);
+	collideVer = topFace ? (s->NextY[i] < collideY) : (s->NextY[i] > collideY);
 
-	if (collideVer && Particle_CollideHor(&p->NextPos, block)) {
+	if (collideVer && Particle_CollideHor(s->NextX[i], s->NextZ[i], block)) {
 		float adjust = topFace ? ENTITY_ADJUSTMENT : -ENTITY_ADJUSTMENT;
-		p->LastPos.Y = collideY + adjust;
-		p->NextPos.Y = p->LastPos.Y;
-		p->Velocity  = Vector3_Zero();
-		particle_hitTerrain = true;
-		return false;
+		s->LastY[i] = collideY + adjust;
+		s->NextY[i] = s->LastY[i];
+		s->VelX[i]  = 0.0f; s->VelY[i] = 0.0f; s->VelZ[i] = 0.0f;
+		return true;
 	}
-	return true;
+	return false;
 }
 
-static bool Particle_PhysicsTick(struct Particle* p, float gravity, bool throughLiquids, double delta) {
-	BlockID cur;
-	float minY, maxY;
-	Vector3 velocity;
+/* Returns whether the particle collided with the world while moving vertically this tick. */
+static bool Particle_CollideY(struct ParticleStore* s, int i, bool throughLiquids) {
 	int y, begY, endY;
+	begY = Math_Floor(s->LastY[i]);
+	endY = Math_Floor(s->NextY[i]);
 
-	p->LastPos = p->NextPos;
-	cur  = Particle_GetBlock((int)p->NextPos.X, (int)p->NextPos.Y, (int)p->NextPos.Z);
-	minY = Math_Floor(p->NextPos.Y) + Blocks.MinBB[cur].Y;
-	maxY = Math_Floor(p->NextPos.Y) + Blocks.MaxBB[cur].Y;
+	if (s->VelY[i] > 0.0f) {
+		/* don't test block we are already in */
+		for (y = begY + 1; y <= endY; y++) {
+			if (Particle_TestY(s, i, y, false, throughLiquids)) return true;
+		}
+	} else {
+		for (y = begY; y >= endY; y--) {
+			if (Particle_TestY(s, i, y, true,  throughLiquids)) return true;
+		}
+	}
+	return false;
+}
 
-	if (!Particle_CanPass(cur, throughLiquids) && p->NextPos.Y >= minY
-		&& p->NextPos.Y < maxY && Particle_CollideHor(&p->NextPos, cur)) {
-		return true;
+/* Moves all particles in the store forward one tick, and flags particles which need to be removed. */
+/* NOTE: Particles are processed in separate passes, so that the integration pass does not */
+/* touch the world at all and is simple enough for the compiler to vectorise. */
+static void Particle_PhysicsTick(struct ParticleStore* s, float gravity, bool throughLiquids, bool removeOnHit, double delta) {
+	float dt = (float)delta, move = (float)delta * 3.0f, fall = gravity * (float)delta;
+	int i, count = s->Count;
+	bool hit;
+
+	Mem_Copy(s->LastX, s->NextX, count * sizeof(float));
+	Mem_Copy(s->LastY, s->NextY, count * sizeof(float));
+	Mem_Copy(s->LastZ, s->NextZ, count * sizeof(float));
+
+	for (i = 0; i < count; i++) {
+		s->Dead[i] = Particle_InsideBlock(s->NextX[i], s->NextY[i], s->NextZ[i], throughLiquids);
 	}
 
-	p->Velocity.Y -= gravity * (float)delta;
-	begY = Math_Floor(p->NextPos.Y);
-	
-	Vector3_Mul1(&velocity, &p->Velocity, (float)delta * 3.0f);
-	Vector3_Add(&p->NextPos, &p->NextPos, &velocity);
-	endY = Math_Floor(p->NextPos.Y);
+	for (i = 0; i < count; i++) { s->VelY[i] -= fall; }
+	for (i = 0; i < count; i++) {
+		s->NextX[i] += s->VelX[i] * move;
+		s->NextY[i] += s->VelY[i] * move;
+		s->NextZ[i] += s->VelZ[i] * move;
+	}
+	for (i = 0; i < count; i++) { s->Lifetime[i] -= dt; }
 
-	if (p->Velocity.Y > 0.0f) {
-		/* don't test block we are already in */
-		for (y = begY + 1; y <= endY && Particle_TestY(p, y, false, throughLiquids); y++) {}
-	} else {
-		for (y = begY; y >= endY && Particle_TestY(p, y, true, throughLiquids); y--) {}
+	for (i = 0; i < count; i++) {
+		if (s->Dead[i]) continue;
+		hit = Particle_CollideY(s, i, throughLiquids);
+		s->Dead[i] = (removeOnHit && hit) || s->Lifetime[i] < 0.0f;
 	}
+}
 
-	p->Lifetime -= (float)delta;
-	return p->Lifetime < 0.0f;
+/* Draws the given range of vertices in the active dynamic VB, splitting it if the range */
+/* has more vertices than can be addressed by the default 16 bit index buffer. */
+static void Particles_DrawRange(int count, int offset) {
+	int batch;
+	while (count > 0) {
+		batch = min(count, GFX_MAX_VERTICES);
+		Gfx_DrawVb_IndexedTris_Range(batch, offset);
+		count -= batch; offset += batch;
+	}
 }
 
 
 /*########################################################################################################################*
 *-------------------------------------------------------Rain particle-----------------------------------------------------*
 *#########################################################################################################################*/
-struct RainParticle { struct Particle Base; };
-
-static struct RainParticle rain_Particles[PARTICLES_MAX];
-static int rain_count;
+static struct ParticleStore rain;
 static TextureRec rain_rec = { 2.0f/128.0f, 14.0f/128.0f, 5.0f/128.0f, 16.0f/128.0f };
 
-static bool RainParticle_Tick(struct RainParticle* p, double delta) {
-	particle_hitTerrain = false;
-	return Particle_PhysicsTick(&p->Base, 3.5f, false, delta) || particle_hitTerrain;
-}
-
-static void RainParticle_Render(struct RainParticle* p, float t, VertexP3fT2fC4b* vertices) {
+static void RainParticle_Render(int i, float t, VertexP3fT2fC4b* vertices) {
 	Vector3 pos;
 	Vector2 size;
 	PackedCol col;
 	int x, y, z;
 
-	Vector3_Lerp(&pos, &p->Base.LastPos, &p->Base.NextPos, t);
-	size.X = (float)p->Base.Size * 0.015625f; size.Y = size.X;
+	Particle_GetPos(&rain, i, t, &pos);
+	size.X = (float)rain.Size[i] * 0.015625f; size.Y = size.X;
 
 	x = Math_Floor(pos.X); y = Math_Floor(pos.Y); z = Math_Floor(pos.Z);
 	col = World_Contains(x, y, z) ? Lighting_Col(x, y, z) : Env_SunCol;
@@ -170,38 +240,28 @@ static void RainParticle_Render(struct RainParticle* p, float t, VertexP3fT2fC4b
 }
 
 static void Rain_Render(float t) {
-	VertexP3fT2fC4b vertices[PARTICLES_MAX * 4];
 	VertexP3fT2fC4b* ptr;
 	int i;
-	if (!rain_count) return;
+	if (!rain.Count) return;
 	
-	ptr = vertices;
-	for (i = 0; i < rain_count; i++) {
-		RainParticle_Render(&rain_Particles[i], t, ptr);
+	ptr = (VertexP3fT2fC4b*)Gfx_LockDynamicVb(Particles_VB, VERTEX_FORMAT_P3FT2FC4B, rain.Count * 4);
+	for (i = 0; i < rain.Count; i++) {
+		RainParticle_Render(i, t, ptr);
 		ptr += 4;
 	}
+	Gfx_UnlockDynamicVb(Particles_VB);
 
 	Gfx_BindTexture(Particles_TexId);
-	Gfx_UpdateDynamicVb_IndexedTris(Particles_VB, vertices, rain_count * 4);
-}
-
-static void Rain_RemoveAt(int index) {
-	struct RainParticle removed = rain_Particles[index];
-	int i;
-
-	for (i = index; i < rain_count - 1; i++) {
-		rain_Particles[i] = rain_Particles[i + 1];
-	}
-	rain_Particles[rain_count - 1] = removed;
-	rain_count--;
+	Particles_DrawRange(rain.Count * 4, 0);
 }
 
 static void Rain_Tick(double delta) {
 	int i;
-	for (i = 0; i < rain_count; i++) {
-		if (RainParticle_Tick(&rain_Particles[i], delta)) {
-			Rain_RemoveAt(i); i--;
-		}
+	Particle_PhysicsTick(&rain, 3.5f, false, true, delta);
+
+	/* iterate backwards, so particles swapped into a removed slot have already been checked */
+	for (i = rain.Count - 1; i >= 0; i--) {
+		if (rain.Dead[i]) Particle_RemoveAt(&rain, i);
 	}
 }
 
@@ -209,43 +269,36 @@ static void Rain_Tick(double delta) {
 /*########################################################################################################################*
 *------------------------------------------------------Terrain particle---------------------------------------------------*
 *#########################################################################################################################*/
-struct TerrainParticle {
-	struct Particle Base;
-	TextureRec Rec;
-	TextureLoc TexLoc;
-	BlockID Block;
-};
+static struct ParticleStore terrain;
+static TextureRec terrain_recs[PARTICLES_MAX];
+static TextureLoc terrain_texLocs[PARTICLES_MAX];
+static BlockID terrain_blocks[PARTICLES_MAX];
 
-static struct TerrainParticle terrain_particles[PARTICLES_MAX];
-static int terrain_count;
-static uint16_t terrain_1DCount[ATLAS1D_MAX_ATLASES];
-static uint16_t terrain_1DIndices[ATLAS1D_MAX_ATLASES];
+static int terrain_1DCount[ATLAS1D_MAX_ATLASES];
+static int terrain_1DIndices[ATLAS1D_MAX_ATLASES];
 
-static bool TerrainParticle_Tick(struct TerrainParticle* p, double delta) {
-	return Particle_PhysicsTick(&p->Base, 5.4f, true, delta);
-}
-
-static void TerrainParticle_Render(struct TerrainParticle* p, float t, VertexP3fT2fC4b* vertices) {
-	PackedCol col = PACKEDCOL_WHITE;
+static void TerrainParticle_Render(int i, float t, VertexP3fT2fC4b* vertices) {
+	PackedCol col  = PACKEDCOL_WHITE;
+	BlockID block  = terrain_blocks[i];
 	Vector3 pos;
 	Vector2 size;
 	int x, y, z;
 
-	Vector3_Lerp(&pos, &p->Base.LastPos, &p->Base.NextPos, t);
-	size.X = (float)p->Base.Size * 0.015625f; size.Y = size.X;
+	Particle_GetPos(&terrain, i, t, &pos);
+	size.X = (float)terrain.Size[i] * 0.015625f; size.Y = size.X;
 	
-	if (!Blocks.FullBright[p->Block]) {
+	if (!Blocks.FullBright[block]) {
 		x = Math_Floor(pos.X); y = Math_Floor(pos.Y); z = Math_Floor(pos.Z);
 		col = World_Contains(x, y, z) ? Lighting_Col_XSide(x, y, z) : Env_SunXSide;
 	}
 
-	if (Blocks.Tinted[p->Block]) {
-		PackedCol tintCol = Blocks.FogCol[p->Block];
+	if (Blocks.Tinted[block]) {
+		PackedCol tintCol = Blocks.FogCol[block];
 		col.R = (uint8_t)(col.R * tintCol.R / 255);
 		col.G = (uint8_t)(col.G * tintCol.G / 255);
 		col.B = (uint8_t)(col.B * tintCol.B / 255);
 	}
-	Particle_DoRender(&size, &pos, &p->Rec, col, vertices);
+	Particle_DoRender(&size, &pos, &terrain_recs[i], col, vertices);
 }
 
 static void Terrain_Update1DCounts(void) {
@@ -255,8 +308,8 @@ static void Terrain_Update1DCounts(void) {
 		terrain_1DCount[i]   = 0;
 		terrain_1DIndices[i] = 0;
 	}
-	for (i = 0; i < terrain_count; i++) {
-		index = Atlas1D_Index(terrain_particles[i].TexLoc);
+	for (i = 0; i < terrain.Count; i++) {
+		index = Atlas1D_Index(terrain_texLocs[i]);
 		terrain_1DCount[index] += 4;
 	}
 	for (i = 1; i < Atlas1D_Count; i++) {
@@ -265,49 +318,45 @@ static void Terrain_Update1DCounts(void) {
 }
 
 static void Terrain_Render(float t) {
-	VertexP3fT2fC4b vertices[PARTICLES_MAX * 4];
-	VertexP3fT2fC4b* ptr;
+	VertexP3fT2fC4b* vertices;
 	int offset = 0;
 	int i, index;
-	if (!terrain_count) return;
+	if (!terrain.Count) return;
 
 	Terrain_Update1DCounts();
-	for (i = 0; i < terrain_count; i++) {
-		index = Atlas1D_Index(terrain_particles[i].TexLoc);
-		ptr   = &vertices[terrain_1DIndices[index]];
-
-		TerrainParticle_Render(&terrain_particles[i], t, ptr);
+	vertices = (VertexP3fT2fC4b*)Gfx_LockDynamicVb(Particles_VB, VERTEX_FORMAT_P3FT2FC4B, terrain.Count * 4);
+	for (i = 0; i < terrain.Count; i++) {
+		index = Atlas1D_Index(terrain_texLocs[i]);
+		TerrainParticle_Render(i, t, &vertices[terrain_1DIndices[index]]);
 		terrain_1DIndices[index] += 4;
 	}
+	Gfx_UnlockDynamicVb(Particles_VB);
 
-	Gfx_SetDynamicVbData(Particles_VB, vertices, terrain_count * 4);
 	for (i = 0; i < Atlas1D_Count; i++) {
 		int partCount = terrain_1DCount[i];
 		if (!partCount) continue;
 
 		Gfx_BindTexture(Atlas1D_TexIds[i]);
-		Gfx_DrawVb_IndexedTris_Range(partCount, offset);
+		Particles_DrawRange(partCount, offset);
 		offset += partCount;
 	}
 }
 
-static void Terrain_RemoveAt(int index) {
-	struct TerrainParticle removed = terrain_particles[index];
-	int i;
-
-	for (i = index; i < terrain_count - 1; i++) {
-		terrain_particles[i] = terrain_particles[i + 1];
-	}
-	terrain_particles[terrain_count - 1] = removed;
-	terrain_count--;
+static void Terrain_RemoveAt(int i) {
+	int last = terrain.Count - 1;
+	terrain_recs[i]    = terrain_recs[last];
+	terrain_texLocs[i] = terrain_texLocs[last];
+	terrain_blocks[i]  = terrain_blocks[last];
+	Particle_RemoveAt(&terrain, i);
 }
 
 static void Terrain_Tick(double delta) {
 	int i;
-	for (i = 0; i < terrain_count; i++) {
-		if (TerrainParticle_Tick(&terrain_particles[i], delta)) {
-			Terrain_RemoveAt(i); i--;
-		}
+	Particle_PhysicsTick(&terrain, 5.4f, true, false, delta);
+
+	/* iterate backwards, so particles swapped into a removed slot have already been checked */
+	for (i = terrain.Count - 1; i >= 0; i--) {
+		if (terrain.Dead[i]) Terrain_RemoveAt(i);
 	}
 }
 
@@ -322,7 +371,7 @@ static void Particles_FileChanged(void* obj, struct Stream* stream, const String
 }
 
 void Particles_Render(double delta, float t) {
-	if (!terrain_count && !rain_count) return;
+	if (!terrain.Count && !rain.Count) return;
 	if (Gfx.LostContext) return;
 
 	Gfx_SetTexturing(true);
@@ -342,7 +391,6 @@ void Particles_Tick(struct ScheduledTask* task) {
 }
 
 void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
-	struct TerrainParticle* p;
 	TextureLoc loc;
 	int texIndex;
 	TextureRec baseRec, rec;
@@ -361,7 +409,7 @@ void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
 	/* per-particle variables */
 	Vector3 velocity;
 	float life;
-	int x, y, z, type;
+	int i, x, y, z, type;
 
 	if (now != BLOCK_AIR || Blocks.Draw[old] == DRAW_GAS) return;
 	Vector3I_ToVector3(&origin, &coords);
@@ -409,28 +457,26 @@ void Particles_BreakBlockEffect(Vector3I coords, BlockID old, BlockID now) {
 				rec.U2 = min(rec.U2, maxU2) - 0.01f * uScale;
 				rec.V2 = min(rec.V2, maxV2) - 0.01f * vScale;
 
-				if (terrain_count == PARTICLES_MAX) Terrain_RemoveAt(0);
-				p = &terrain_particles[terrain_count++];
+				if (terrain.Count == PARTICLES_MAX) Terrain_RemoveAt(Particle_NextExpiring(&terrain));
 
 				life = 0.3f + Random_Float(&rnd) * 1.2f;
 				Vector3_Add(&pos, &origin, &cell);
-				Particle_Reset(&p->Base, pos, velocity, life);
+				i = Particle_Add(&terrain, pos, velocity, life);
 
-				p->Rec    = rec;
-				p->TexLoc = loc;
-				p->Block  = old;
+				terrain_recs[i]    = rec;
+				terrain_texLocs[i] = loc;
+				terrain_blocks[i]  = old;
 				type = Random_Range(&rnd, 0, 30);
-				p->Base.Size = (uint8_t)(type >= 28 ? 12 : (type >= 25 ? 10 : 8));
+				terrain.Size[i] = (uint8_t)(type >= 28 ? 12 : (type >= 25 ? 10 : 8));
 			}
 		}
 	}
 }
 
 void Particles_RainSnowEffect(Vector3 pos) {
-	struct RainParticle* p;
 	Vector3 origin = pos;
 	Vector3 offset, velocity;
-	int i, type;
+	int i, j, type;
 
 	for (i = 0; i < 2; i++) {
 		velocity.X = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
@@ -441,14 +487,13 @@ void Particles_RainSnowEffect(Vector3 pos) {
 		offset.Y = Random_Float(&rnd) * 0.1f + 0.01f;
 		offset.Z = Random_Float(&rnd);
 
-		if (rain_count == PARTICLES_MAX) Rain_RemoveAt(0);
-		p = &rain_Particles[rain_count++];
+		if (rain.Count == PARTICLES_MAX) Particle_RemoveAt(&rain, Particle_NextExpiring(&rain));
 
 		Vector3_Add(&pos, &origin, &offset);
-		Particle_Reset(&p->Base, pos, velocity, 40.0f);
+		j = Particle_Add(&rain, pos, velocity, 40.0f);
 
 		type = Random_Range(&rnd, 0, 30);
-		p->Base.Size = (uint8_t)(type >= 28 ? 2 : (type >= 25 ? 4 : 3));
+		rain.Size[j] = (uint8_t)(type >= 28 ? 2 : (type >= 25 ? 4 : 3));
 	}
 }
 
@@ -487,7 +532,7 @@ static void Particles_Free(void) {
 	Event_UnregisterVoid(&GfxEvents.ContextRecreated, NULL, Particles_ContextRecreated);
 }
 
-static void Particles_Reset(void) { rain_count = 0; terrain_count = 0; }
+static void Particles_Reset(void) { rain.Count = 0; terrain.Count = 0; }
 
 struct IGameComponent Particles_Component = {
 	Particles_Init,  /* Init  */
@@ -10,13 +10,6 @@ struct IGameComponent;
 struct ScheduledTask;
 extern struct IGameComponent Particles_Component;
 
-struct Particle {
-	Vector3 Velocity;
-	float Lifetime;
-	Vector3 LastPos, NextPos;
-	uint8_t Size;
-};
-
 /* http://www.opengl-tutorial.org/intermediate-tutorials/billboards-particles/billboards/ */
 void Particle_DoRender(Vector2* size, Vector3* pos, TextureRec* rec, PackedCol col, VertexP3fT2fC4b* vertices);
 void Particles_Render(double delta, float t);
@@ -92,16 +92,19 @@ const ReturnCode ReturnCode_SocketWouldBlock = EWOULDBLOCK;
 #include <sys/filio.h>
 #endif
 /* Platform specific include files */
-#if defined CC_BUILD_UNIX
-#include <AL/al.h>
-#include <AL/alc.h>
-#elif defined CC_BUILD_OSX
+#if defined CC_BUILD_OSX
 #include <mach/mach_time.h>
 #include <mach-o/dyld.h>
-#include <OpenAL/al.h>
-#include <OpenAL/alc.h>
 #elif defined CC_BUILD_WEB
 #include <emscripten.h>
+#endif
+
+#if defined CC_BUILD_NOAUDIO
+/* Null audio backend doesn't need OpenAL */
+#elif defined CC_BUILD_OSX
+#include <OpenAL/al.h>
+#include <OpenAL/alc.h>
+#elif defined CC_BUILD_UNIX || defined CC_BUILD_WEB
 #include <AL/al.h>
 #include <AL/alc.h>
 #endif
@@ -1423,7 +1426,86 @@ ReturnCode Socket_Poll(SocketHandle socket, int mode, bool* success) {
 *----------------------------------------------------------Audio----------------------------------------------------------*
 *#########################################################################################################################*/
 static ReturnCode Audio_AllCompleted(AudioHandle handle, bool* finished);
-#ifdef CC_BUILD_WIN
+#if defined CC_BUILD_NOAUDIO
+/* Discards all audio, but buffers still take as long to complete as they would to play. */
+/* Allows measuring the latency and CPU usage of producing audio without an audio device. */
+struct AudioContext {
+	uint64_t EndTimes[AUDIO_MAX_BUFFERS]; /* Time in microseconds each buffer finishes playing at */
+	uint64_t QueueEnd; /* Time in microseconds all queued buffers finish playing at */
+	struct AudioFormat Format;
+	int Count;
+};
+static struct AudioContext Audio_Contexts[20];
+static uint64_t audio_start;
+
+static uint64_t Audio_Now(void) {
+	return Stopwatch_ElapsedMicroseconds(audio_start, Stopwatch_Measure());
+}
+
+void Audio_Init(AudioHandle* handle, int buffers) {
+	struct AudioContext* ctx;
+	int i;
+	if (!audio_start) audio_start = Stopwatch_Measure();
+
+	for (i = 0; i < Array_Elems(Audio_Contexts); i++) {
+		ctx = &Audio_Contexts[i];
+		if (ctx->Count) continue;
+
+		Mem_Set(ctx->EndTimes, 0, sizeof(ctx->EndTimes));
+		ctx->QueueEnd = 0;
+		*handle    = i;
+		ctx->Count = buffers;
+		return;
+	}
+	Logger_Abort("No free audio contexts");
+}
+
+ReturnCode Audio_Free(AudioHandle handle) {
+	struct AudioFormat fmt = { 0 };
+	struct AudioContext* ctx = &Audio_Contexts[handle];
+	ctx->Count  = 0;
+	ctx->Format = fmt;
+	return 0;
+}
+
+ReturnCode Audio_SetFormat(AudioHandle handle, struct AudioFormat* format) {
+	Audio_Contexts[handle].Format = *format;
+	return 0;
+}
+
+ReturnCode Audio_BufferData(AudioHandle handle, int idx, void* data, uint32_t dataSize) {
+	struct AudioContext* ctx = &Audio_Contexts[handle];
+	struct AudioFormat* fmt  = &ctx->Format;
+	uint64_t now = Audio_Now(), duration;
+	int frameSize = fmt->Channels * fmt->BitsPerSample / 8;
+
+	duration = 0;
+	if (frameSize && fmt->SampleRate) {
+		duration = (uint64_t)(dataSize / frameSize) * 1000000 / fmt->SampleRate;
+	}
+
+	/* Buffers play one after another, starting immediately if nothing is queued */
+	ctx->QueueEnd      = max(ctx->QueueEnd, now) + duration;
+	ctx->EndTimes[idx] = ctx->QueueEnd;
+	return 0;
+}
+
+ReturnCode Audio_Play(AudioHandle handle) { return 0; }
+
+ReturnCode Audio_Stop(AudioHandle handle) {
+	struct AudioContext* ctx = &Audio_Contexts[handle];
+	Mem_Set(ctx->EndTimes, 0, sizeof(ctx->EndTimes));
+	ctx->QueueEnd = 0;
+	return 0;
+}
+
+ReturnCode Audio_IsCompleted(AudioHandle handle, int idx, bool* completed) {
+	*completed = Audio_Now() >= Audio_Contexts[handle].EndTimes[idx];
+	return 0;
+}
+
+ReturnCode Audio_IsFinished(AudioHandle handle, bool* finished) { return Audio_AllCompleted(handle, finished); }
+#elif defined CC_BUILD_WIN
 struct AudioContext {
 	HWAVEOUT Handle;
 	WAVEHDR Headers[AUDIO_MAX_BUFFERS];
@@ -1526,8 +1608,7 @@ ReturnCode Audio_IsCompleted(AudioHandle handle, int idx, bool* completed) {
 }
 
 ReturnCode Audio_IsFinished(AudioHandle handle, bool* finished) { return Audio_AllCompleted(handle, finished); }
-#endif
-#ifdef CC_BUILD_POSIX
+#elif defined CC_BUILD_POSIX
 struct AudioContext {
 	ALuint Source;
 	ALuint Buffers[AUDIO_MAX_BUFFERS];
@@ -2129,11 +2210,15 @@ static void Platform_InitCommon(void) {
 	signal(SIGCHLD, SIG_IGN);
 	/* So writing to closed socket doesn't raise SIGPIPE */
 	signal(SIGPIPE, SIG_IGN);
+#ifndef CC_BUILD_NOAUDIO
 	pthread_mutex_init(&audio_lock, NULL);
+#endif
 }
 
 void Platform_Free(void) {
+#ifndef CC_BUILD_NOAUDIO
 	pthread_mutex_destroy(&audio_lock);
+#endif
 }
 
 ReturnCode Platform_SetCurrentDirectory(const String* path) {
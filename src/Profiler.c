@@ -0,0 +1,128 @@
+#include "Profiler.h"
+#include "Platform.h"
+#include "Stream.h"
+#include "Benchmark.h"
+
+bool Profiler_Enabled;
+int Profiler_FramesCount;
+
+struct ProfilerFrame { int ZonesCount; struct ProfilerZone Zones[PROFILER_MAX_ZONES]; };
+/* One extra frame, so the frame currently being recorded never overwrites a recorded frame */
+static struct ProfilerFrame prof_frames[PROFILER_FRAMES + 1];
+static struct ProfilerFrame* prof_cur;
+static int prof_next; /* Index of frame in ring buffer the next frame is recorded into */
+
+/* Index of the zone started at each depth, or -1 if that zone was ignored */
+static int prof_stack[PROFILER_MAX_DEPTH];
+static int prof_depth;
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Recording--------------------------------------------------------*
+*#########################################################################################################################*/
+void Profiler_Begin(const char* name) {
+	struct ProfilerZone* zone;
+	if (!prof_cur) return;
+
+	if (prof_depth < PROFILER_MAX_DEPTH) {
+		if (prof_cur->ZonesCount < PROFILER_MAX_ZONES) {
+			prof_stack[prof_depth] = prof_cur->ZonesCount;
+			zone = &prof_cur->Zones[prof_cur->ZonesCount++];
+
+			zone->Name  = name;
+			zone->Depth = prof_depth;
+			zone->Beg   = Stopwatch_Measure();
+			zone->End   = zone->Beg;
+		} else {
+			prof_stack[prof_depth] = -1;
+		}
+	}
+	prof_depth++;
+}
+
+void Profiler_End(void) {
+	int i;
+	if (!prof_cur || !prof_depth) return;
+
+	prof_depth--;
+	if (prof_depth >= PROFILER_MAX_DEPTH) return;
+
+	i = prof_stack[prof_depth];
+	if (i >= 0) prof_cur->Zones[i].End = Stopwatch_Measure();
+}
+
+void Profiler_BeginFrame(void) {
+	/* The benchmark times its stages using zones */
+	if (!Profiler_Enabled && !Benchmark_Active) return;
+	prof_cur   = &prof_frames[prof_next];
+	prof_depth = 0;
+
+	prof_cur->ZonesCount = 0;
+	Profiler_Begin("Frame");
+}
+
+void Profiler_EndFrame(void) {
+	if (!prof_cur) return;
+	/* Close any zones that were left open, so that the frame zone is always ended */
+	while (prof_depth) Profiler_End();
+
+	prof_cur  = NULL;
+	prof_next = (prof_next + 1) % (PROFILER_FRAMES + 1);
+	if (Profiler_FramesCount < PROFILER_FRAMES) Profiler_FramesCount++;
+}
+
+int Profiler_GetFrame(int i, struct ProfilerZone** zones) {
+	struct ProfilerFrame* frame;
+	if (i < 0 || i >= Profiler_FramesCount) { *zones = NULL; return 0; }
+
+	frame  = &prof_frames[(prof_next - 1 - i + PROFILER_FRAMES + 1) % (PROFILER_FRAMES + 1)];
+	*zones = frame->Zones;
+	return frame->ZonesCount;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Trace output------------------------------------------------------*
+*#########################################################################################################################*/
+ReturnCode Profiler_DumpTrace(const String* path) {
+	String line; char lineBuffer[2048];
+	struct ProfilerZone* zones;
+	struct Stream stream;
+	uint64_t start;
+	int i, j, count, beg, dur;
+	ReturnCode res;
+
+	Profiler_GetFrame(Profiler_FramesCount - 1, &zones);
+	if (!zones) return 0;
+	start = zones[0].Beg;
+
+	res = Stream_CreateFile(&stream, path);
+	if (res) return res;
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "{\"traceEvents\":[");
+
+	/* Oldest frame first, so the events are in order of time */
+	for (i = Profiler_FramesCount - 1; i >= 0 && !res; i--) {
+		count = Profiler_GetFrame(i, &zones);
+
+		for (j = 0; j < count && !res; j++) {
+			beg = (int)Stopwatch_ElapsedMicroseconds(start, zones[j].Beg);
+			dur = (int)Stopwatch_ElapsedMicroseconds(zones[j].Beg, zones[j].End);
+
+			/* JSON does not allow a trailing comma after the last event */
+			if (i != Profiler_FramesCount - 1 || j) String_Append(&line, ',');
+			String_Format3(&line, "{\"name\":\"%c\",\"ph\":\"X\",\"ts\":%i,\"dur\":%i,\"pid\":1,\"tid\":1}",
+				zones[j].Name, &beg, &dur);
+
+			/* Writing every event on its own would be very slow */
+			if (line.length < line.capacity - 128) continue;
+			res = Stream_WriteLine(&stream, &line);
+			line.length = 0;
+		}
+	}
+
+	String_AppendConst(&line, "]}");
+	if (!res) res = Stream_WriteLine(&stream, &line);
+	if (res) { stream.Close(&stream); return res; }
+	return stream.Close(&stream);
+}
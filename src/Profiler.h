@@ -0,0 +1,41 @@
+#ifndef CC_PROFILER_H
+#define CC_PROFILER_H
+#include "String.h"
+/* Records how long named zones of code took in each of the most recently rendered frames.
+   Copyright 2014-2017 ClassicalSharp | Licensed under BSD-3
+*/
+
+/* Number of frames kept in the ring buffer of recorded frames. */
+#define PROFILER_FRAMES 64
+/* Maximum number of zones recorded in one frame. Later zones in the frame are ignored. */
+#define PROFILER_MAX_ZONES 256
+/* Maximum nesting depth of zones. Deeper zones are ignored. */
+#define PROFILER_MAX_DEPTH 16
+
+struct ProfilerZone {
+	const char* Name;   /* Name of this zone. NOTE: Must be a string literal. */
+	uint64_t Beg, End;  /* Stopwatch_Measure() at start and end of this zone. */
+	int Depth;          /* Number of zones this zone is nested inside. (0 for the frame itself) */
+};
+
+/* Whether zones are recorded. Changes only take effect from the next frame. */
+/* NOTE: Zones are also always recorded while a benchmark is running. */
+extern bool Profiler_Enabled;
+/* Number of recorded frames that can be retrieved using Profiler_GetFrame. */
+extern int Profiler_FramesCount;
+
+/* Starts a zone with the given name, nested inside any zones that have not been ended yet. */
+void Profiler_Begin(const char* name);
+/* Ends the most recently started zone. */
+void Profiler_End(void);
+/* Starts recording a new frame, which is the outermost zone of all zones in the frame. */
+void Profiler_BeginFrame(void);
+/* Ends the current frame, adding it to the ring buffer of recorded frames. */
+void Profiler_EndFrame(void);
+/* Returns the zones of a recorded frame, where 0 is the most recent frame. */
+/* NOTE: Zones are in the order they were started, so zones[0] is always the frame itself. */
+int Profiler_GetFrame(int i, struct ProfilerZone** zones);
+/* Saves all recorded frames to the given file, in Chrome's trace event JSON format. */
+/* NOTE: This can be loaded in chrome://tracing or speedscope for offline analysis. */
+ReturnCode Profiler_DumpTrace(const String* path);
+#endif
@@ -6,36 +6,418 @@
 #include "Funcs.h"
 #include "Utils.h"
 #include "Launcher.h"
+#include "Benchmark.h"
 
 /*#define CC_TEST_VORBIS*/
 #ifdef CC_TEST_VORBIS
 #include "ExtMath.h"
 #include "Vorbis.h"
+#include "Stream.h"
+#include "Errors.h"
+/* Verifies imdct_calc against imdct_slow for every block size, then decodes all .ogg files */
+/* in the audio folder, logging how long decoding took and a checksum of the output samples. */
+/* NOTE: Checksums must not change when optimising the decoder. */
+static struct imdct_state imdctTest;
+static void VorbisBench_CheckIMDCT(int n) {
+	static float in[VORBIS_MAX_BLOCK_SIZE / 2], out[VORBIS_MAX_BLOCK_SIZE], ref[VORBIS_MAX_BLOCK_SIZE];
+	uint64_t beg, end;
+	float err, maxErr = 0.0f;
+	RNGState rng;
+	int i, us, iters = 1000;
 
-#define VORBIS_N 1024
-#define VORBIS_N2 (VORBIS_N / 2)
-int main_imdct() {
-	float in[VORBIS_N2], out[VORBIS_N], out2[VORBIS_N];
-	double delta[VORBIS_N];
-
-	RngState rng;
 	Random_Init(&rng, 2342334);
-	struct imdct_state imdct;
-	imdct_init(&imdct, VORBIS_N);
+	imdct_init(&imdctTest, n);
+	for (i = 0; i < n / 2; i++) { in[i] = Random_Float(&rng) - 0.5f; }
+
+	imdct_slow(in, ref, n / 2);
+	imdct_calc(in, out, &imdctTest);
+	for (i = 0; i < n; i++) {
+		err    = Math_AbsF(out[i] - ref[i]);
+		maxErr = max(maxErr, err);
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < iters; i++) { imdct_calc(in, out, &imdctTest); }
+	end = Stopwatch_Measure();
+
+	us = (int)(Stopwatch_ElapsedMicroseconds(beg, end) / iters);
+	Platform_Log3("imdct %i: max error %f7, %i us", &n, &maxErr, &us);
+}
+
+static void VorbisBench_Decode(const String* path, void* obj) {
+	static int16_t data[VORBIS_MAX_CHANS * VORBIS_MAX_BLOCK_SIZE];
+	uint8_t buffer[OGG_BUFFER_SIZE];
+	struct Stream stream, file;
+	struct VorbisState vorbis = { 0 };
+	uint32_t hash = 2166136261U;
+	uint64_t beg, end;
+	int i, count, samples = 0, ms;
+	ReturnCode res;
+
+	if (!String_CaselessEnds(path, (const String*)obj)) return;
+	if ((res = Stream_OpenFile(&file, path))) { Logger_Warn2(res, "opening", path); return; }
+
+	Ogg_MakeStream(&stream, buffer, &file);
+	vorbis.Source = &stream;
+	beg = Stopwatch_Measure();
+
+	if (!(res = Vorbis_DecodeHeaders(&vorbis))) {
+		while (!(res = Vorbis_DecodeFrame(&vorbis))) {
+			count = Vorbis_OutputFrame(&vorbis, data);
+			for (i = 0; i < count; i++) { hash = (hash ^ (uint16_t)data[i]) * 16777619U; }
+			samples += count;
+		}
+	}
+	end = Stopwatch_Measure();
+	if (res && res != ERR_END_OF_STREAM) Logger_Warn2(res, "decoding", path);
+
+	ms = (int)(Stopwatch_ElapsedMicroseconds(beg, end) / 1000);
+	Platform_Log3("%s: %i samples in %i ms", path, &samples, &ms);
+	Platform_Log1("  checksum: %h", &hash);
+
+	Vorbis_Free(&vorbis);
+	file.Close(&file);
+}
+
+static void main_vorbisbench(void) {
+	const static String path = String_FromConst("audio");
+	const static String ogg  = String_FromConst(".ogg");
+	int n;
+
+	for (n = 64; n <= VORBIS_MAX_BLOCK_SIZE; n *= 2) {
+		VorbisBench_CheckIMDCT(n);
+	}
+	Directory_Enum(&path, (void*)&ogg, VorbisBench_Decode);
+}
+#endif
+
+/*#define CC_TEST_GENERATOR*/
+#ifdef CC_TEST_GENERATOR
+#include "Generator.h"
+#include "World.h"
+/* Generates maps of several sizes and seeds without a window, logging how long each stage */
+/* (as recorded by the generator in Gen_StageTimes) took, and a checksum of the generated blocks. */
+/* NOTE: Checksums must not change when optimising the generator. (expected values are from */
+/*   the original single threaded generator, any mismatch means the generated map changed) */
+static void GenBench_Run(const char* name, Thread_StartFunc* gen, int width, int height, int length, int seed, uint32_t expected) {
+	uint64_t beg, end;
+	uint32_t hash = 2166136261U;
+	void* thread;
+	int i, ms;
+
+	World_SetDimensions(width, height, length);
+	Gen_Seed = seed;
+	Gen_Done = false;
+	Gen_CurrentState = "";
+	Platform_Log4("%c %ix%ix%i", name, &width, &height, &length);
+	Platform_Log1("  seed: %i", &seed);
+
+	beg    = Stopwatch_Measure();
+	thread = Thread_Start(gen, false);
+	Thread_Join(thread);
+
+	for (i = 0; i < Gen_NumStages; i++) {
+		ms = (int)(Stopwatch_ElapsedMicroseconds(Gen_StageTimes[i], Gen_StageTimes[i + 1]) / 1000);
+		Platform_Log2("  %c: %i ms", Gen_StageNames[i], &ms);
+	}
+
+	end = Gen_StageTimes[Gen_NumStages];
+	ms  = (int)(Stopwatch_ElapsedMicroseconds(beg, end) / 1000);
+	Platform_Log1("  total: %i ms", &ms);
+
+	for (i = 0; i < World.Volume; i++) {
+		hash = (hash ^ Gen_Blocks[i]) * 16777619U;
+	}
+
+	if (hash == expected) {
+		Platform_Log1("  checksum: %h (OK)", &hash);
+	} else {
+		Platform_Log2("  checksum: %h (MISMATCH, expected %h)", &hash, &expected);
+	}
+
+	Mem_Free(Gen_Blocks);
+	Gen_Blocks = NULL;
+	Gen_Done   = false;
+}
+
+static void main_genbench(void) {
+	const static int seeds[3] = { 1, 42, 1234567 };
+	/* Expected checksums of 128x64x128, 256x64x256 and 512x128x512 maps for each seed */
+	const static uint32_t notchySums[3][3] = {
+		{ 0x4864BD85, 0xE557A405, 0x258C496A },
+		{ 0x903CBD12, 0x029666E9, 0xF0BCF54F },
+		{ 0x28BF8BA5, 0xDADB161F, 0x51CE4F4B }
+	};
+	int i;
+	GenBench_Run("Flatgrass", FlatgrassGen_Generate, 256, 64, 256, 0, 0x39BF9DC5);
+
+	for (i = 0; i < Array_Elems(seeds); i++) {
+		GenBench_Run("Notchy", NotchyGen_Generate, 128,  64,  128, seeds[i], notchySums[i][0]);
+		GenBench_Run("Notchy", NotchyGen_Generate, 256,  64,  256, seeds[i], notchySums[i][1]);
+		GenBench_Run("Notchy", NotchyGen_Generate, 512,  128, 512, seeds[i], notchySums[i][2]);
+	}
+	GenBench_Run("Notchy", NotchyGen_Generate, 1024, 256, 1024, seeds[0], 0x32812576);
+}
+#endif
+
+/*#define CC_TEST_PHYSICS*/
+#ifdef CC_TEST_PHYSICS
+#include "Generator.h"
+#include "World.h"
+#include "Block.h"
+#include "BlockPhysics.h"
+#include "Lighting.h"
+#include "MapRenderer.h"
+#include "Event.h"
+#include "GameStructs.h"
+#include "Server.h"
+/* Generates a large map without a window, then floods it with water and lava from many */
+/* sources, logging how long physics ticks took and a checksum of the resulting blocks. */
+/* NOTE: CC_TEST_PHYSICS must be defined for the whole build, so physics uses a fixed seed. */
+static void PhysBench_Place(int x, int y, int z, BlockID block) {
+	BlockID old = World_GetBlock(x, y, z);
+	Game_UpdateBlock(x, y, z, block);
+	Physics_OnBlockChanged(x, y, z, old, block);
+}
+
+static void PhysBench_Run(int width, int height, int length, int ticks, uint32_t expected) {
+	uint64_t beg, end, tickBeg, maxTime = 0;
+	uint32_t hash = 2166136261U;
+	int i, x, z, ms, maxMs;
+
+	/* Free the previous run's map, and any state derived from it */
+	World_Reset();
+	Event_RaiseVoid(&WorldEvents.NewMap);
+	Lighting_Component.OnNewMap();
+	MapRenderer_Component.OnNewMap();
+
+	World_SetDimensions(width, height, length);
+	Gen_Seed = 1;
+	NotchyGen_Generate();
+	World_SetNewMap(Gen_Blocks, width, height, length);
+	Gen_Blocks = NULL;
+
+	Lighting_Component.OnNewMapLoaded();
+	MapRenderer_Component.OnNewMapLoaded();
+	Event_RaiseVoid(&WorldEvents.MapLoaded);
+	Platform_Log3("Flood %ix%ix%i", &width, &height, &length);
+
+	for (i = 0; i < 64; i++) {
+		x = (i * 37 + 5) % width; z = (i * 91 + 11) % length;
+		PhysBench_Place(x, height - 2, z, (i & 3) ? BLOCK_WATER : BLOCK_LAVA);
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < ticks; i++) {
+		tickBeg = Stopwatch_Measure();
+		Physics_Tick();
+		end = Stopwatch_Measure();
+		maxTime = max(maxTime, Stopwatch_ElapsedMicroseconds(tickBeg, end));
+	}
+
+	ms    = (int)(Stopwatch_ElapsedMicroseconds(beg, end) / 1000);
+	maxMs = (int)(maxTime / 1000);
+	Platform_Log2("  %i ticks: %i ms", &ticks, &ms);
+	Platform_Log1("  slowest tick: %i ms", &maxMs);
+
+	for (i = 0; i < World.Volume; i++) {
+		hash = (hash ^ World.Blocks[i]) * 16777619U;
+	}
+
+	if (hash == expected) {
+		Platform_Log1("  checksum: %h (OK)", &hash);
+	} else {
+		Platform_Log2("  checksum: %h (MISMATCH, expected %h)", &hash, &expected);
+	}
+}
 
-	for (int ii = 0; ii < VORBIS_N2; ii++) {
-		in[ii] = Random_Float(&rng);
+static void main_physbench(void) {
+	/* Random block ticks are only tracked in singleplayer */
+	Server.IsSinglePlayer = true;
+	Blocks_Component.Init();
+	Physics_Init();
+	/* Expected checksums are from before liquid ticks were scheduled on a timing wheel */
+	PhysBench_Run(512,  64,  512,  1500, 0x88F530C9);
+	PhysBench_Run(1024, 128, 1024, 1500, 0x1FBCF9B2);
+}
+#endif
+
+/*#define CC_TEST_ENTITIES*/
+#ifdef CC_TEST_ENTITIES
+#include "Entity.h"
+#include "Model.h"
+#include "Physics.h"
+#include "ExtMath.h"
+/* Places 255 entities around a large area, then checks that nearby and closest entity queries */
+/* using the entity grid give the same results as a linear scan, logging how long each took. */
+#define ENTBENCH_QUERIES 100000
+static struct Entity entBench_entities[ENTITIES_SELF_ID], entBench_self;
+static struct Model entBench_model;
+static float EntBench_GetEyeY(struct Entity* e) { return 26.0f / 16.0f; }
+
+/* Marks entities in the given list that are actually within radius on X/Z axes */
+static void EntBench_Filter(Vector3 pos, float radius, EntityID* ids, int count, bool* found) {
+	struct Entity* e;
+	int i;
+	Mem_Set(found, 0, ENTITIES_MAX_COUNT);
+
+	for (i = 0; i < count; i++) {
+		e = Entities.List[ids[i]];
+		if (Math_AbsF(e->Position.X - pos.X) > radius) continue;
+		if (Math_AbsF(e->Position.Z - pos.Z) > radius) continue;
+		found[ids[i]] = true;
 	}
+}
 
-	imdct_slow(in, out, VORBIS_N2);
-	imdct_calc(in, out2, &imdct);
+static int EntBench_LinearNearby(EntityID* ids) {
+	int i, count = 0;
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
+		if (Entities.List[i]) ids[count++] = (EntityID)i;
+	}
+	return count;
+}
+
+/* Same as Entities_GetCloset before the entity grid was added */
+static EntityID EntBench_LinearClosest(struct Entity* src) {
+	Vector3 eyePos = Entity_GetEyePosition(src);
+	Vector3 dir = Vector3_GetDirVector(src->HeadY * MATH_DEG2RAD, src->HeadX * MATH_DEG2RAD);
+	float closestDist = MATH_POS_INF;
+	EntityID targetId = ENTITIES_SELF_ID;
+	float t0, t1;
+	int i;
 
-	double sum = 0;
-	for (int ii = 0; ii < VORBIS_N; ii++) {
-		delta[ii] = out2[ii] - out[ii];
-		sum += delta[ii];
+	for (i = 0; i < ENTITIES_SELF_ID; i++) {
+		struct Entity* entity = Entities.List[i];
+		if (!entity) continue;
+
+		if (Intersection_RayIntersectsRotatedBox(eyePos, dir, entity, &t0, &t1) && t0 < closestDist) {
+			closestDist = t0;
+			targetId = (EntityID)i;
+		}
 	}
-	int fff = 0;
+	return targetId;
+}
+
+static void EntBench_Place(RNGState* rng) {
+	struct Entity* e;
+	float size;
+	int i;
+
+	Entities_ResetGrid();
+	for (i = 0; i < ENTITIES_SELF_ID; i++) {
+		e = &entBench_entities[i];
+		Entity_Init(e);
+		e->Model = &entBench_model;
+		e->Position = Vector3_Create3(Random_Float(rng) * 256.0f, Random_Float(rng) * 64.0f, Random_Float(rng) * 256.0f);
+		e->RotY     = Random_Float(rng) * 360.0f;
+
+		/* Some entities are large enough to be in the grid's list of large entities */
+		size = (i % 32) == 0 ? 12.0f : 0.6f;
+		e->Size = Vector3_Create3(size, 1.8f, size);
+		e->ModelAABB.Min = Vector3_Create3(-size / 2, 0.0f, -size / 2);
+		e->ModelAABB.Max = Vector3_Create3( size / 2, 1.8f,  size / 2);
+
+		Entities.List[i] = e;
+		Entities_UpdateGrid((EntityID)i);
+	}
+
+	Entity_Init(&entBench_self);
+	entBench_self.Model = &entBench_model;
+	Entities.List[ENTITIES_SELF_ID] = &entBench_self;
+	Entities_UpdateGrid(ENTITIES_SELF_ID);
+}
+
+static void EntBench_Nearby(RNGState* rng) {
+	static Vector3 pos[ENTBENCH_QUERIES];
+	EntityID ids[ENTITIES_MAX_COUNT];
+	bool gridFound[ENTITIES_MAX_COUNT], linearFound[ENTITIES_MAX_COUNT];
+	uint64_t beg, end;
+	int i, j, count, gridUs, linearUs, mismatches = 0, queries = ENTBENCH_QUERIES;
+
+	for (i = 0; i < queries; i++) {
+		pos[i] = Vector3_Create3(Random_Float(rng) * 256.0f, 0.0f, Random_Float(rng) * 256.0f);
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < queries; i++) {
+		count = Entities_QueryNearby(pos[i], 2.0f, ids);
+		EntBench_Filter(pos[i], 2.0f, ids, count, gridFound);
+	}
+	end = Stopwatch_Measure();
+	gridUs = (int)Stopwatch_ElapsedMicroseconds(beg, end);
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < queries; i++) {
+		count = EntBench_LinearNearby(ids);
+		EntBench_Filter(pos[i], 2.0f, ids, count, linearFound);
+	}
+	end = Stopwatch_Measure();
+	linearUs = (int)Stopwatch_ElapsedMicroseconds(beg, end);
+
+	for (i = 0; i < queries; i++) {
+		count = Entities_QueryNearby(pos[i], 2.0f, ids);
+		EntBench_Filter(pos[i], 2.0f, ids, count, gridFound);
+		count = EntBench_LinearNearby(ids);
+		EntBench_Filter(pos[i], 2.0f, ids, count, linearFound);
+		for (j = 0; j < ENTITIES_MAX_COUNT; j++) {
+			if (gridFound[j] != linearFound[j]) { mismatches++; break; }
+		}
+	}
+
+	Platform_Log3("Nearby: %i queries, grid %i us, linear %i us", &queries, &gridUs, &linearUs);
+	Platform_Log1("  mismatches: %i", &mismatches);
+}
+
+static void EntBench_Closest(RNGState* rng) {
+	static Vector3 pos[ENTBENCH_QUERIES];
+	static float headX[ENTBENCH_QUERIES], headY[ENTBENCH_QUERIES];
+	struct Entity* self = &entBench_self;
+	uint64_t beg, end;
+	int i, hits = 0, gridUs, linearUs, mismatches = 0, queries = ENTBENCH_QUERIES;
+	EntityID id;
+
+	for (i = 0; i < queries; i++) {
+		pos[i]   = Vector3_Create3(Random_Float(rng) * 256.0f, Random_Float(rng) * 64.0f, Random_Float(rng) * 256.0f);
+		headX[i] = Random_Float(rng) * 180.0f - 90.0f;
+		headY[i] = Random_Float(rng) * 360.0f;
+	}
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < queries; i++) {
+		self->Position = pos[i]; self->HeadX = headX[i]; self->HeadY = headY[i];
+		Entities_GetCloset(self);
+	}
+	end = Stopwatch_Measure();
+	gridUs = (int)Stopwatch_ElapsedMicroseconds(beg, end);
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < queries; i++) {
+		self->Position = pos[i]; self->HeadX = headX[i]; self->HeadY = headY[i];
+		EntBench_LinearClosest(self);
+	}
+	end = Stopwatch_Measure();
+	linearUs = (int)Stopwatch_ElapsedMicroseconds(beg, end);
+
+	for (i = 0; i < queries; i++) {
+		self->Position = pos[i]; self->HeadX = headX[i]; self->HeadY = headY[i];
+		id = Entities_GetCloset(self);
+
+		if (id != ENTITIES_SELF_ID) hits++;
+		if (id != EntBench_LinearClosest(self)) mismatches++;
+	}
+
+	Platform_Log3("Closest: %i queries, grid %i us, linear %i us", &queries, &gridUs, &linearUs);
+	Platform_Log2("  hits: %i, mismatches: %i", &hits, &mismatches);
+}
+
+static void main_entitybench(void) {
+	RNGState rng;
+	Random_Init(&rng, 1234);
+	entBench_model.GetEyeY = EntBench_GetEyeY;
+
+	EntBench_Place(&rng);
+	EntBench_Nearby(&rng);
+	EntBench_Closest(&rng);
 }
 #endif
 
@@ -122,7 +504,20 @@ int main(int argc, char** argv) {
 	Window_Init();
 	Program_SetCurrentDirectory();
 #ifdef CC_TEST_VORBIS
-	main_imdct();
+	main_vorbisbench();
+	Process_Exit(0);
+#endif
+#ifdef CC_TEST_GENERATOR
+	main_genbench();
+	Process_Exit(0);
+#endif
+#ifdef CC_TEST_PHYSICS
+	main_physbench();
+	Process_Exit(0);
+#endif
+#ifdef CC_TEST_ENTITIES
+	main_entitybench();
+	Process_Exit(0);
 #endif
 	Platform_LogConst("Starting " GAME_APP_NAME " ..");
 
@@ -148,6 +543,12 @@ int main(int argc, char** argv) {
 	} else if (argsCount == 1) {
 		String_Copy(&Game_Username, &args[0]);
 		Program_RunGame();
+	} else if (argsCount == 3 && String_CaselessEqualsConst(&args[0], "--benchmark")) {
+		/* --benchmark [map path] [camera path file] */
+		/* NOTE: Singleplayer loads the map when username is a path (e.g. maps/test.cw) */
+		String_Copy(&Game_Username, &args[1]);
+		Benchmark_Init(&args[2]);
+		Program_RunGame();
 	} else if (argsCount < 4) {
 		Exit_MissingArgs(argsCount, args);
 		return 1;
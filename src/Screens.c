@@ -1115,6 +1115,7 @@ static void ChatScreen_Init(void* screen) {
 static void ChatScreen_Render(void* screen, double delta) {
 	struct ChatScreen* s = screen;
 	struct Texture tex;
+	uint32_t hidden = 0;
 	TimeMS now;
 	int i, y, logIdx;
 
@@ -1133,20 +1134,18 @@ static void ChatScreen_Render(void* screen, double delta) {
 	}
 
 	now = DateTime_CurrentUTC_MS();
-	if (s->HandlesAllInput) {
-		Elem_Render(&s->Chat, delta);
-	} else {
+	if (!s->HandlesAllInput) {
 		/* Only render recent chat */
 		for (i = 0; i < s->Chat.LinesCount; i++) {
-			tex    = s->Chat.Textures[i];
 			logIdx = s->ChatIndex + i;
-			if (!tex.ID) continue;
-
-			if (logIdx < 0 || logIdx >= Chat_Log.Count) continue;
-			if (Chat_GetLogTime(logIdx) + (10 * 1000) >= now) Texture_Render(&tex);
+			if (logIdx >= 0 && logIdx < Chat_Log.Count && Chat_GetLogTime(logIdx) + (10 * 1000) >= now) continue;
+			hidden |= 1u << i;
 		}
 	}
 
+	TextGroupWidget_SetHiddenLines(&s->Chat, hidden);
+	Elem_Render(&s->Chat, delta);
+
 	Elem_Render(&s->Announcement, delta);
 	if (s->HandlesAllInput) {
 		Elem_Render(&s->Input.Base, delta);
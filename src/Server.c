@@ -22,6 +22,7 @@
 #include "Inventory.h"
 #include "Platform.h"
 #include "GameStructs.h"
+#include "Profiler.h"
 
 static char server_nameBuffer[STRING_SIZE];
 static char server_motdBuffer[STRING_SIZE];
@@ -389,7 +390,7 @@ static void MPConnection_CheckDisconnection(double delta) {
 	}
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
+static void MPConnection_DoTick(struct ScheduledTask* task) {
 	const static String title_lost  = String_FromConst("&eLost connection to the server");
 	const static String reason_err  = String_FromConst("I/O error when reading packets");
 	const static String title_disc  = String_FromConst("Disconnected");
@@ -486,6 +487,13 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	server_ticks++;
 }
 
+/* Early returns make it simpler to time the whole tick here */
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	Profiler_Begin("Network");
+	MPConnection_DoTick(task);
+	Profiler_End();
+}
+
 void Net_SendPacket(void) {
 	uint32_t left, wrote;
 	uint8_t* cur;
@@ -145,6 +145,70 @@ static void WaterAnimation_Tick(BitmapCol* ptr, int size) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------Liquid animation cache--------------------------------------------------*
+*#########################################################################################################################*/
+/* Simulating lava/water every tick is slow for large tiles, so frames are instead simulated once and then looped. */
+/* Frames simulated after the end of the loop are blended into the first frames, so looping around isn't noticeable. */
+#define LIQUID_CACHE_FRAMES 128
+#define LIQUID_CACHE_BLEND  32
+#define LIQUID_CACHE_WARMUP 200
+typedef void (*LiquidAnim_TickFunc)(BitmapCol* ptr, int size);
+
+static struct LiquidCache {
+	uint8_t* Frames; /* LIQUID_CACHE_FRAMES frames of Size x Size pixels */
+	int Size, Frame;
+} lava_cache, water_cache;
+
+static void LiquidCache_Make(struct LiquidCache* cache, LiquidAnim_TickFunc tick, int size) {
+	uint32_t frameSize = Bitmap_DataSize(size, size);
+	uint8_t* extra;
+	uint8_t* dst;
+	uint32_t j;
+	int i, t;
+
+	Mem_Free(cache->Frames);
+	cache->Frames = (uint8_t*)Mem_Alloc(LIQUID_CACHE_FRAMES, frameSize, "liquid frames");
+	cache->Size   = size;
+	cache->Frame  = 0;
+	extra = (uint8_t*)Mem_Alloc(1, frameSize, "liquid frame");
+
+	/* Simulation starts with no heat, so needs to run for a while before it looks right */
+	for (i = 0; i < LIQUID_CACHE_WARMUP; i++) {
+		tick((BitmapCol*)extra, size);
+	}
+	for (i = 0; i < LIQUID_CACHE_FRAMES; i++) {
+		tick((BitmapCol*)(cache->Frames + i * frameSize), size);
+	}
+
+	for (i = 0; i < LIQUID_CACHE_BLEND; i++) {
+		tick((BitmapCol*)extra, size);
+		dst = cache->Frames + i * frameSize;
+		t   = (i + 1) * 256 / (LIQUID_CACHE_BLEND + 1);
+
+		for (j = 0; j < frameSize; j++) {
+			dst[j] = (uint8_t)(extra[j] + (dst[j] - extra[j]) * t / 256);
+		}
+	}
+	Mem_Free(extra);
+}
+
+/* Returns the next frame in the looping animation, simulating all the frames first if needed */
+static void LiquidCache_Next(struct LiquidCache* cache, LiquidAnim_TickFunc tick, int size, Bitmap* frame) {
+	if (!cache->Frames || cache->Size != size) LiquidCache_Make(cache, tick, size);
+
+	frame->Width = size; frame->Height = size;
+	frame->Scan0 = cache->Frames + cache->Frame * Bitmap_DataSize(size, size);
+	cache->Frame = (cache->Frame + 1) % LIQUID_CACHE_FRAMES;
+}
+
+static void LiquidCache_Free(struct LiquidCache* cache) {
+	Mem_Free(cache->Frames);
+	cache->Frames = NULL;
+	cache->Size   = 0;
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Animations--------------------------------------------------------*
 *#########################################################################################################################*/
@@ -157,6 +221,11 @@ struct AnimationData {
 	int16_t  Tick, TickDelay;
 };
 
+/* Animation frames are written into the CPU copy of the 1D atlases, then all uploaded at the end of the tick */
+static void Atlas1D_CopyTile(TextureLoc texLoc, Bitmap* src, int srcX, int srcY, int size);
+static void Atlas1D_FlushTiles(void);
+static void Atlas1D_FreeCopy(void);
+
 static Bitmap anims_bmp;
 static struct AnimationData anims_list[ATLAS1D_MAX_ATLASES];
 static int anims_count;
@@ -220,36 +289,19 @@ static void Animations_ReadDescription(struct Stream* stream, const String* path
 	}
 }
 
-#define ANIMS_FAST_SIZE 64
 static void Animations_Draw(struct AnimationData* data, TextureLoc texLoc, int size) {
-	int dstX = Atlas1D_Index(texLoc), srcX;
-	int dstY = Atlas1D_RowId(texLoc) * Atlas_TileSize;
-	GfxResourceID tex;
-
-	uint8_t buffer[Bitmap_DataSize(ANIMS_FAST_SIZE, ANIMS_FAST_SIZE)];
-	uint8_t* ptr = buffer;
 	Bitmap frame;
 
-	/* cannot allocate memory on the stack for very big animation.png frames */
-	if (size > ANIMS_FAST_SIZE) {	
-		ptr = Mem_Alloc(size * size, 4, "anim frame");
-	}
-	Bitmap_Init(frame, size, size, ptr);
-
 	if (!data) {
 		if (texLoc == 30) {
-			LavaAnimation_Tick((BitmapCol*)frame.Scan0, size);
-		} else if (texLoc == 14) {
-			WaterAnimation_Tick((BitmapCol*)frame.Scan0, size);
+			LiquidCache_Next(&lava_cache,  LavaAnimation_Tick,  size, &frame);
+		} else {
+			LiquidCache_Next(&water_cache, WaterAnimation_Tick, size, &frame);
 		}
+		Atlas1D_CopyTile(texLoc, &frame, 0, 0, size);
 	} else {
-		srcX = data->FrameX + data->State * size;
-		Bitmap_CopyBlock(srcX, data->FrameY, 0, 0, &anims_bmp, &frame, size);
+		Atlas1D_CopyTile(texLoc, &anims_bmp, data->FrameX + data->State * size, data->FrameY, size);
 	}
-
-	tex = Atlas1D_TexIds[dstX];
-	if (tex) { Gfx_UpdateTexturePart(tex, 0, dstY, &frame, Gfx.Mipmaps); }
-	if (size > ANIMS_FAST_SIZE) Mem_Free(ptr);
 }
 
 static void Animations_Apply(struct AnimationData* data) {
@@ -276,6 +328,11 @@ static bool Animations_IsDefaultZip(void) {
 	return !optExists || String_CaselessEqualsConst(&texPack, "default.zip");
 }
 
+/* Whether any tiles of the terrain atlas are currently animated */
+static bool Animations_Active(void) {
+	return anims_useLavaAnim || anims_useWaterAnim || anims_count;
+}
+
 static void Animations_Clear(void) {
 	Mem_Free(anims_bmp.Scan0);
 	anims_count = 0;
@@ -313,19 +370,8 @@ static void Animations_Validate(void) {
 	}
 }
 
-static void Animations_Tick(struct ScheduledTask* task) {
-	int i, size;
-
-	if (anims_useLavaAnim) {
-		size = min(Atlas_TileSize, 64);
-		Animations_Draw(NULL, 30, size);
-	}
-	if (anims_useWaterAnim) {
-		size = min(Atlas_TileSize, 64);
-		Animations_Draw(NULL, 14, size);
-	}
-
-	if (!anims_count) return;
+static void Animations_ApplyAll(void) {
+	int i;
 	if (!anims_bmp.Scan0) {
 		Chat_AddRaw("&cCurrent texture pack specifies it uses animations,");
 		Chat_AddRaw("&cbut is missing animations.png");
@@ -339,6 +385,24 @@ static void Animations_Tick(struct ScheduledTask* task) {
 	}
 }
 
+static void Animations_Tick(struct ScheduledTask* task) {
+	int size;
+	/* The CPU copy of the atlas is only needed while tiles are animated */
+	if (!Animations_Active()) { Atlas1D_FreeCopy(); return; }
+
+	if (anims_useLavaAnim) {
+		size = min(Atlas_TileSize, 64);
+		Animations_Draw(NULL, 30, size);
+	}
+	if (anims_useWaterAnim) {
+		size = min(Atlas_TileSize, 64);
+		Animations_Draw(NULL, 14, size);
+	}
+
+	if (anims_count) Animations_ApplyAll();
+	Atlas1D_FlushTiles();
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------Animations component---------------------------------------------------*
@@ -375,6 +439,8 @@ static void Animations_Init(void) {
 
 static void Animations_Free(void) {
 	Animations_Clear();
+	LiquidCache_Free(&lava_cache);
+	LiquidCache_Free(&water_cache);
 	Event_UnregisterVoid(&TextureEvents.PackChanged,  NULL, Animations_PackChanged);
 	Event_UnregisterEntry(&TextureEvents.FileChanged, NULL, Animations_FileChanged);
 }
@@ -391,6 +457,7 @@ struct IGameComponent Animations_Component = {
 Bitmap Atlas_Bitmap;
 int Atlas_TileSize, Atlas_RowsCount;
 int Atlas1D_Count, Atlas1D_TilesPerAtlas;
+bool Atlas1D_Layered;
 int Atlas1D_Mask, Atlas1D_Shift;
 float Atlas1D_InvTileSize;
 GfxResourceID Atlas1D_TexIds[ATLAS1D_MAX_ATLASES];
@@ -408,28 +475,196 @@ TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index) {
 	return rec;
 }
 
+/* Mipmaps for each 1D atlas are generated by the main thread and a few worker threads, */
+/* then all uploaded at once afterwards. (graphics API can only be called from main thread) */
+/* When layered, each job instead generates mipmaps for a range of layers. */
+#ifdef CC_BUILD_WEB
+#define ATLAS_MIPMAPS_THREADS 1
+#else
+#define ATLAS_MIPMAPS_THREADS 4
+#endif
+#define ATLAS_LAYERS_PER_JOB 32
+/* CPU copy of all the 1D atlases, only kept around while animations are updating tiles in it */
+static Bitmap atlas1D_all;
+static uint8_t* atlas1D_mipmaps;
+static void* atlas1D_mutex;
+static volatile int atlas1D_next;
+static int atlas1D_jobs;
+
+/* Gets the i'th 1D atlas, which is a slice of the combined bitmap of all 1D atlases. */
+static void Atlas1D_Get(int i, Bitmap* bmp) {
+	int height = Atlas1D_TilesPerAtlas * Atlas_TileSize;
+	uint8_t* scan0 = atlas1D_all.Scan0 + i * Bitmap_DataSize(Atlas_TileSize, height);
+	bmp->Width = Atlas_TileSize; bmp->Height = height; bmp->Scan0 = scan0;
+}
+
+static uint8_t* Atlas1D_GetMipmaps(int i) {
+	int height = Atlas1D_TilesPerAtlas * Atlas_TileSize;
+	return atlas1D_mipmaps + i * Gfx_MipmapsSize(Atlas_TileSize, height);
+}
+
+static void Atlas1D_MipmapsWorker(void) {
+	Bitmap atlas1D;
+	int layersBeg, layersEnd;
+	int i;
+	for (;;) {
+		Mutex_Lock(atlas1D_mutex);
+		{
+			i = atlas1D_next++;
+		}
+		Mutex_Unlock(atlas1D_mutex);
+
+		if (i >= atlas1D_jobs) return;
+
+		if (Atlas1D_Layered) {
+			Atlas1D_Get(0, &atlas1D);
+			layersBeg = i * ATLAS_LAYERS_PER_JOB;
+			layersEnd = min(layersBeg + ATLAS_LAYERS_PER_JOB, Atlas1D_TilesPerAtlas);
+			Gfx_GenMipmapLayers(&atlas1D, Atlas1D_TilesPerAtlas, layersBeg, layersEnd, atlas1D_mipmaps);
+		} else {
+			Atlas1D_Get(i, &atlas1D);
+			Gfx_GenMipmapChain(&atlas1D, Atlas1D_GetMipmaps(i));
+		}
+	}
+}
+
+static void Atlas1D_GenMipmaps(void) {
+	void* threads[ATLAS_MIPMAPS_THREADS];
+	int i, count, height = Atlas1D_TilesPerAtlas * Atlas_TileSize;
+
+	atlas1D_jobs = Atlas1D_Layered ? Math_CeilDiv(Atlas1D_TilesPerAtlas, ATLAS_LAYERS_PER_JOB) : Atlas1D_Count;
+	count        = min(ATLAS_MIPMAPS_THREADS, atlas1D_jobs);
+
+	atlas1D_mipmaps = (uint8_t*)Mem_Alloc(Atlas1D_Count, Gfx_MipmapsSize(Atlas_TileSize, height), "atlas mipmaps");
+	atlas1D_next    = 0;
+	atlas1D_mutex   = Mutex_Create();
+
+	for (i = 1; i < count; i++) {
+		threads[i] = Thread_Start(Atlas1D_MipmapsWorker, false);
+	}
+	Atlas1D_MipmapsWorker();
+	for (i = 1; i < count; i++) {
+		Thread_Join(threads[i]);
+	}
+
+	Mutex_Free(atlas1D_mutex);
+	atlas1D_mutex = NULL;
+}
+
+/* Allocates atlas1D_all, then copies all the tiles of the 2D atlas into it */
+static void Atlas1D_MakeCopy(void) {
+	int tileSize = Atlas_TileSize;
+	int tiles    = Atlas1D_Count * Atlas1D_TilesPerAtlas;
+	int height   = tiles * tileSize;
+	int atlasX, atlasY, tile;
+
+	Bitmap_Init(atlas1D_all, tileSize, height, (uint8_t*)Mem_AllocCleared(tileSize * height, 4, "atlas 1D"));
+	for (tile = 0; tile < tiles; tile++) {
+		/* Last 1D atlas may have more space than there are tiles left */
+		if (Atlas2D_TileY(tile) >= Atlas_RowsCount) break;
+		atlasX = Atlas2D_TileX(tile) * tileSize;
+		atlasY = Atlas2D_TileY(tile) * tileSize;
+
+		Bitmap_CopyBlock(atlasX, atlasY, 0, tile * tileSize,
+						&Atlas_Bitmap, &atlas1D_all, tileSize);
+	}
+}
+
+static void Atlas1D_FreeCopy(void) {
+	Mem_Free(atlas1D_all.Scan0);
+	atlas1D_all.Scan0 = NULL;
+}
+
 static void Atlas_Convert2DTo1D(void) {
-	int tileSize      = Atlas_TileSize;
 	int tilesPerAtlas = Atlas1D_TilesPerAtlas;
 	int atlasesCount  = Atlas1D_Count;
 	Bitmap atlas1D;
-	int atlasX, atlasY;
-	int tile = 0, i, y;
+	int i;
+
+	if (Atlas1D_Layered) {
+		Platform_Log1("Loaded new atlas: %i layers", &tilesPerAtlas);
+	} else {
+		Platform_Log2("Loaded new atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
+	}
+	Atlas1D_FreeCopy();
+	Atlas1D_MakeCopy();
+	if (Gfx.Mipmaps) Atlas1D_GenMipmaps();
 
-	Platform_Log2("Loaded new atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
-	Bitmap_Allocate(&atlas1D, tileSize, tilesPerAtlas * tileSize);
-	
 	for (i = 0; i < atlasesCount; i++) {
-		for (y = 0; y < tilesPerAtlas; y++, tile++) {
-			atlasX = Atlas2D_TileX(tile) * tileSize;
-			atlasY = Atlas2D_TileY(tile) * tileSize;
+		Atlas1D_Get(i, &atlas1D);
+		if (Atlas1D_Layered) {
+			Atlas1D_TexIds[i] = Gfx_CreateTextureArray(&atlas1D, tilesPerAtlas,
+									Gfx.Mipmaps ? atlas1D_mipmaps : NULL);
+		} else {
+			Atlas1D_TexIds[i] = Gfx_CreateTextureMips(&atlas1D, true,
+									Gfx.Mipmaps ? Atlas1D_GetMipmaps(i) : NULL);
+		}
+	}
+
+	Mem_Free(atlas1D_mipmaps);
+	atlas1D_mipmaps = NULL;
+	/* Recreated by Atlas1D_CopyTile if animations are only registered afterwards */
+	if (!Animations_Active()) Atlas1D_FreeCopy();
+}
+
+/* Tiles of atlas1D_all changed since they were last uploaded */
+static bool atlas1D_dirty[ATLAS1D_MAX_ATLASES];
+static bool atlas1D_anyDirty;
+
+static void Atlas1D_CopyTile(TextureLoc texLoc, Bitmap* src, int srcX, int srcY, int size) {
+	if (!Atlas_Bitmap.Scan0 || texLoc >= Atlas_RowsCount * ATLAS2D_TILES_PER_ROW) return;
+	if (!atlas1D_all.Scan0) Atlas1D_MakeCopy();
+
+	Bitmap_CopyBlock(srcX, srcY, 0, texLoc * Atlas_TileSize, src, &atlas1D_all, size);
+	atlas1D_dirty[texLoc] = true;
+	atlas1D_anyDirty      = true;
+}
+
+/* Uploads tiles beg to end (exclusive) of atlas1D_all, which must all be in the same 1D atlas */
+static void Atlas1D_UploadTiles(int beg, int end) {
+	GfxResourceID tex = Atlas1D_TexIds[Atlas1D_Index(beg)];
+	int tileSize = Atlas_TileSize;
+	Bitmap part;
 
-			Bitmap_CopyBlock(atlasX, atlasY, 0, y * tileSize,
-							&Atlas_Bitmap, &atlas1D, tileSize);
+	if (!tex) return;
+	Bitmap_Init(part, tileSize, (end - beg) * tileSize, atlas1D_all.Scan0 + beg * Bitmap_DataSize(tileSize, tileSize));
+	Gfx_UpdateTexturePart(tex, 0, Atlas1D_RowId(beg) * tileSize, &part, Gfx.Mipmaps);
+}
+
+static void Atlas1D_FlushTiles(void) {
+	int maxTiles = Atlas_RowsCount * ATLAS2D_TILES_PER_ROW;
+	int i, tile, atlasBeg, atlasEnd;
+	int beg, end, runEnd, dirty;
+	if (!atlas1D_anyDirty) return;
+
+	for (i = 0; i < Atlas1D_Count; i++) {
+		atlasBeg = i * Atlas1D_TilesPerAtlas;
+		atlasEnd = min(atlasBeg + Atlas1D_TilesPerAtlas, maxTiles);
+		beg = 0; end = 0; dirty = 0;
+
+		for (tile = atlasBeg; tile < atlasEnd; tile++) {
+			if (!atlas1D_dirty[tile]) continue;
+			if (!dirty) beg = tile;
+			end = tile + 1; dirty++;
+		}
+		if (!dirty) continue;
+
+		/* One upload for all changed tiles is cheapest, unless mostly unchanged tiles are in between */
+		if (end - beg <= dirty * 2) {
+			Atlas1D_UploadTiles(beg, end); continue;
+		}
+
+		/* Otherwise upload each run of consecutive changed tiles separately */
+		for (tile = beg; tile < end; tile = runEnd) {
+			if (!atlas1D_dirty[tile]) { runEnd = tile + 1; continue; }
+
+			for (runEnd = tile; runEnd < end && atlas1D_dirty[runEnd]; runEnd++) { }
+			Atlas1D_UploadTiles(tile, runEnd);
 		}
-		Atlas1D_TexIds[i] = Gfx_CreateTexture(&atlas1D, true, Gfx.Mipmaps);
 	}
-	Mem_Free(atlas1D.Scan0);
+
+	Mem_Set(atlas1D_dirty, 0, sizeof(atlas1D_dirty));
+	atlas1D_anyDirty = false;
 }
 
 static void Atlas_Update1D(void) {
@@ -439,10 +674,18 @@ static void Atlas_Update1D(void) {
 	maxTilesPerAtlas = maxAtlasHeight / Atlas_TileSize;
 	maxTiles         = Atlas_RowsCount * ATLAS2D_TILES_PER_ROW;
 
-	Atlas1D_TilesPerAtlas = min(maxTilesPerAtlas, maxTiles);
-	Atlas1D_Count = Math_CeilDiv(maxTiles, Atlas1D_TilesPerAtlas);
-
-	Atlas1D_InvTileSize = 1.0f / Atlas1D_TilesPerAtlas;
+	/* Each tile is a separate layer, so all the tiles fit in just one texture array */
+	/* NOTE: Layers count is a power of two, so that Atlas1D_Mask/Atlas1D_Shift still work */
+	Atlas1D_Layered = Math_NextPowOf2(maxTiles) <= Gfx.MaxTexLayers;
+	if (Atlas1D_Layered) {
+		Atlas1D_TilesPerAtlas = Math_NextPowOf2(maxTiles);
+		Atlas1D_Count         = 1;
+		Atlas1D_InvTileSize   = 1.0f;
+	} else {
+		Atlas1D_TilesPerAtlas = min(maxTilesPerAtlas, maxTiles);
+		Atlas1D_Count         = Math_CeilDiv(maxTiles, Atlas1D_TilesPerAtlas);
+		Atlas1D_InvTileSize   = 1.0f / Atlas1D_TilesPerAtlas;
+	}
 	Atlas1D_Mask  = Atlas1D_TilesPerAtlas - 1;
 	Atlas1D_Shift = Math_Log2(Atlas1D_TilesPerAtlas);
 }
@@ -488,6 +731,7 @@ void Atlas_Free(void) {
 	int i;
 	Mem_Free(Atlas_Bitmap.Scan0);
 	Atlas_Bitmap.Scan0 = NULL;
+	Atlas1D_FreeCopy();
 
 	for (i = 0; i < Atlas1D_Count; i++) {
 		Gfx_DeleteTexture(&Atlas1D_TexIds[i]);
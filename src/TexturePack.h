@@ -35,12 +35,15 @@ extern int Atlas_TileSize;
 /* Number of rows in the atlas. (default 16, can be 32) */
 extern int Atlas_RowsCount;
 /* Number of 1D atlases the atlas was split into. */
+/* NOTE: Always 1 when Atlas1D_Layered, as all tiles are then in the same texture array. */
 extern int Atlas1D_Count;
+/* Whether the 1D atlas is a texture array, with each tile being a separate layer. */
+extern bool Atlas1D_Layered;
 /* Number of tiles in each 1D atlas. */
 extern int Atlas1D_TilesPerAtlas;
 /* Converts a tile id into 1D atlas index, and index within that atlas. */
 extern int Atlas1D_Mask, Atlas1D_Shift;
-/* Texture V coord that equals the size of one tile. (i.e. 1/Atlas1D_TilesPerAtlas) */
+/* Texture V coord that equals the size of one tile. (i.e. 1/Atlas1D_TilesPerAtlas, or 1 when layered) */
 /* NOTE: The texture U coord that equals the size of one tile is 1. */
 extern float Atlas1D_InvTileSize;
 /* Textures for each 1D atlas. Only Atlas1D_Count of these are valid. */
@@ -959,9 +959,10 @@ void imdct_calc(float* in, float* out, struct imdct_state* state) {
 	/* Uses a few fixes for the paper noted at http://www.nothings.org/stb_vorbis/mdct_01.txt */
 	float *A = state->A, *B = state->B, *C = state->C;
 
-	float u[VORBIS_MAX_BLOCK_SIZE];
+	/* step 3 only ever reads and writes the same 4 elements at once, so can be done in-place */
 	float w[VORBIS_MAX_BLOCK_SIZE];
 	float e_1, e_2, f_1, f_2;
+	float a_1, a_2;
 	float g_1, g_2, h_1, h_2;
 	float x_1, x_2, y_1, y_2;
 
@@ -987,24 +988,24 @@ void imdct_calc(float* in, float* out, struct imdct_state* state) {
 	for (l = 0; l <= log2_n - 4; l++) {
 		int k0 = n >> (l+2), k1 = 1 << (l+3);
 		int r, r4, rMax = n >> (l+4), s2, s2Max = 1 << (l+2);
+		float *e, *f;
 
 		for (r = 0, r4 = 0; r < rMax; r++, r4 += 4) {
-			for (s2 = 0; s2 < s2Max; s2 += 2) {
-				e_1 = w[n-1-k0*s2-r4];     e_2 = w[n-3-k0*s2-r4];
-				f_1 = w[n-1-k0*(s2+1)-r4]; f_2 = w[n-3-k0*(s2+1)-r4];
+			/* twiddle factor only depends on r */
+			a_1 = A[r*k1]; a_2 = A[r*k1+1];
+			e   = &w[n-1-r4];
+			f   = &w[n-1-k0-r4];
 
-				u[n-1-k0*s2-r4] = e_1 + f_1;
-				u[n-3-k0*s2-r4] = e_2 + f_2;
+			for (s2 = 0; s2 < s2Max; s2 += 2, e -= 2*k0, f -= 2*k0) {
+				e_1 = e[0]; e_2 = e[-2];
+				f_1 = f[0]; f_2 = f[-2];
 
-				u[n-1-k0*(s2+1)-r4] = (e_1 - f_1) * A[r*k1] - (e_2 - f_2) * A[r*k1+1];
-				u[n-3-k0*(s2+1)-r4] = (e_2 - f_2) * A[r*k1] + (e_1 - f_1) * A[r*k1+1];
-			}
-		}
+				e[0]  = e_1 + f_1;
+				e[-2] = e_2 + f_2;
 
-		/* TODO: eliminate this, do w/u in-place */
-		/* TODO: dynamically allocate mem for imdct */
-		if (l+1 <= log2_n - 4) {
-			Mem_Copy(w, u, sizeof(u));
+				f[0]  = (e_1 - f_1) * a_1 - (e_2 - f_2) * a_2;
+				f[-2] = (e_2 - f_2) * a_1 + (e_1 - f_1) * a_2;
+			}
 		}
 	}
 
@@ -1012,8 +1013,8 @@ void imdct_calc(float* in, float* out, struct imdct_state* state) {
 	reversed = state->Reversed;
 	for (k = 0, k2 = 0, k8 = 0; k < n8; k++, k2 += 2, k8 += 8) {
 		uint32_t j = reversed[k], j8 = j << 3;
-		e_1 = u[n-j8-1]; e_2 = u[n-j8-3];
-		f_1 = u[j8+3];   f_2 = u[j8+1];
+		e_1 = w[n-j8-1]; e_2 = w[n-j8-3];
+		f_1 = w[j8+3];   f_2 = w[j8+1];
 
 		g_1 =  e_1 + f_1 + C[k2+1] * (e_1 - f_1) + C[k2] * (e_2 + f_2);
 		h_1 =  e_1 + f_1 - C[k2+1] * (e_1 - f_1) - C[k2] * (e_2 + f_2);
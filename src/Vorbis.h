@@ -20,6 +20,12 @@ struct imdct_state {
 	float C[VORBIS_MAX_BLOCK_SIZE / 4];
 	uint32_t Reversed[VORBIS_MAX_BLOCK_SIZE / 8];
 };
+/* Precomputes twiddle factors for an inverse MDCT of n outputs. */
+void imdct_init(struct imdct_state* state, int n);
+/* Fast inverse MDCT of state->n/2 coefficients into state->n outputs. (in and out can be the same) */
+void imdct_calc(float* in, float* out, struct imdct_state* state);
+/* Reference O(N^2) inverse MDCT of N coefficients into 2N outputs, used to verify imdct_calc. */
+void imdct_slow(float* in, float* out, int N);
 
 struct VorbisWindow { float* Prev; float* Cur; };
 struct VorbisState {
@@ -39,7 +39,7 @@ static void TextWidget_Render(void* widget, double delta) {
 
 static void TextWidget_Free(void* widget) {
 	struct TextWidget* w = widget;
-	Gfx_DeleteTexture(&w->Texture.ID);
+	TextCache_Release(&w->Texture.ID);
 }
 
 static void TextWidget_Reposition(void* widget) {
@@ -71,14 +71,14 @@ void TextWidget_Create(struct TextWidget* w, const String* text, const FontDesc*
 
 void TextWidget_Set(struct TextWidget* w, const String* text, const FontDesc* font) {
 	struct DrawTextArgs args;
-	Gfx_DeleteTexture(&w->Texture.ID);
+	TextCache_Release(&w->Texture.ID);
 
 	if (Drawer2D_IsEmptyText(text)) {
 		w->Texture.Width  = 0; 
 		w->Texture.Height = Drawer2D_FontHeight(font, true);
 	} else {	
 		DrawTextArgs_Make(&args, text, font, true);
-		Drawer2D_MakeTextTexture(&w->Texture, &args, 0, 0);
+		Drawer2D_MakeCachedTextTexture(&w->Texture, &args, 0, 0);
 	}
 
 	if (w->ReducePadding) {
@@ -103,7 +103,7 @@ static struct Texture Button_DisabledTex = { GFX_NULL, Tex_Rect(0,0, 0,0), Widge
 
 static void ButtonWidget_Free(void* widget) {
 	struct ButtonWidget* w = widget;
-	Gfx_DeleteTexture(&w->Texture.ID);
+	TextCache_Release(&w->Texture.ID);
 }
 
 static void ButtonWidget_Reposition(void* widget) {
@@ -170,14 +170,14 @@ void ButtonWidget_Create(struct ButtonWidget* w, int minWidth, const String* tex
 
 void ButtonWidget_Set(struct ButtonWidget* w, const String* text, const FontDesc* font) {
 	struct DrawTextArgs args;
-	Gfx_DeleteTexture(&w->Texture.ID);
+	TextCache_Release(&w->Texture.ID);
 
 	if (Drawer2D_IsEmptyText(text)) {
 		w->Texture.Width  = 0;
 		w->Texture.Height = Drawer2D_FontHeight(font, true);
 	} else {
 		DrawTextArgs_Make(&args, text, font, true);
-		Drawer2D_MakeTextTexture(&w->Texture, &args, 0, 0);
+		Drawer2D_MakeCachedTextTexture(&w->Texture, &args, 0, 0);
 	}
 
 	w->Width  = max(w->Texture.Width,  w->MinWidth);
@@ -343,7 +343,7 @@ static void HotbarWidget_RenderHotbarBlocks(struct HotbarWidget* w) {
 	float width, scale;
 	int i, x, y;
 
-	IsometricDrawer_BeginBatch(vertices, Models.Vb);
+	IsometricDrawer_BeginBatch(vertices, Array_Elems(vertices), Models.Vb);
 	width =  w->ElemSize + w->BorderSize;
 	scale = (w->ElemSize * 13.5f/16.0f) / 2.0f;
 
@@ -673,7 +673,7 @@ static void TableWidget_Render(void* widget, double delta) {
 	Gfx_SetTexturing(true);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_P3FT2FC4B);
 
-	IsometricDrawer_BeginBatch(vertices, w->VB);
+	IsometricDrawer_BeginBatch(vertices, Array_Elems(vertices), w->VB);
 	for (i = 0; i < w->ElementsCount; i++) {
 		if (!TableWidget_GetCoords(w, i, &x, &y)) continue;
 
@@ -686,6 +686,8 @@ static void TableWidget_Render(void* widget, double delta) {
 	i = w->SelectedIndex;
 	if (i != -1) {
 		TableWidget_GetCoords(w, i, &x, &y);
+		/* Blocks are drawn grouped by 1D atlas, so selected block must be in a separate flush */
+		IsometricDrawer_Flush();
 
 		IsometricDrawer_DrawBatch(w->Elements[i],
 			(cellSize + w->SelBlockExpand) * 0.7f / 2.0f,
@@ -1837,7 +1839,7 @@ static void PlayerListWidget_DrawName(struct Texture* tex, struct PlayerListWidg
 	}
 
 	DrawTextArgs_Make(&args, &tmp, &w->Font, !w->Classic);
-	Drawer2D_MakeTextTexture(tex, &args, 0, 0);
+	Drawer2D_MakeCachedTextTexture(tex, &args, 0, 0);
 	Drawer2D_ReducePadding_Tex(tex, w->Font.Size, 3);
 }
 
@@ -1952,6 +1954,7 @@ static void PlayerListWidget_Reposition(void* widget) {
 		w->Textures[i].X += w->X - oldX;
 		w->Textures[i].Y += w->Y - oldY;
 	}
+	w->Batch.Dirty = true;
 }
 
 static void PlayerListWidget_AddName(struct PlayerListWidget* w, EntityID id, int index) {
@@ -1965,7 +1968,7 @@ static void PlayerListWidget_AddName(struct PlayerListWidget* w, EntityID id, in
 }
 
 static void PlayerListWidget_DeleteAt(struct PlayerListWidget* w, int i) {
-	Gfx_DeleteTexture(&w->Textures[i].ID);
+	TextCache_Release(&w->Textures[i].ID);
 
 	for (; i < w->NamesCount - 1; i++) {
 		w->IDs[i]      = w->IDs[i + 1];
@@ -2110,7 +2113,7 @@ static void PlayerListWidget_TabEntryChanged(void* widget, int id) {
 		if (w->IDs[i] != id) continue;
 		tex = w->Textures[i];
 
-		Gfx_DeleteTexture(&tex.ID);
+		TextCache_Release(&tex.ID);
 		PlayerListWidget_AddName(w, id, i);
 		PlayerListWidget_SortAndReposition(w);
 		return;
@@ -2168,22 +2171,28 @@ static void PlayerListWidget_Render(void* widget, double delta) {
 	Elem_Render(title, delta);
 
 	selectedI = PlayerListWidget_HighlightedName(w, Mouse_X, Mouse_Y);
-	for (i = 0; i < w->NamesCount; i++) {
-		if (!w->Textures[i].ID) continue;
+	if (selectedI != w->Highlighted) {
+		w->Highlighted = selectedI; w->Batch.Dirty = true;
+	}
 
-		tex = w->Textures[i];
-		if (i == selectedI) tex.X += 4;
-		Texture_Render(&tex);
+	if (TextureBatch_Begin(&w->Batch, w->NamesCount)) {
+		for (i = 0; i < w->NamesCount; i++) {
+			tex = w->Textures[i];
+			if (i == selectedI) tex.X += 4;
+			TextureBatch_Add(&w->Batch, &tex);
+		}
 	}
+	TextureBatch_Render(&w->Batch);
 }
 
 static void PlayerListWidget_Free(void* widget) {
 	struct PlayerListWidget* w = widget;
 	int i;
 	for (i = 0; i < w->NamesCount; i++) {
-		Gfx_DeleteTexture(&w->Textures[i].ID);
+		TextCache_Release(&w->Textures[i].ID);
 	}
 
+	TextureBatch_Free(&w->Batch);
 	Elem_TryFree(&w->Title);
 	Event_UnregisterInt(&TabListEvents.Added,   w, PlayerListWidget_TabEntryAdded);
 	Event_UnregisterInt(&TabListEvents.Changed, w, PlayerListWidget_TabEntryChanged);
@@ -2206,6 +2215,7 @@ void PlayerListWidget_Create(struct PlayerListWidget* w, const FontDesc* font, b
 	w->Font       = *font;
 	w->Classic    = classic;
 	w->ElementOffset = classic ? 0 : 10;
+	w->Highlighted   = -1;
 }
 
 
@@ -2227,7 +2237,7 @@ void TextGroupWidget_PushUpAndReplaceLast(struct TextGroupWidget* w, const Strin
 	int max_index;
 	int i, y = w->Y;
 
-	Gfx_DeleteTexture(&w->Textures[0].ID);
+	TextCache_Release(&w->Textures[0].ID);
 	max_index = w->LinesCount - 1;
 
 	/* Move contents of X line to X - 1 line */
@@ -2310,6 +2320,7 @@ static void TextGroupWidget_Reposition(void* widget) {
 		textures[i].X = Gui_CalcPos(w->HorAnchor, w->XOffset, textures[i].Width, Game.Width);
 		textures[i].Y += w->Y - oldY;
 	}
+	w->Batch.Dirty = true;
 }
 
 static void TextGroupWidget_UpdateDimensions(struct TextGroupWidget* w) {	
@@ -2569,7 +2580,7 @@ void TextGroupWidget_SetText(struct TextGroupWidget* w, int index, const String*
 	String text = *text_orig;
 	struct DrawTextArgs args;
 	struct Texture tex = { 0 };
-	Gfx_DeleteTexture(&w->Textures[index].ID);
+	TextCache_Release(&w->Textures[index].ID);
 
 	text.length = min(text.length, TEXTGROUPWIDGET_LEN);
 	Mem_Copy(TextGroupWidget_LineBuffer(w, index), text.buffer, text.length);
@@ -2579,7 +2590,7 @@ void TextGroupWidget_SetText(struct TextGroupWidget* w, int index, const String*
 		DrawTextArgs_Make(&args, &text, &w->Font, true);
 
 		if (!TextGroupWidget_MightHaveUrls(w)) {
-			Drawer2D_MakeTextTexture(&tex, &args, 0, 0);
+			Drawer2D_MakeCachedTextTexture(&tex, &args, 0, 0);
 		} else {
 			TextGroupWidget_DrawAdvanced(w, &tex, &args, index, &text);
 		}
@@ -2591,9 +2602,16 @@ void TextGroupWidget_SetText(struct TextGroupWidget* w, int index, const String*
 	tex.X = Gui_CalcPos(w->HorAnchor, w->XOffset, tex.Width, Game.Width);
 	tex.Y = TextGroupWidget_CalcY(w, index, tex.Height);
 	w->Textures[index] = tex;
+	w->Batch.Dirty     = true;
 	TextGroupWidget_UpdateDimensions(w);
 }
 
+void TextGroupWidget_SetHiddenLines(struct TextGroupWidget* w, uint32_t hidden) {
+	if (w->HiddenLines == hidden) return;
+	w->HiddenLines = hidden;
+	w->Batch.Dirty = true;
+}
+
 
 static void TextGroupWidget_Init(void* widget) {
 	struct TextGroupWidget* w = widget;
@@ -2615,10 +2633,13 @@ static void TextGroupWidget_Render(void* widget, double delta) {
 	struct Texture* textures  = w->Textures;
 	int i;
 
-	for (i = 0; i < w->LinesCount; i++) {
-		if (!textures[i].ID) continue;
-		Texture_Render(&textures[i]);
+	if (TextureBatch_Begin(&w->Batch, w->LinesCount)) {
+		for (i = 0; i < w->LinesCount; i++) {
+			if (w->HiddenLines & (1u << i)) continue;
+			TextureBatch_Add(&w->Batch, &textures[i]);
+		}
 	}
+	TextureBatch_Render(&w->Batch);
 }
 
 static void TextGroupWidget_Free(void* widget) {
@@ -2627,8 +2648,9 @@ static void TextGroupWidget_Free(void* widget) {
 
 	for (i = 0; i < w->LinesCount; i++) {
 		w->LineLengths[i] = 0;
-		Gfx_DeleteTexture(&w->Textures[i].ID);
+		TextCache_Release(&w->Textures[i].ID);
 	}
+	TextureBatch_Free(&w->Batch);
 }
 
 static struct WidgetVTABLE TextGroupWidget_VTABLE = {
@@ -2641,10 +2663,11 @@ void TextGroupWidget_Create(struct TextGroupWidget* w, int lines, const FontDesc
 	Widget_Reset(w);
 	w->VTABLE = &TextGroupWidget_VTABLE;
 
-	w->LinesCount = lines;
-	w->Font       = *font;
-	w->Textures   = textures;
-	w->Buffer     = buffer;
+	w->LinesCount  = lines;
+	w->Font        = *font;
+	w->Textures    = textures;
+	w->Buffer      = buffer;
+	w->HiddenLines = 0;
 }
 
 
@@ -168,6 +168,8 @@ struct TextGroupWidget {
 	uint8_t LineLengths[TEXTGROUPWIDGET_MAX_LINES];
 	struct Texture* Textures;
 	char* Buffer;
+	uint32_t HiddenLines; /* Bit mask of lines that are not rendered. (bit n = line n) */
+	struct TextureBatch Batch;
 };
 
 CC_NOINLINE void TextGroupWidget_Create(struct TextGroupWidget* w, int lines, const FontDesc* font, STRING_REF struct Texture* textures, STRING_REF char* buffer);
@@ -177,6 +179,7 @@ CC_NOINLINE int  TextGroupWidget_UsedHeight(struct TextGroupWidget* w);
 CC_NOINLINE void TextGroupWidget_GetSelected(struct TextGroupWidget* w, String* text, int mouseX, int mouseY);
 CC_NOINLINE void TextGroupWidget_GetText(struct TextGroupWidget* w, int index, String* text);
 CC_NOINLINE void TextGroupWidget_SetText(struct TextGroupWidget* w, int index, const String* text);
+CC_NOINLINE void TextGroupWidget_SetHiddenLines(struct TextGroupWidget* w, uint32_t hidden);
 
 
 struct PlayerListWidget {
@@ -188,6 +191,8 @@ struct PlayerListWidget {
 	struct TextWidget Title;
 	uint16_t IDs[TABLIST_MAX_NAMES * 2];
 	struct Texture Textures[TABLIST_MAX_NAMES * 2];
+	int Highlighted;
+	struct TextureBatch Batch;
 };
 CC_NOINLINE void PlayerListWidget_Create(struct PlayerListWidget* w, const FontDesc* font, bool classic);
 CC_NOINLINE void PlayerListWidget_GetNameUnder(struct PlayerListWidget* w, int mouseX, int mouseY, String* name);
@@ -92,10 +92,91 @@ void GraphicsMode_MakeDefault(struct GraphicsMode* m) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Null window-------------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_NULLGFX
+/* Window that never appears on screen and never receives any input. */
+static bool win_visible, win_pendingClose;
+static int win_state;
+static String win_clipboard; static char win_clipboardBuffer[STRING_SIZE * 4];
+static Bitmap win_raw;
+
+void Window_Init(void) {
+	Display_Bounds.Width  = 1920;
+	Display_Bounds.Height = 1080;
+	Display_BitsPerPixel  = 32;
+	String_InitArray(win_clipboard, win_clipboardBuffer);
+}
+
+void Window_Create(int x, int y, int width, int height, struct GraphicsMode* mode) {
+	Window_ClientBounds.X = x; Window_ClientBounds.Width  = width;
+	Window_ClientBounds.Y = y; Window_ClientBounds.Height = height;
+	Window_Bounds = Window_ClientBounds;
+
+	Window_Exists  = true;
+	Window_Focused = true;
+}
+
+void Window_SetTitle(const String* title) { }
+void Window_GetClipboardText(String* value) { String_Copy(value, &win_clipboard); }
+void Window_SetClipboardText(const String* value) { String_Copy(&win_clipboard, value); }
+
+bool Window_GetVisible(void) { return win_visible; }
+void Window_SetVisible(bool visible) { win_visible = visible; }
+void* Window_GetWindowHandle(void) { return NULL; }
+
+int Window_GetWindowState(void) { return win_state; }
+void Window_SetWindowState(int state) {
+	if (win_state == state) return;
+	win_state = state;
+	Event_RaiseVoid(&WindowEvents.StateChanged);
+}
+
+void Window_SetLocation(int x, int y) {
+	Window_Bounds.X = x; Window_ClientBounds.X = x;
+	Window_Bounds.Y = y; Window_ClientBounds.Y = y;
+	Event_RaiseVoid(&WindowEvents.Moved);
+}
+
+void Window_SetSize(int width, int height) {
+	Window_Bounds.Width  = width;  Window_ClientBounds.Width  = width;
+	Window_Bounds.Height = height; Window_ClientBounds.Height = height;
+	Event_RaiseVoid(&WindowEvents.Resized);
+}
+
+void Window_Close(void) { win_pendingClose = true; }
+void Window_ProcessEvents(void) {
+	if (!win_pendingClose || !Window_Exists) return;
+	win_pendingClose = false;
+
+	Window_Exists = false;
+	Event_RaiseVoid(&WindowEvents.Closing);
+	Event_RaiseVoid(&WindowEvents.Destroyed);
+}
+
+static Point2D win_cursorPos;
+Point2D Cursor_GetScreenPos(void) { return win_cursorPos; }
+void Cursor_SetScreenPos(int x, int y) { win_cursorPos.X = x; win_cursorPos.Y = y; }
+void Cursor_SetVisible(bool visible) { win_cursorVisible = visible; }
+
+void Window_ShowDialog(const char* title, const char* msg) {
+	Platform_Log2("%c: %c", title, msg);
+}
+
+void Window_InitRaw(Bitmap* bmp) {
+	Mem_Free(win_raw.Scan0);
+	Bitmap_Allocate(&win_raw, bmp->Width, bmp->Height);
+	bmp->Scan0 = win_raw.Scan0;
+}
+void Window_DrawRaw(Rect2D r) { }
+#endif
+
+
 /*########################################################################################################################*
 *------------------------------------------------------Win32 window-------------------------------------------------------*
 *#########################################################################################################################*/
-#ifdef CC_BUILD_WIN
+#if defined CC_BUILD_WIN && !defined CC_BUILD_NULLGFX
 #define WIN32_LEAN_AND_MEAN
 #define NOSERVICE
 #define NOMCX
@@ -1785,7 +1866,7 @@ static XVisualInfo GLContext_SelectVisual(struct GraphicsMode* mode) {
 /*########################################################################################################################*
 *------------------------------------------------------Carbon window------------------------------------------------------*
 *#########################################################################################################################*/
-#ifdef CC_BUILD_OSX
+#if defined CC_BUILD_OSX && !defined CC_BUILD_NULLGFX
 #include <AGL/agl.h>
 #include <ApplicationServices/ApplicationServices.h>
 
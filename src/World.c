@@ -8,6 +8,7 @@
 #include "ExtMath.h"
 #include "Physics.h"
 #include "Game.h"
+#include "Utils.h"
 
 struct _WorldData World;
 /*########################################################################################################################*
@@ -78,6 +79,65 @@ CC_NOINLINE void World_SetDimensions(int width, int height, int length) {
 	World.MaxZ = length - 1;
 }
 
+#define FLOODFILL_STACK_FAST 4096
+struct FloodFillStack { int32_t* Items; uint32_t Count, Limit; };
+
+/* Pushes the start of each run of target blocks in the row between beg and end. */
+static void World_FloodFillRow(struct FloodFillStack* s, BlockRaw* blocks, int beg, int end, BlockRaw target) {
+	/* at most one run every two blocks */
+	uint32_t maxRuns = (uint32_t)(end - beg) / 2 + 1;
+	int i;
+
+	while (s->Count + maxRuns > s->Limit) {
+		s->Items = Utils_Resize(s->Items, &s->Limit, 4, FLOODFILL_STACK_FAST, FLOODFILL_STACK_FAST);
+	}
+
+	for (i = beg; i <= end; i++) {
+		if (blocks[i] != target) continue;
+		s->Items[s->Count++] = i;
+
+		/* skip to end of this run */
+		while (i < end && blocks[i + 1] == target) i++;
+	}
+}
+
+int World_FloodFill(BlockRaw* blocks, int index, BlockRaw target, BlockRaw block, bool fillUp) {
+	int32_t stack_default[FLOODFILL_STACK_FAST]; /* try to avoid malloc if we can */
+	struct FloodFillStack s;
+	int rowBeg, rowEnd, beg, end;
+	int filled = 0, y, z;
+
+	if (index < 0 || index >= World.Volume) return 0;
+	if (target == block || blocks[index] != target) return 0;
+
+	s.Items = stack_default; s.Limit = FLOODFILL_STACK_FAST;
+	s.Count = 1; s.Items[0] = index;
+
+	while (s.Count) {
+		index = s.Items[--s.Count];
+		if (blocks[index] != target) continue;
+
+		/* Fill the whole run of target blocks on X axis that contains this block */
+		rowBeg = index - (index % World.Width);
+		rowEnd = rowBeg + World.MaxX;
+		for (beg = index; beg > rowBeg && blocks[beg - 1] == target; beg--) {}
+		for (end = index; end < rowEnd && blocks[end + 1] == target; end++) {}
+
+		Mem_Set(blocks + beg, block, (uint32_t)(end - beg + 1));
+		filled += end - beg + 1;
+
+		y = index / World.OneY;
+		z = (index / World.Width) % World.Length;
+		if (z > 0)              World_FloodFillRow(&s, blocks, beg - World.Width, end - World.Width, target);
+		if (z < World.MaxZ)     World_FloodFillRow(&s, blocks, beg + World.Width, end + World.Width, target);
+		if (y > 0)              World_FloodFillRow(&s, blocks, beg - World.OneY,  end - World.OneY,  target);
+		if (y < World.MaxY && fillUp) World_FloodFillRow(&s, blocks, beg + World.OneY, end + World.OneY, target);
+	}
+
+	if (s.Limit > FLOODFILL_STACK_FAST) Mem_Free(s.Items);
+	return filled;
+}
+
 #ifdef EXTENDED_BLOCKS
 void World_SetMapUpper(BlockRaw* blocks) {
 	World.Blocks2 = blocks;
@@ -44,6 +44,10 @@ CC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length)
 /* Sets the various dimension and max coordinate related variables. */
 /* NOTE: This is an internal API. Use World_SetNewMap instead. */
 CC_NOINLINE void World_SetDimensions(int width, int height, int length);
+/* Replaces all blocks equal to target that are connected to the block at the given index with block. */
+/* Blocks are connected to their neighbours on the X and Z axes, the block below, and the block above if fillUp. */
+/* NOTE: blocks must have the same dimensions as the current world. Returns number of blocks replaced. */
+CC_API int World_FloodFill(BlockRaw* blocks, int index, BlockRaw target, BlockRaw block, bool fillUp);
 
 #ifdef EXTENDED_BLOCKS
 extern int Block_IDMask;